@@ -5,18 +5,25 @@
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
-#include <sys/select.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <time.h>
+
+#include "reactor.h"
+#include "proto.h"
+#include "nodeid.h"
 
 #define MAX_BUF 256
+#define MAX_CANDIDATOS 16
+#define JOIN_TIMEOUT_MS 3000  // tempo máximo por candidato (opção -t)
 
-// Estrutura para guardar a topologia do nó
+// Estrutura para guardar a topologia do nó (nós empacotados em NodeId; o
+// texto "ip:porta" só é feito ao mostrar)
 typedef struct {
-    char id[64];                   // Identificador do nó (IP:TCP)
-    char vizinho_externo[64];      // Nó com o qual se ligou (vizinho externo)
-    char vizinho_salvaguarda[64];   // Nó de salvaguarda (obtido via SAFE)
-    char vizinhos_internos[10][64]; // Lista de nós internos (até 10, para exemplo)
+    NodeId id;                     // Identificador do nó (IP e porta TCP)
+    NodeId vizinho_externo;        // Nó com o qual se ligou (vizinho externo)
+    NodeId vizinho_salvaguarda;    // Nó de salvaguarda (obtido via SAFE)
+    NodeId vizinhos_internos[10];  // Lista de nós internos (até 10, para exemplo)
     int num_vizinhos;
 } Topologia;
 
@@ -27,6 +34,64 @@ struct sockaddr_storage server_addr;
 socklen_t server_addr_len;
 
 int tcp_sock = -1; // Socket TCP ativo (usado no direct join, quando aberto)
+char tcp_pendente[MAX_BUF];        // mensagem parcial recebida no socket TCP
+ProtoBuf tcp_rx = {tcp_pendente, sizeof(tcp_pendente), 0};
+
+Reactor reactor;   // Multiplexa STDIN, o socket UDP e o socket TCP ativo
+const char *own_ip;
+const char *own_tcp;
+
+void handle_tcp(Reactor *r, int fd, uint32_t events, void *arg);
+
+// Estados de uma tentativa de join não bloqueante
+typedef enum {
+    JOIN_IDLE,
+    JOIN_CONNECTING,      // connect() em curso
+    JOIN_ENTRY_SENT,      // ligação estabelecida, ENTRY enviado
+    JOIN_AWAITING_SAFE,   // à espera do SAFE
+    JOIN_ESTABLISHED
+} JoinState;
+
+// Nó candidato a vizinho externo (de "direct join" ou da NODESLIST)
+typedef struct {
+    NodeId id;
+} Candidato;
+
+Candidato candidatos[MAX_CANDIDATOS];
+int num_candidatos = 0;
+int proximo_candidato = 0;
+JoinState join_estado = JOIN_IDLE;
+long long join_prazo;              // instante (ms) em que a tentativa expira
+int join_timeout_ms = JOIN_TIMEOUT_MS;
+
+/*
+ * Função: now_ms
+ * Relógio monótono em milissegundos.
+ */
+long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void join_set_estado(JoinState st) {
+    static const char *nomes[] = {"IDLE", "CONNECTING", "ENTRY_SENT", "AWAITING_SAFE", "ESTABLISHED"};
+    join_estado = st;
+    printf("Join: estado %s\n", nomes[st]);
+}
+
+/*
+ * Função: close_tcp_sock
+ * Retira o socket TCP ativo do reactor e fecha-o.
+ */
+void close_tcp_sock(void) {
+    if(tcp_sock != -1) {
+        reactor_del(&reactor, tcp_sock);
+        close(tcp_sock);
+        tcp_sock = -1;
+    }
+    tcp_rx.len = 0;
+}
 
 /* 
  * Função: perform_registration
@@ -44,73 +109,192 @@ int perform_registration(const char *net, const char *own_ip, const char *own_tc
     return 0;
 }
 
+void join_proximo_candidato(void);
+
 /* 
- * Função: perform_direct_join
- * Realiza o direct join: se o connectIP for "0.0.0.0", cria a rede com nó próprio.
- * Caso contrário, cria uma ligação TCP com o nó indicado, envia a mensagem ENTRY e
- * aguarda (via select) pela mensagem SAFE, que atualiza o vizinho de salvaguarda.
+ * Função: handle_connect
+ * O connect() não bloqueante terminou: em caso de sucesso envia ENTRY e passa a
+ * aguardar o SAFE em handle_tcp; caso contrário tenta o candidato seguinte.
  */
-int perform_direct_join(const char *net, const char *connectIP, const char *connectTCP,
-                          const char *own_ip, const char *own_tcp) {
-    printf("Direct join: conectando a %s:%s na rede %s\n", connectIP, connectTCP, net);
-    // Se connectIP for "0.0.0.0", a rede é criada com o nó próprio.
-    if(strcmp(connectIP, "0.0.0.0") == 0) {
-        strncpy(topo.vizinho_externo, topo.id, sizeof(topo.vizinho_externo));
-        strncpy(topo.vizinho_salvaguarda, topo.id, sizeof(topo.vizinho_salvaguarda));
-        printf("Rede criada com nó próprio.\n");
-        return 0;
+void handle_connect(Reactor *r, int fd, uint32_t events, void *arg) {
+    (void)events; (void)arg;
+    Candidato *c = &candidatos[proximo_candidato - 1];
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if(getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1)
+        err = errno;
+    if(err == EINPROGRESS)
+        return;
+    if(err != 0) {
+        fprintf(stderr, "Erro: não foi possível conectar a %s: %s\n", nodeid_text(c->id).s, strerror(err));
+        close_tcp_sock();
+        join_proximo_candidato();
+        return;
+    }
+    // Ligação estabelecida: a partir de agora só interessa a leitura
+    reactor_del(r, fd);
+    if(reactor_add(r, fd, REACTOR_READ, handle_tcp, NULL) == -1) {
+        close(fd);
+        tcp_sock = -1;
+        join_proximo_candidato();
+        return;
     }
 
-    // Cria socket TCP e conecta-se a connectIP:connectTCP
-    struct addrinfo hints, *res, *p;
-    int sockfd;
-    char port_str[16];
-    snprintf(port_str, sizeof(port_str), "%s", connectTCP);
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
-    int err = getaddrinfo(connectIP, port_str, &hints, &res);
-    if(err != 0) {
-        fprintf(stderr, "getaddrinfo TCP: %s\n", gai_strerror(err));
-        return -1;
+    // Envia a mensagem ENTRY: "ENTRY own_ip own_tcp\n"
+    char entry_msg[MAX_BUF];
+    size_t n = 6 + nodeid_put_addr(entry_msg + 6, topo.id);
+    memcpy(entry_msg, "ENTRY ", 6);
+    entry_msg[n++] = '\n';
+    entry_msg[n] = '\0';
+    if(write(tcp_sock, entry_msg, n) < 0) {
+        perror("write ENTRY");
+        close_tcp_sock();
+        join_proximo_candidato();
+        return;
     }
-    for(p = res; p != NULL; p = p->ai_next) {
-        sockfd = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
-        if(sockfd == -1)
+    join_set_estado(JOIN_ENTRY_SENT);
+    printf("Enviado ENTRY: %s", entry_msg);
+    // A receção da mensagem SAFE será tratada pelo reactor (handle_tcp)
+    join_set_estado(JOIN_AWAITING_SAFE);
+}
+
+/* 
+ * Função: join_concluido
+ * Recebido o SAFE: o candidato atual passa a ser o vizinho externo.
+ */
+void join_concluido(void) {
+    Candidato *c = &candidatos[proximo_candidato - 1];
+    join_set_estado(JOIN_ESTABLISHED);
+    // Atualiza a topologia: define o vizinho externo e adiciona-o aos internos
+    topo.vizinho_externo = c->id;
+    if(topo.num_vizinhos < 10)
+        topo.vizinhos_internos[topo.num_vizinhos++] = c->id;
+}
+
+/* 
+ * Função: join_proximo_candidato
+ * Inicia um connect() não bloqueante para o próximo candidato. O nó continua a
+ * servir STDIN e UDP enquanto a ligação está em curso.
+ */
+void join_proximo_candidato(void) {
+    while(proximo_candidato < num_candidatos) {
+        Candidato *c = &candidatos[proximo_candidato++];
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(nodeid_addr(c->id));
+        addr.sin_port = htons(nodeid_port(c->id));
+        close_tcp_sock();
+        int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        if(sockfd == -1) {
+            perror("socket");
             continue;
-        if(connect(sockfd, p->ai_addr, p->ai_addrlen) == -1) {
+        }
+        set_nonblocking(sockfd);
+        printf("Direct join: conectando a %s\n", nodeid_text(c->id).s);
+        join_prazo = now_ms() + join_timeout_ms;
+        join_set_estado(JOIN_CONNECTING);
+        if(connect(sockfd, (struct sockaddr *)&addr, sizeof(addr)) == -1 && errno != EINPROGRESS) {
+            fprintf(stderr, "Erro: não foi possível conectar a %s\n", nodeid_text(c->id).s);
             close(sockfd);
             continue;
         }
-        break;
+        tcp_sock = sockfd; // Guarda o socket TCP; a conclusão chega pelo reactor
+        if(reactor_add(&reactor, tcp_sock, REACTOR_WRITE, handle_connect, NULL) == -1) {
+            close(tcp_sock);
+            tcp_sock = -1;
+            continue;
+        }
+        return;
     }
-    if(p == NULL) {
-        fprintf(stderr, "Erro: não foi possível conectar a %s:%s\n", connectIP, connectTCP);
-        freeaddrinfo(res);
+    printf("Join falhou: nenhum candidato respondeu.\n");
+    join_estado = JOIN_IDLE;
+}
+
+/*
+ * Função: join_timeout
+ * Milissegundos até a tentativa atual expirar (-1 se não houver join em curso).
+ */
+int join_timeout(void) {
+    if(join_estado == JOIN_IDLE || join_estado == JOIN_ESTABLISHED)
         return -1;
+    long long restante = join_prazo - now_ms();
+    return restante > 0 ? (int)restante : 0;
+}
+
+/*
+ * Função: join_verifica_timeout
+ * Chamada após cada iteração do reactor: se a tentativa expirou, desiste deste
+ * candidato e passa ao seguinte.
+ */
+void join_verifica_timeout(void) {
+    if(join_timeout() != 0)
+        return;
+    Candidato *c = &candidatos[proximo_candidato - 1];
+    printf("Join: %s não respondeu em %d ms\n", nodeid_text(c->id).s, join_timeout_ms);
+    close_tcp_sock();
+    join_proximo_candidato();
+}
+
+/*
+ * Função: join_inicia
+ * Começa um join não bloqueante com a lista de candidatos atual.
+ */
+void join_inicia(void) {
+    if(join_estado != JOIN_IDLE && join_estado != JOIN_ESTABLISHED) {
+        printf("Já existe um join em curso.\n");
+        return;
     }
-    freeaddrinfo(res);
-    tcp_sock = sockfd; // Guarda o socket TCP para uso no select
+    proximo_candidato = 0;
+    join_proximo_candidato();
+}
 
-    // Envia a mensagem ENTRY: "ENTRY own_ip own_tcp\n"
-    char entry_msg[MAX_BUF];
-    snprintf(entry_msg, sizeof(entry_msg), "ENTRY %s %s\n", own_ip, own_tcp);
-    if(write(tcp_sock, entry_msg, strlen(entry_msg)) < 0) {
-        perror("write ENTRY");
-        close(tcp_sock);
-        tcp_sock = -1;
+/*
+ * Função: resolve_node
+ * Converte "host" e "porta" (nome ou IPv4) num NodeId.
+ */
+int resolve_node(const char *host, const char *port, NodeId *id) {
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    int err = getaddrinfo(host, port, &hints, &res);
+    if(err != 0) {
+        fprintf(stderr, "getaddrinfo TCP: %s\n", gai_strerror(err));
         return -1;
     }
-    printf("Enviado ENTRY: %s", entry_msg);
+    struct sockaddr_in *a = (struct sockaddr_in *)res->ai_addr;
+    *id = nodeid_make(ntohl(a->sin_addr.s_addr), ntohs(a->sin_port));
+    freeaddrinfo(res);
+    return 0;
+}
 
-    // Atualiza a topologia: define o vizinho externo e adiciona-o aos internos
-    snprintf(topo.vizinho_externo, sizeof(topo.vizinho_externo), "%s:%s", connectIP, connectTCP);
-    if(topo.num_vizinhos < 10) {
-        snprintf(topo.vizinhos_internos[topo.num_vizinhos], sizeof(topo.vizinhos_internos[topo.num_vizinhos]),
-                 "%s:%s", connectIP, connectTCP);
-        topo.num_vizinhos++;
+/* 
+ * Função: perform_direct_join
+ * Realiza o direct join: se o connectIP for "0.0.0.0", cria a rede com nó próprio.
+ * Caso contrário, inicia uma ligação TCP não bloqueante com o nó indicado; o ENTRY
+ * é enviado quando a ligação se estabelece e o SAFE é tratado pelo reactor.
+ */
+int perform_direct_join(const char *net, const char *connectIP, const char *connectTCP,
+                          const char *own_ip, const char *own_tcp) {
+    (void)own_ip; (void)own_tcp;
+    printf("Direct join: conectando a %s:%s na rede %s\n", connectIP, connectTCP, net);
+    // Se connectIP for "0.0.0.0", a rede é criada com o nó próprio.
+    if(strcmp(connectIP, "0.0.0.0") == 0) {
+        topo.vizinho_externo = topo.id;
+        topo.vizinho_salvaguarda = topo.id;
+        printf("Rede criada com nó próprio.\n");
+        return 0;
     }
-    // A receção da mensagem SAFE será tratada no loop principal (via select) no socket tcp_sock
+    if(join_estado != JOIN_IDLE && join_estado != JOIN_ESTABLISHED) {
+        printf("Já existe um join em curso.\n");
+        return -1;
+    }
+    // O nome é resolvido uma vez aqui; daí em diante o candidato é só o NodeId
+    if(resolve_node(connectIP, connectTCP, &candidatos[0].id) == -1)
+        return -1;
+    num_candidatos = 1;
+    join_inicia();
     return 0;
 }
 
@@ -128,7 +312,7 @@ int perform_join(const char *net, const char *own_ip, const char *own_tcp) {
         return -1;
     }
     printf("Enviado NODES: %s\n", msg);
-    // A resposta do servidor será processada na parte de UDP do select.
+    // A resposta do servidor será processada pelo reactor (handle_udp).
     return 0;
 }
 
@@ -138,33 +322,200 @@ int perform_join(const char *net, const char *own_ip, const char *own_tcp) {
  */
 void show_topology() {
     printf("----- Topologia -----\n");
-    printf("ID: %s\n", topo.id);
-    printf("Vizinho Externo: %s\n", topo.vizinho_externo);
-    printf("Vizinho de Salvaguarda: %s\n", topo.vizinho_salvaguarda);
+    printf("ID: %s\n", nodeid_text(topo.id).s);
+    printf("Vizinho Externo: %s\n", nodeid_text(topo.vizinho_externo).s);
+    printf("Vizinho de Salvaguarda: %s\n", nodeid_text(topo.vizinho_salvaguarda).s);
     printf("Vizinhos Internos (%d):\n", topo.num_vizinhos);
     for (int i = 0; i < topo.num_vizinhos; i++){
-        printf("  %s\n", topo.vizinhos_internos[i]);
+        printf("  %s\n", nodeid_text(topo.vizinhos_internos[i]).s);
     }
     printf("----------------------\n");
 }
 
+/* 
+ * Função: process_command
+ * Processa um comando introduzido pelo utilizador.
+ */
+void process_command(Reactor *r, char *input_line) {
+    input_line[strcspn(input_line, "\n")] = 0; // remove \n
+
+    if(strcmp(input_line, "exit") == 0) {
+        reactor_stop(r);
+    } else if(strncmp(input_line, "show topology", 13) == 0) {
+        show_topology();
+    } // Processamento do comando "direct join":
+    else if(strncmp(input_line, "direct join", 11) == 0) {
+        // Formato esperado: direct join net connectIP connectTCP
+        char cmd1[16], cmd2[16], net[16], connectIP[64], connectTCP[16];
+        if(sscanf(input_line, "%s %s %s %s %s", cmd1, cmd2, net, connectIP, connectTCP) == 5) {
+            perform_direct_join(net, connectIP, connectTCP, own_ip, own_tcp);
+            // Após o direct join, regista o nó no servidor via UDP
+            perform_registration(net, own_ip, own_tcp);
+        } else {
+            printf("Comando inválido. Uso: direct join net connectIP connectTCP\n");
+        }
+    }
+    
+    else if(strncmp(input_line, "join", 4) == 0) {
+        // Formato: join net
+        char cmd[16], net[16];
+        if(sscanf(input_line, "%s %s", cmd, net) == 2) {
+            perform_join(net, own_ip, own_tcp);
+            // Após o join, o nó regista-se no servidor
+            perform_registration(net, own_ip, own_tcp);
+        } else {
+            printf("Comando inválido. Uso: join net\n");
+        }
+    }
+    else {
+        printf("Comando desconhecido: %s\n", input_line);
+    }
+}
+
+/* 
+ * Função: handle_stdin
+ * Processa todas as linhas já disponíveis no STDIN.
+ */
+void handle_stdin(Reactor *r, int fd, uint32_t events, void *arg) {
+    (void)events; (void)arg;
+    char input_line[256];
+    do {
+        if(fgets(input_line, sizeof(input_line), stdin) == NULL) {
+            reactor_stop(r);
+            return;
+        }
+        process_command(r, input_line);
+    } while(r->running && fd_pending_bytes(fd) > 0);
+}
+
+/* 
+ * Função: handle_udp
+ * Processa as respostas do servidor de nós (OKREG, NODESLIST, ...).
+ */
+void handle_udp(Reactor *r, int fd, uint32_t events, void *arg) {
+    (void)r; (void)events; (void)arg;
+    char udp_buf[256];
+    int n;
+    while((n = recvfrom(fd, udp_buf, sizeof(udp_buf)-1, 0, NULL, NULL)) > 0) {
+        udp_buf[n] = '\0';
+        ProtoLines it;
+        StrView line = {udp_buf, 0};
+        ProtoMsg m;
+        proto_lines_init(&it, udp_buf, (size_t)n);
+        proto_lines_next(&it, &line);  // primeira linha: o comando
+        proto_parse(line.p, line.len, &m);
+        // Se a mensagem for OKREG, informa o utilizador
+        if(m.type == MSG_OKREG) {
+            printf("Registro confirmado pelo servidor: %s\n", udp_buf);
+        }
+        // Se a mensagem for NODESLIST, faz o join: tenta os nós pela ordem da
+        // lista, passando ao seguinte se um não responder a tempo
+        else if(m.type == MSG_NODESLIST) {
+            num_candidatos = 0;
+            while(num_candidatos < MAX_CANDIDATOS && proto_lines_next(&it, &line)) {
+                Candidato *c = &candidatos[num_candidatos];
+                if(proto_parse_node_id(line, &c->id) == 0) {
+                    num_candidatos++;
+                } else if(line.len > 0) {
+                    printf("Resposta do servidor mal formatada.\n");
+                }
+            }
+            if(num_candidatos > 0) {
+                printf("Join: %d nós candidatos\n", num_candidatos);
+                join_inicia();
+            } else {
+                // Se a lista estiver vazia, o nó cria a rede consigo próprio.
+                printf("Rede vazia. Criando rede com nó próprio.\n");
+                topo.vizinho_externo = topo.id;
+                topo.vizinho_salvaguarda = topo.id;
+            }
+        } else {
+            printf("Mensagem UDP recebida: %s\n", udp_buf);
+        }
+    }
+}
+
+/* 
+ * Função: handle_tcp
+ * Trata dados no socket TCP ativo (aguardando a mensagem SAFE).
+ */
+void handle_tcp(Reactor *r, int fd, uint32_t events, void *arg) {
+    (void)r; (void)events; (void)arg;
+    char tcp_buf[256];
+    int n = read(fd, tcp_buf, sizeof(tcp_buf));
+    if(n > 0) {
+        // Pode chegar mais do que uma mensagem (ex.: "ENTRY ...\nSAFE ...\n"),
+        // ou só parte de uma: o resto fica em tcp_rx até à leitura seguinte
+        ProtoInput in = {tcp_buf, (size_t)n};
+        StrView line;
+        ProtoMsg m;
+        int ret;
+        while((ret = proto_next_line(&tcp_rx, &in, &line)) == PROTO_LINE) {
+            int ok = proto_parse(line.p, line.len, &m);
+            // Espera a mensagem SAFE no formato: "SAFE ip tcp\n"
+            if(m.type == MSG_SAFE) {
+                if(ok == PROTO_OK && m.node != NODEID_NONE) {
+                    topo.vizinho_salvaguarda = m.node;
+                    printf("Recebido SAFE: novo vizinho de salvaguarda: %s\n",
+                           nodeid_text(topo.vizinho_salvaguarda).s);
+                    if(join_estado == JOIN_AWAITING_SAFE)
+                        join_concluido();
+                } else {
+                    printf("Mensagem SAFE mal formatada: %.*s\n", (int)line.len, line.p);
+                }
+            } else {
+                printf("Mensagem TCP recebida: %.*s\n", (int)line.len, line.p);
+            }
+        }
+        if(ret == PROTO_OVERFLOW) {
+            printf("Mensagem TCP demasiado longa.\n");
+            close_tcp_sock();
+            return;
+        }
+        // A ligação só é usada até chegar o SAFE
+        if(join_estado != JOIN_AWAITING_SAFE)
+            close_tcp_sock();
+    }
+    else if(n == 0) {
+        // conexão fechada
+        close_tcp_sock();
+        if(join_estado == JOIN_AWAITING_SAFE) {
+            printf("Join: ligação fechada antes do SAFE\n");
+            join_proximo_candidato();
+        }
+    }
+}
+
 int main(int argc, char *argv[]) {
     if(argc < 6) {
-        fprintf(stderr, "Uso: %s cache IP TCP regIP regUDP\n", argv[0]);
+        fprintf(stderr, "Uso: %s cache IP TCP regIP regUDP [-t join_ms]\n", argv[0]);
         exit(EXIT_FAILURE);
     }
+    // Opções após os argumentos posicionais
+    int opt;
+    while((opt = getopt(argc - 5, argv + 5, "t:")) != -1) {
+        if(opt == 't' && atoi(optarg) > 0) {
+            join_timeout_ms = atoi(optarg);
+        } else {
+            fprintf(stderr, "Uso: %s cache IP TCP regIP regUDP [-t join_ms]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
     // Parâmetros de linha de comando
     const char *cache_size = argv[1]; // tamanho da cache (não utilizado neste exemplo)
-    const char *own_ip = argv[2];
-    const char *own_tcp = argv[3];
+    own_ip = argv[2];
+    own_tcp = argv[3];
     const char *regIP = argv[4];
     const char *regUDP = argv[5];
 
     // Inicializa a topologia: o nó inicia com ele próprio como vizinho externo e salvaguarda.
     memset(&topo, 0, sizeof(topo));
-    snprintf(topo.id, sizeof(topo.id), "%s:%s", own_ip, own_tcp);
-    strncpy(topo.vizinho_externo, topo.id, sizeof(topo.vizinho_externo));
-    strncpy(topo.vizinho_salvaguarda, topo.id, sizeof(topo.vizinho_salvaguarda));
+    if(nodeid_parse_str(own_ip, atoi(own_tcp), &topo.id) == -1) {
+        fprintf(stderr, "Endereço do nó inválido: %s %s (IPv4 e porta TCP)\n", own_ip, own_tcp);
+        exit(EXIT_FAILURE);
+    }
+    topo.vizinho_externo = topo.id;
+    topo.vizinho_salvaguarda = topo.id;
     topo.num_vizinhos = 0;
 
     // Configura o socket UDP para comunicação com o servidor de nós
@@ -187,131 +538,24 @@ int main(int argc, char *argv[]) {
     server_addr_len = res->ai_addrlen;
     freeaddrinfo(res);
 
-    // Loop principal com multiplexação usando select()
-    char input_line[256];
-    fd_set read_fds;
-    int max_fd;
-    while(1) {
-        FD_ZERO(&read_fds);
-        FD_SET(STDIN_FILENO, &read_fds);
-        FD_SET(udp_sock, &read_fds);
-        max_fd = udp_sock;
-        if(tcp_sock != -1) {
-            FD_SET(tcp_sock, &read_fds);
-            if(tcp_sock > max_fd)
-                max_fd = tcp_sock;
-        }
-        int activity = select(max_fd+1, &read_fds, NULL, NULL, NULL);
-        if(activity < 0) {
-            perror("select");
+    // Loop principal: o reactor despacha cada descritor pronto para o seu handler
+    if(reactor_init(&reactor) == -1)
+        exit(EXIT_FAILURE);
+    set_nonblocking(udp_sock);
+    setvbuf(stdin, NULL, _IONBF, 0);
+    if(reactor_add(&reactor, STDIN_FILENO, REACTOR_READ, handle_stdin, NULL) == -1 ||
+       reactor_add(&reactor, udp_sock, REACTOR_READ | REACTOR_ET, handle_udp, NULL) == -1) {
+        exit(EXIT_FAILURE);
+    }
+    reactor.running = 1;
+    while(reactor.running) {
+        if(reactor_run_once(&reactor, join_timeout()) == -1)
             break;
-        }
-        // Verifica entrada do utilizador (STDIN)
-        if(FD_ISSET(STDIN_FILENO, &read_fds)) {
-            if(fgets(input_line, sizeof(input_line), stdin) == NULL)
-                break;
-            input_line[strcspn(input_line, "\n")] = 0; // remove \n
-
-            if(strcmp(input_line, "exit") == 0) {
-                break;
-            } else if(strncmp(input_line, "show topology", 13) == 0) {
-                show_topology();
-            } // Processamento do comando "direct join":
-            else if(strncmp(input_line, "direct join", 11) == 0) {
-                // Formato esperado: direct join net connectIP connectTCP
-                char cmd1[16], cmd2[16], net[16], connectIP[64], connectTCP[16];
-                if(sscanf(input_line, "%s %s %s %s %s", cmd1, cmd2, net, connectIP, connectTCP) == 5) {
-                    perform_direct_join(net, connectIP, connectTCP, own_ip, own_tcp);
-                    // Após o direct join, regista o nó no servidor via UDP
-                    perform_registration(net, own_ip, own_tcp);
-                } else {
-                    printf("Comando inválido. Uso: direct join net connectIP connectTCP\n");
-                }
-            }
-            
-            else if(strncmp(input_line, "join", 4) == 0) {
-                // Formato: join net
-                char cmd[16], net[16];
-                if(sscanf(input_line, "%s %s", cmd, net) == 2) {
-                    perform_join(net, own_ip, own_tcp);
-                    // Após o join, o nó regista-se no servidor
-                    perform_registration(net, own_ip, own_tcp);
-                } else {
-                    printf("Comando inválido. Uso: join net\n");
-                }
-            }
-            else {
-                printf("Comando desconhecido: %s\n", input_line);
-            }
-        } // Fim do processamento de STDIN
-
-        // Verifica se há mensagens UDP (respostas do servidor)
-        if(FD_ISSET(udp_sock, &read_fds)) {
-            char udp_buf[256];
-            int n = recvfrom(udp_sock, udp_buf, sizeof(udp_buf)-1, 0, NULL, NULL);
-            if(n > 0) {
-                udp_buf[n] = '\0';
-                // Se a mensagem for OKREG, informa o utilizador
-                if(strncmp(udp_buf, "OKREG", 5) == 0) {
-                    printf("Registro confirmado pelo servidor: %s\n", udp_buf);
-                }
-                // Se a mensagem for NODESLIST, faz o join (escolhe o primeiro nó)
-                else if(strncmp(udp_buf, "NODESLIST", 9) == 0) {
-                    char *saveptr;
-                    char *line = strtok_r(udp_buf, "\n", &saveptr); // "NODESLIST net"
-                    line = strtok_r(NULL, "\n", &saveptr); // primeiro nó da lista
-                    if(line) {
-                        char chosenIP[64], chosenTCP[16];
-                        if(sscanf(line, "%s %s", chosenIP, chosenTCP) == 2) {
-                            printf("Join: conectando ao nó %s:%s\n", chosenIP, chosenTCP);
-                            perform_direct_join(saveptr, chosenIP, chosenTCP, own_ip, own_tcp);
-                        } else {
-                            printf("Resposta do servidor mal formatada.\n");
-                        }
-                    } else {
-                        // Se a lista estiver vazia, o nó cria a rede consigo próprio.
-                        printf("Rede vazia. Criando rede com nó próprio.\n");
-                        strncpy(topo.vizinho_externo, topo.id, sizeof(topo.vizinho_externo));
-                        strncpy(topo.vizinho_salvaguarda, topo.id, sizeof(topo.vizinho_salvaguarda));
-                    }
-                } else {
-                    printf("Mensagem UDP recebida: %s\n", udp_buf);
-                }
-            }
-        }
-
-        // Verifica se há dados no socket TCP (aguardando a mensagem SAFE)
-        if(tcp_sock != -1 && FD_ISSET(tcp_sock, &read_fds)) {
-            char tcp_buf[256];
-            int n = read(tcp_sock, tcp_buf, sizeof(tcp_buf)-1);
-            if(n > 0) {
-                tcp_buf[n] = '\0';
-                // Espera a mensagem SAFE no formato: "SAFE ip tcp\n"
-                if(strncmp(tcp_buf, "SAFE", 4) == 0) {
-                    char safe_cmd[16], safe_ip[64], safe_tcp[16];
-                    if(sscanf(tcp_buf, "%s %s %s", safe_cmd, safe_ip, safe_tcp) == 3) {
-                        snprintf(topo.vizinho_salvaguarda, sizeof(topo.vizinho_salvaguarda),
-                                 "%s:%s", safe_ip, safe_tcp);
-                        printf("Recebido SAFE: novo vizinho de salvaguarda: %s:%s\n", safe_ip, safe_tcp);
-                    } else {
-                        printf("Mensagem SAFE mal formatada: %s\n", tcp_buf);
-                    }
-                } else {
-                    printf("Mensagem TCP recebida: %s\n", tcp_buf);
-                }
-                close(tcp_sock);
-                tcp_sock = -1;
-            }
-            else if(n == 0) {
-                // conexão fechada
-                close(tcp_sock);
-                tcp_sock = -1;
-            }
-        }
-    } // Fim do loop principal
+        join_verifica_timeout();
+    }
 
+    close_tcp_sock();
+    reactor_destroy(&reactor);
     close(udp_sock);
-    if(tcp_sock != -1)
-        close(tcp_sock);
     return 0;
 }
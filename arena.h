@@ -0,0 +1,97 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Arena de memória de longa duração.
+ *
+ * A memória é reservada em blocos de ARENA_BLOCK bytes (um bloco próprio
+ * para pedidos grandes) e cortada sequencialmente; não há libertação
+ * individual, tudo volta ao sistema em arena_destroy(). Serve para o que
+ * vive tanto como o nó, como os lotes dos pools de entradas e buffers e o
+ * texto internado com arena_strndup().
+ */
+
+#define ARENA_BLOCK (64 * 1024)
+#define ARENA_ALIGN 16
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;              // bytes utilizáveis a seguir ao cabeçalho
+    size_t used;
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *blocks;       // o primeiro é o bloco atual
+    size_t reserved;          // bytes pedidos ao sistema
+    size_t used;              // bytes entregues
+    unsigned long allocs;
+} Arena;
+
+#define ARENA_HEADER ((sizeof(ArenaBlock) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static inline void arena_init(Arena *a) {
+    memset(a, 0, sizeof(*a));
+}
+
+// size bytes alinhados a ARENA_ALIGN (não zerados), ou NULL sem memória
+static inline void *arena_alloc(Arena *a, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    ArenaBlock *b = a->blocks;
+    if (b == NULL || b->size - b->used < size) {
+        // Um pedido grande tem bloco próprio, atrás do atual, para não
+        // desperdiçar o que resta deste
+        size_t bsize = size > ARENA_BLOCK / 4 ? size : ARENA_BLOCK;
+        ArenaBlock *nb = malloc(ARENA_HEADER + bsize);
+        if (nb == NULL) {
+            perror("arena_alloc");
+            return NULL;
+        }
+        nb->size = bsize;
+        nb->used = 0;
+        a->reserved += ARENA_HEADER + bsize;
+        if (bsize != ARENA_BLOCK && b != NULL) {
+            nb->next = b->next;
+            b->next = nb;
+        } else {
+            nb->next = b;
+            a->blocks = nb;
+        }
+        b = nb;
+    }
+    void *p = (char *)b + ARENA_HEADER + b->used;
+    b->used += size;
+    a->used += size;
+    a->allocs++;
+    return p;
+}
+
+// Cópia internada de len bytes de s, terminada em '\0'
+static inline char *arena_strndup(Arena *a, const char *s, size_t len) {
+    char *p = arena_alloc(a, len + 1);
+    if (p != NULL) {
+        memcpy(p, s, len);
+        p[len] = '\0';
+    }
+    return p;
+}
+
+static inline void arena_destroy(Arena *a) {
+    while (a->blocks != NULL) {
+        ArenaBlock *b = a->blocks;
+        a->blocks = b->next;
+        free(b);
+    }
+    a->reserved = a->used = 0;
+    a->allocs = 0;
+}
+
+static inline void arena_print_stats(const Arena *a) {
+    printf("Arena: %zu bytes reservados, %zu usados em %lu pedidos\n",
+           a->reserved, a->used, a->allocs);
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/*
+ * Filtros de Bloom para os resumos (digests) de nomes trocados entre
+ * vizinhos.
+ *
+ * O nó mantém um filtro com contadores (BloomCounter) dos nomes que tem no
+ * armazém e na cache; cada posição que passa de 0 para 1 ou de 1 para 0 é
+ * comunicada aos vizinhos, que guardam só os bits (BloomFilter). As k
+ * posições de um nome vêm de dois hashes por dispersão dupla,
+ * (h1 + i * h2) mod bits, que são o hash e o hash2 do NameView.
+ */
+
+#define BLOOM_BITS   8192
+#define BLOOM_K      4
+#define BLOOM_MAX_K  16
+#define BLOOM_MAX_BITS (1u << 20)
+
+static inline void bloom_positions(uint32_t h1, uint32_t h2, uint32_t bits, int k, uint32_t *out) {
+    for (int i = 0; i < k; i++)
+        out[i] = (h1 + (uint32_t)i * h2) % bits;
+}
+
+// Filtro só com bits (resumo recebido de um vizinho)
+typedef struct {
+    uint32_t bits;
+    int k;
+    uint8_t *map;
+} BloomFilter;
+
+static inline int bloom_init(BloomFilter *f, uint32_t bits, int k) {
+    f->map = calloc((bits + 7) / 8, 1);
+    if (f->map == NULL)
+        return -1;
+    f->bits = bits;
+    f->k = k;
+    return 0;
+}
+
+static inline void bloom_free(BloomFilter *f) {
+    free(f->map);
+    memset(f, 0, sizeof(*f));
+}
+
+// Recomeça o filtro vazio com bits e k; reaproveita o mapa se o tamanho
+// não mudou (um vizinho reenvia o resumo completo sem mudar de dimensão)
+static inline int bloom_reset(BloomFilter *f, uint32_t bits, int k) {
+    if (f->map != NULL && f->bits == bits) {
+        memset(f->map, 0, (bits + 7) / 8);
+        f->k = k;
+        return 0;
+    }
+    bloom_free(f);
+    return bloom_init(f, bits, k);
+}
+
+static inline void bloom_set(BloomFilter *f, uint32_t pos, int on) {
+    if (pos >= f->bits)
+        return;
+    if (on)
+        f->map[pos / 8] |= (uint8_t)(1u << (pos % 8));
+    else
+        f->map[pos / 8] &= (uint8_t)~(1u << (pos % 8));
+}
+
+static inline int bloom_get(const BloomFilter *f, uint32_t pos) {
+    return pos < f->bits && (f->map[pos / 8] & (1u << (pos % 8)));
+}
+
+// 1 se o nome pode estar no conjunto (falsos positivos possíveis)
+static inline int bloom_test(const BloomFilter *f, uint32_t h1, uint32_t h2) {
+    uint32_t pos[BLOOM_MAX_K];
+    if (f->map == NULL)
+        return 0;
+    bloom_positions(h1, h2, f->bits, f->k, pos);
+    for (int i = 0; i < f->k; i++)
+        if (!(f->map[pos[i] / 8] & (1u << (pos[i] % 8))))
+            return 0;
+    return 1;
+}
+
+// Filtro com contadores (nomes locais), que permite remover nomes
+typedef struct {
+    uint32_t bits;
+    int k;
+    uint8_t *count;      // contadores saturam em 255 e deixam de descer
+    unsigned long names;
+} BloomCounter;
+
+// Chamado para cada posição que mudou (on = passou a 1 / passou a 0)
+typedef void (*bloom_change_cb)(uint32_t pos, int on, void *arg);
+
+static inline int bloom_counter_init(BloomCounter *c, uint32_t bits, int k) {
+    c->count = calloc(bits, 1);
+    if (c->count == NULL)
+        return -1;
+    c->bits = bits;
+    c->k = k;
+    c->names = 0;
+    return 0;
+}
+
+static inline void bloom_counter_free(BloomCounter *c) {
+    free(c->count);
+    memset(c, 0, sizeof(*c));
+}
+
+static inline void bloom_counter_add(BloomCounter *c, uint32_t h1, uint32_t h2,
+                                     bloom_change_cb cb, void *arg) {
+    uint32_t pos[BLOOM_MAX_K];
+    bloom_positions(h1, h2, c->bits, c->k, pos);
+    for (int i = 0; i < c->k; i++) {
+        uint8_t *n = &c->count[pos[i]];
+        if (*n == 255)
+            continue;
+        if ((*n)++ == 0 && cb)
+            cb(pos[i], 1, arg);
+    }
+    c->names++;
+}
+
+static inline void bloom_counter_del(BloomCounter *c, uint32_t h1, uint32_t h2,
+                                     bloom_change_cb cb, void *arg) {
+    uint32_t pos[BLOOM_MAX_K];
+    bloom_positions(h1, h2, c->bits, c->k, pos);
+    for (int i = 0; i < c->k; i++) {
+        uint8_t *n = &c->count[pos[i]];
+        if (*n == 0 || *n == 255)
+            continue;
+        if (--(*n) == 0 && cb)
+            cb(pos[i], 0, arg);
+    }
+    if (c->names > 0)
+        c->names--;
+}
+
+static inline int bloom_counter_isset(const BloomCounter *c, uint32_t pos) {
+    return c->count[pos] != 0;
+}
+
+#endif
@@ -0,0 +1,136 @@
+// bloom_bench.c
+//
+// Taxa de falsos positivos dos resumos de Bloom (bloom.h), medida contra a
+// teórica:
+//
+//   gcc -O2 -o bloom_bench bloom_bench.c -lm
+//   ./bloom_bench [nomes ausentes]
+//
+// Para cada tamanho m, número de hashes k e número de nomes n, os n nomes
+// entram num BloomCounter como os nomes locais do ndn6, e cada posição que
+// passa a 1 é ligada num BloomFilter, como no vizinho que recebe os
+// DIGESTSET. Depois testam-se 10^6 nomes (por omissão) que não foram
+// inseridos. A taxa esperada é (1 - e^(-kn/m))^k. Também se verifica que:
+//
+//   - todos os nomes inseridos dão positivo (sem falsos negativos)
+//   - inserir mais n nomes e removê-los deixa o filtro como estava
+//
+// As quatro primeiras linhas usam a configuração do ndn6 (BLOOM_BITS e
+// BLOOM_K, as opções -b e -k por omissão). Termina com 1 se houver falsos
+// negativos, se as remoções não repuserem o filtro ou se a taxa medida
+// passar de 1,5 vezes a teórica (sinal de hashes mal distribuídos).
+
+#include <math.h>
+#include <time.h>
+
+#include "name.h"
+#include "bloom.h"
+
+typedef struct {
+    uint32_t bits;
+    int k;
+    int n;
+} BbConfig;
+
+static const BbConfig bbConfigs[] = {
+    {BLOOM_BITS, BLOOM_K, 250},
+    {BLOOM_BITS, BLOOM_K, 500},
+    {BLOOM_BITS, BLOOM_K, 1000},
+    {BLOOM_BITS, BLOOM_K, 2000},
+    {BLOOM_BITS, 6, 1000},
+    {16384, 4, 2000},
+    {65536, 6, 5000},
+};
+
+static double bb_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Posição alterada no resumo local: liga-a ou desliga-a no do vizinho
+static void bb_changed(uint32_t pos, int on, void *arg) {
+    bloom_set(arg, pos, on);
+}
+
+static void bb_name(NameView *nv, char *buf, size_t size, const char *prefix, long i) {
+    snprintf(buf, size, "%s%ld", prefix, i);
+    name_view(nv, buf);
+}
+
+// Corre uma configuração; devolve 1 se alguma verificação falhou
+static int bb_run(const BbConfig *c, long absent) {
+    BloomCounter local;
+    BloomFilter peer, before;
+    char buf[32];
+    NameView nv;
+    if (bloom_counter_init(&local, c->bits, c->k) < 0 || bloom_init(&peer, c->bits, c->k) < 0 ||
+        bloom_init(&before, c->bits, c->k) < 0) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < c->n; i++) {
+        bb_name(&nv, buf, sizeof(buf), "obj", i);
+        bloom_counter_add(&local, nv.hash, nv.hash2, bb_changed, &peer);
+    }
+    long negatives = 0;
+    for (int i = 0; i < c->n; i++) {
+        bb_name(&nv, buf, sizeof(buf), "obj", i);
+        negatives += !bloom_test(&peer, nv.hash, nv.hash2);
+    }
+
+    // Mais n nomes que entram e saem: os contadores repõem os bits
+    memcpy(before.map, peer.map, (c->bits + 7) / 8);
+    for (int i = 0; i < c->n; i++) {
+        bb_name(&nv, buf, sizeof(buf), "tmp", i);
+        bloom_counter_add(&local, nv.hash, nv.hash2, bb_changed, &peer);
+    }
+    for (int i = 0; i < c->n; i++) {
+        bb_name(&nv, buf, sizeof(buf), "tmp", i);
+        bloom_counter_del(&local, nv.hash, nv.hash2, bb_changed, &peer);
+    }
+    int restored = memcmp(before.map, peer.map, (c->bits + 7) / 8) == 0;
+
+    // Os nomes ausentes são preparados antes de medir o tempo do teste
+    NameView *miss = malloc((size_t)absent * sizeof(*miss));
+    char *pool = malloc((size_t)absent * 16);
+    if (miss == NULL || pool == NULL) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (long i = 0; i < absent; i++)
+        bb_name(&miss[i], pool + (size_t)i * 16, 16, "miss", i);
+    long fp = 0;
+    double t0 = bb_now();
+    for (long i = 0; i < absent; i++)
+        fp += bloom_test(&peer, miss[i].hash, miss[i].hash2);
+    double ns = (bb_now() - t0) * 1e9 / (double)absent;
+
+    double rate = (double)fp / (double)absent;
+    double expected = pow(1 - exp(-(double)c->k * c->n / c->bits), c->k);
+    int bad = negatives > 0 || !restored || rate > 1.5 * expected + 1e-4;
+    printf("%6u  %2d  %5d   %7.3f%%   %7.3f%%   %5.1f ns   %s\n", c->bits, c->k, c->n,
+           100 * rate, 100 * expected, ns,
+           negatives ? "falsos negativos" : !restored ? "remoções não repõem o filtro"
+                                          : bad ? "acima do esperado" : "ok");
+    free(miss);
+    free(pool);
+    bloom_counter_free(&local);
+    bloom_free(&peer);
+    bloom_free(&before);
+    return bad;
+}
+
+int main(int argc, char *argv[]) {
+    long absent = argc > 1 ? atol(argv[1]) : 1000000;
+    if (absent <= 0) {
+        fprintf(stderr, "Uso: %s [nomes ausentes]\n", argv[0]);
+        return 2;
+    }
+    printf("%ld nomes ausentes por configuração\n", absent);
+    printf("     m   k      n    medida    teórica   teste\n");
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(bbConfigs) / sizeof(bbConfigs[0]); i++)
+        failed |= bb_run(&bbConfigs[i], absent);
+    return failed;
+}
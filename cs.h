@@ -0,0 +1,720 @@
+#ifndef CS_H
+#define CS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "name.h"
+#include "sketch.h"
+
+/*
+ * Content Store: cache dos objetos que passam pelo nó, com a capacidade
+ * dada no argumento cache da linha de comando.
+ *
+ * Todas as entradas vivem num único bloco (slab) reservado no arranque,
+ * juntamente com a tabela de dispersão; não há malloc por objeto.
+ * As entradas ligam-se por índices em listas intrusivas:
+ *
+ *   hnext        cadeia do bucket da tabela de dispersão (ou lista livre)
+ *   prev / next  uma das duas listas da política (lists[list]), da mais
+ *                recente (head) à menos recente (tail)
+ *
+ * A escolha do objeto a remover quando a cache está cheia é feita por uma
+ * política (CsPolicy) escolhida no arranque: LRU, CLOCK, S3-FIFO ou ARC.
+ * S3-FIFO e ARC lembram-se também dos hashes de objetos removidos há pouco
+ * (entradas fantasma, CsGhost), sem o nome.
+ * Procura, inserção e remoção são O(1) (amortizado no CLOCK e no S3-FIFO).
+ * Com capacidade 0 a cache fica desligada.
+ *
+ * Com a admissão TinyLFU (cs_enable_tinylfu) cada procura conta num
+ * count-min sketch e, com a cache cheia, um objeto novo só entra se a sua
+ * frequência estimada for maior do que a da vítima que a política
+ * escolheria; os objetos vistos uma só vez deixam de expulsar os populares.
+ */
+
+#define CS_NIL (-1)
+#define CS_LISTS 2
+#define CS_FREQ_MAX 3    // contador de acessos do S3-FIFO
+#define CS_SKETCH_WIDTH 4096  // contadores por linha do sketch TinyLFU (8 KB)
+
+typedef struct {
+    char name[NDN_NAME_MAX + 1];
+    uint8_t list;        // lista da política onde está
+    uint8_t ref;         // bit de referência (CLOCK) ou frequência (S3-FIFO)
+    uint32_t hash;
+    int32_t hnext;
+    int32_t prev, next;
+} CsEntry;
+
+typedef struct {
+    int32_t head, tail;
+    int len;
+} CsList;
+
+// Entradas fantasma: só o hash, em até duas listas, com a sua própria tabela
+typedef struct {
+    uint32_t hash;
+    uint8_t list;
+    int32_t hnext;
+    int32_t prev, next;
+} CsGhostNode;
+
+typedef struct {
+    CsGhostNode *nodes;
+    int32_t *buckets;
+    uint32_t mask;
+    int32_t free;
+    int capacity;
+    CsList lists[CS_LISTS];
+} CsGhost;
+
+typedef struct {
+    unsigned long lookups;
+    unsigned long hits;
+    unsigned long inserts;
+    unsigned long evictions;
+    unsigned long rejected;      // objetos recusados pela admissão TinyLFU
+} CsStats;
+
+typedef struct ContentStore ContentStore;
+
+// Operações de uma política de remoção
+typedef struct {
+    const char *name;
+    int ghosts;                    // capacidade fantasma, em frações de capacity/10
+    void (*hit)(ContentStore *cs, int32_t i);
+    // Nome novo com hash h: prepara a inserção e, com a cache cheia, tira
+    // das listas a entrada a remover e devolve-a (CS_NIL se não houver)
+    int32_t (*miss)(ContentStore *cs, uint32_t h);
+    void (*admit)(ContentStore *cs, int32_t i);   // entrada nova i, já na tabela
+    void (*remove)(ContentStore *cs, int32_t i);  // remoção explícita
+    // Entrada que miss() escolheria agora, sem mudar nada (para a admissão)
+    int32_t (*victim)(const ContentStore *cs);
+} CsPolicy;
+
+struct ContentStore {
+    int capacity;
+    int count;
+    CsEntry *slab;
+    int32_t *buckets;
+    uint32_t mask;        // número de buckets - 1 (potência de 2)
+    int32_t free;
+    CsList lists[CS_LISTS];
+    const CsPolicy *policy;
+    CsGhost ghost;
+    int admit_list;       // lista onde admit() põe a próxima entrada
+    int small;            // S3-FIFO: tamanho alvo da fila pequena
+    int arc_p;            // ARC: tamanho alvo de T1
+    CountMin *sketch;     // frequências da admissão TinyLFU (NULL: desligada)
+    CsStats stats;
+};
+
+/* ---------- listas ---------- */
+
+static inline void cs_list_init(CsList *l) {
+    l->head = l->tail = CS_NIL;
+    l->len = 0;
+}
+
+static inline void cs_list_unlink(ContentStore *cs, int32_t i) {
+    CsEntry *e = &cs->slab[i];
+    CsList *l = &cs->lists[e->list];
+    if (e->prev != CS_NIL) cs->slab[e->prev].next = e->next; else l->head = e->next;
+    if (e->next != CS_NIL) cs->slab[e->next].prev = e->prev; else l->tail = e->prev;
+    l->len--;
+}
+
+static inline void cs_list_push(ContentStore *cs, int list, int32_t i) {
+    CsEntry *e = &cs->slab[i];
+    CsList *l = &cs->lists[list];
+    e->list = (uint8_t)list;
+    e->prev = CS_NIL;
+    e->next = l->head;
+    if (l->head != CS_NIL) cs->slab[l->head].prev = i; else l->tail = i;
+    l->head = i;
+    l->len++;
+}
+
+// Tira a entrada menos recente da lista e devolve-a
+static inline int32_t cs_list_pop(ContentStore *cs, int list) {
+    int32_t i = cs->lists[list].tail;
+    if (i != CS_NIL)
+        cs_list_unlink(cs, i);
+    return i;
+}
+
+/* ---------- entradas fantasma ---------- */
+
+static inline int cs_ghost_init(CsGhost *g, int capacity) {
+    memset(g, 0, sizeof(*g));
+    g->free = CS_NIL;
+    for (int l = 0; l < CS_LISTS; l++)
+        cs_list_init(&g->lists[l]);
+    if (capacity <= 0)
+        return 0;
+    uint32_t nb = 1;
+    while (nb < (uint32_t)capacity * 2)
+        nb <<= 1;
+    char *mem = malloc((size_t)capacity * sizeof(CsGhostNode) + nb * sizeof(int32_t));
+    if (mem == NULL)
+        return -1;
+    g->nodes = (CsGhostNode *)mem;
+    g->buckets = (int32_t *)(mem + (size_t)capacity * sizeof(CsGhostNode));
+    g->mask = nb - 1;
+    g->capacity = capacity;
+    for (uint32_t i = 0; i < nb; i++)
+        g->buckets[i] = CS_NIL;
+    for (int i = capacity - 1; i >= 0; i--) {
+        g->nodes[i].hnext = g->free;
+        g->free = i;
+    }
+    return 0;
+}
+
+static inline int32_t cs_ghost_find(const CsGhost *g, uint32_t h) {
+    if (g->capacity == 0)
+        return CS_NIL;
+    int32_t i = g->buckets[h & g->mask];
+    while (i != CS_NIL && g->nodes[i].hash != h)
+        i = g->nodes[i].hnext;
+    return i;
+}
+
+static inline void cs_ghost_remove(CsGhost *g, int32_t i) {
+    CsGhostNode *n = &g->nodes[i];
+    int32_t *l = &g->buckets[n->hash & g->mask];
+    while (*l != i)
+        l = &g->nodes[*l].hnext;
+    *l = n->hnext;
+    CsList *list = &g->lists[n->list];
+    if (n->prev != CS_NIL) g->nodes[n->prev].next = n->next; else list->head = n->next;
+    if (n->next != CS_NIL) g->nodes[n->next].prev = n->prev; else list->tail = n->prev;
+    list->len--;
+    n->hnext = g->free;
+    g->free = i;
+}
+
+// Esquece o fantasma mais antigo da lista
+static inline void cs_ghost_drop(CsGhost *g, int list) {
+    if (g->lists[list].tail != CS_NIL)
+        cs_ghost_remove(g, g->lists[list].tail);
+}
+
+// Novo fantasma na cabeça da lista; sem espaço sai o mais antigo
+static inline void cs_ghost_push(CsGhost *g, int list, uint32_t h) {
+    if (g->capacity == 0)
+        return;
+    if (g->free == CS_NIL)
+        cs_ghost_drop(g, g->lists[list].len > 0 ? list : !list);
+    int32_t i = g->free;
+    CsGhostNode *n = &g->nodes[i];
+    g->free = n->hnext;
+    n->hash = h;
+    n->list = (uint8_t)list;
+    int32_t *b = &g->buckets[h & g->mask];
+    n->hnext = *b;
+    *b = i;
+    CsList *l = &g->lists[list];
+    n->prev = CS_NIL;
+    n->next = l->head;
+    if (l->head != CS_NIL) g->nodes[l->head].prev = i; else l->tail = i;
+    l->head = i;
+    l->len++;
+}
+
+/* ---------- LRU: uma lista, acerto passa para a cabeça ---------- */
+
+static inline void cs_lru_hit(ContentStore *cs, int32_t i) {
+    cs_list_unlink(cs, i);
+    cs_list_push(cs, 0, i);
+}
+
+static inline int32_t cs_lru_miss(ContentStore *cs, uint32_t h) {
+    (void)h;
+    return cs->free == CS_NIL ? cs_list_pop(cs, 0) : CS_NIL;
+}
+
+static inline void cs_lru_admit(ContentStore *cs, int32_t i) {
+    cs_list_push(cs, 0, i);
+}
+
+static inline void cs_list_remove(ContentStore *cs, int32_t i) {
+    cs_list_unlink(cs, i);
+}
+
+static inline int32_t cs_lru_victim(const ContentStore *cs) {
+    return cs->lists[0].tail;
+}
+
+/* ---------- CLOCK: FIFO com segunda oportunidade pelo bit de referência ---------- */
+
+static inline void cs_clock_hit(ContentStore *cs, int32_t i) {
+    cs->slab[i].ref = 1;
+}
+
+static inline int32_t cs_clock_miss(ContentStore *cs, uint32_t h) {
+    (void)h;
+    if (cs->free != CS_NIL)
+        return CS_NIL;
+    for (;;) {
+        int32_t i = cs_list_pop(cs, 0);
+        if (!cs->slab[i].ref)
+            return i;
+        cs->slab[i].ref = 0;
+        cs_list_push(cs, 0, i);
+    }
+}
+
+// Primeira entrada sem referência a partir do ponteiro; para não percorrer
+// a cache toda só se olha para as CS_CLOCK_PEEK seguintes
+#define CS_CLOCK_PEEK 8
+
+static inline int32_t cs_clock_victim(const ContentStore *cs) {
+    int32_t i = cs->lists[0].tail;
+    for (int n = 0; i != CS_NIL && n < CS_CLOCK_PEEK; n++, i = cs->slab[i].prev)
+        if (!cs->slab[i].ref)
+            return i;
+    return cs->lists[0].tail;
+}
+
+static inline void cs_clock_admit(ContentStore *cs, int32_t i) {
+    cs->slab[i].ref = 0;
+    cs_list_push(cs, 0, i);
+}
+
+/*
+ * ---------- S3-FIFO ----------
+ * Fila pequena S (lists[0], 10% da capacidade), fila principal M (lists[1])
+ * e fila fantasma G com os hashes que saíram de S sem serem usados. Um
+ * objeto novo entra em S, ou em M se estiver em G. Ao sair de S passa para
+ * M se foi acedido entretanto; em M tem tantas voltas extra quantos os
+ * acessos (até CS_FREQ_MAX).
+ */
+
+#define CS_S3_SMALL 0
+#define CS_S3_MAIN  1
+
+static inline void cs_s3_hit(ContentStore *cs, int32_t i) {
+    if (cs->slab[i].ref < CS_FREQ_MAX)
+        cs->slab[i].ref++;
+}
+
+static inline int32_t cs_s3_miss(ContentStore *cs, uint32_t h) {
+    int32_t g = cs_ghost_find(&cs->ghost, h);
+    cs->admit_list = CS_S3_SMALL;
+    if (g != CS_NIL) {
+        cs_ghost_remove(&cs->ghost, g);
+        cs->admit_list = CS_S3_MAIN;
+    }
+    if (cs->free != CS_NIL)
+        return CS_NIL;
+    for (;;) {
+        if (cs->lists[CS_S3_SMALL].len >= cs->small || cs->lists[CS_S3_MAIN].len == 0) {
+            int32_t i = cs_list_pop(cs, CS_S3_SMALL);
+            if (cs->slab[i].ref == 0) {
+                cs_ghost_push(&cs->ghost, 0, cs->slab[i].hash);
+                return i;
+            }
+            cs->slab[i].ref = 0;
+            cs_list_push(cs, CS_S3_MAIN, i);
+        } else {
+            int32_t i = cs_list_pop(cs, CS_S3_MAIN);
+            if (cs->slab[i].ref == 0)
+                return i;
+            cs->slab[i].ref--;
+            cs_list_push(cs, CS_S3_MAIN, i);
+        }
+    }
+}
+
+// Aproximação: a cauda da fila que miss() trataria primeiro
+static inline int32_t cs_s3_victim(const ContentStore *cs) {
+    if (cs->lists[CS_S3_SMALL].len >= cs->small || cs->lists[CS_S3_MAIN].len == 0)
+        return cs->lists[CS_S3_SMALL].tail;
+    return cs->lists[CS_S3_MAIN].tail;
+}
+
+static inline void cs_s3_admit(ContentStore *cs, int32_t i) {
+    cs->slab[i].ref = 0;
+    cs_list_push(cs, cs->admit_list, i);
+}
+
+/*
+ * ---------- ARC (Megiddo e Modha) ----------
+ * T1 (lists[0]) tem os objetos vistos uma vez, T2 (lists[1]) os vistos mais
+ * vezes; B1 e B2 (fantasmas 0 e 1) os que saíram de cada uma. Um acerto em
+ * B1 aumenta o alvo arc_p de T1, um acerto em B2 diminui-o. Como a cache
+ * também aceita remoções explícitas, só se escolhe vítima com a cache cheia.
+ */
+
+#define CS_ARC_T1 0
+#define CS_ARC_T2 1
+
+static inline void cs_arc_hit(ContentStore *cs, int32_t i) {
+    cs_list_unlink(cs, i);
+    cs_list_push(cs, CS_ARC_T2, i);
+}
+
+// Lista de onde REPLACE tira a vítima
+static inline int cs_arc_replace_list(const ContentStore *cs, int in_b2) {
+    int t1 = cs->lists[CS_ARC_T1].len;
+    return (t1 > 0 && ((in_b2 && t1 == cs->arc_p) || t1 > cs->arc_p)) ||
+           cs->lists[CS_ARC_T2].len == 0 ? CS_ARC_T1 : CS_ARC_T2;
+}
+
+// REPLACE: tira o menos recente de T1 ou T2 conforme arc_p e guarda o fantasma
+static inline int32_t cs_arc_replace(ContentStore *cs, int in_b2) {
+    int list = cs_arc_replace_list(cs, in_b2);
+    int32_t i = cs_list_pop(cs, list);
+    cs_ghost_push(&cs->ghost, list, cs->slab[i].hash);
+    return i;
+}
+
+static inline int32_t cs_arc_miss(ContentStore *cs, uint32_t h) {
+    CsGhost *g = &cs->ghost;
+    int c = cs->capacity;
+    int full = cs->free == CS_NIL;
+    int32_t gi = cs_ghost_find(g, h);
+    if (gi != CS_NIL) {
+        int b1 = g->lists[0].len, b2 = g->lists[1].len;
+        int in_b2 = g->nodes[gi].list == 1;
+        if (!in_b2) {
+            int d = b2 / b1 > 1 ? b2 / b1 : 1;
+            cs->arc_p = cs->arc_p + d < c ? cs->arc_p + d : c;
+        } else {
+            int d = b1 / b2 > 1 ? b1 / b2 : 1;
+            cs->arc_p = cs->arc_p - d > 0 ? cs->arc_p - d : 0;
+        }
+        cs_ghost_remove(g, gi);
+        cs->admit_list = CS_ARC_T2;
+        return full ? cs_arc_replace(cs, in_b2) : CS_NIL;
+    }
+    cs->admit_list = CS_ARC_T1;
+    int t1 = cs->lists[CS_ARC_T1].len, t2 = cs->lists[CS_ARC_T2].len;
+    int b1 = g->lists[0].len, b2 = g->lists[1].len;
+    if (t1 + b1 >= c) {
+        if (t1 < c) {
+            cs_ghost_drop(g, 0);
+        } else {
+            // T1 ocupa a cache toda: sai sem deixar fantasma
+            return cs_list_pop(cs, CS_ARC_T1);
+        }
+    } else if (t1 + t2 + b1 + b2 >= 2 * c) {
+        cs_ghost_drop(g, 1);
+    }
+    return full ? cs_arc_replace(cs, 0) : CS_NIL;
+}
+
+static inline void cs_arc_admit(ContentStore *cs, int32_t i) {
+    cs_list_push(cs, cs->admit_list, i);
+}
+
+static inline int32_t cs_arc_victim(const ContentStore *cs) {
+    return cs->lists[cs_arc_replace_list(cs, 0)].tail;
+}
+
+static const CsPolicy cs_policies[] = {
+    {"lru",    0,  cs_lru_hit,   cs_lru_miss,   cs_lru_admit,   cs_list_remove, cs_lru_victim},
+    {"clock",  0,  cs_clock_hit, cs_clock_miss, cs_clock_admit, cs_list_remove, cs_clock_victim},
+    {"s3fifo", 9,  cs_s3_hit,    cs_s3_miss,    cs_s3_admit,    cs_list_remove, cs_s3_victim},
+    {"arc",    10, cs_arc_hit,   cs_arc_miss,   cs_arc_admit,   cs_list_remove, cs_arc_victim},
+};
+
+// Política com o nome dado (NULL se não existir)
+static inline const CsPolicy *cs_policy_find(const char *name) {
+    for (size_t i = 0; i < sizeof(cs_policies) / sizeof(cs_policies[0]); i++)
+        if (strcmp(cs_policies[i].name, name) == 0)
+            return &cs_policies[i];
+    return NULL;
+}
+
+/* ---------- Content Store ---------- */
+
+// policy NULL: LRU
+static inline int cs_init(ContentStore *cs, int capacity, const CsPolicy *policy) {
+    memset(cs, 0, sizeof(*cs));
+    cs->free = CS_NIL;
+    for (int l = 0; l < CS_LISTS; l++)
+        cs_list_init(&cs->lists[l]);
+    cs->policy = policy ? policy : &cs_policies[0];
+    cs_ghost_init(&cs->ghost, 0);
+    if (capacity <= 0)
+        return 0;
+    uint32_t nb = 1;
+    while (nb < (uint32_t)capacity * 2)
+        nb <<= 1;
+    // Entradas e buckets num só bloco
+    char *mem = malloc((size_t)capacity * sizeof(CsEntry) + nb * sizeof(int32_t));
+    int ghosts = (int)((long)capacity * cs->policy->ghosts / 10);
+    if (cs->policy->ghosts > 0 && ghosts < 1)
+        ghosts = 1;
+    if (mem == NULL || cs_ghost_init(&cs->ghost, ghosts) < 0) {
+        perror("Erro ao reservar a cache");
+        free(mem);
+        return -1;
+    }
+    cs->capacity = capacity;
+    cs->slab = (CsEntry *)mem;
+    cs->buckets = (int32_t *)(mem + (size_t)capacity * sizeof(CsEntry));
+    cs->mask = nb - 1;
+    cs->small = capacity / 10 > 0 ? capacity / 10 : 1;
+    for (uint32_t i = 0; i < nb; i++)
+        cs->buckets[i] = CS_NIL;
+    for (int i = capacity - 1; i >= 0; i--) {
+        cs->slab[i].hnext = cs->free;
+        cs->free = i;
+    }
+    return 0;
+}
+
+// Liga a admissão TinyLFU: sketch com um contador por entrada da cache em
+// cada linha, até CS_SKETCH_WIDTH (2 * CS_SKETCH_WIDTH bytes no total),
+// envelhecido a cada 10 * width procuras
+static inline int cs_enable_tinylfu(ContentStore *cs) {
+    if (cs->capacity == 0)
+        return 0;
+    uint32_t width = cs->capacity < CS_SKETCH_WIDTH ? (uint32_t)cs->capacity : CS_SKETCH_WIDTH;
+    cs->sketch = malloc(sizeof(CountMin));
+    if (cs->sketch == NULL || sketch_init(cs->sketch, width, 0) < 0) {
+        perror("Erro ao reservar o filtro de admissão");
+        free(cs->sketch);
+        cs->sketch = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static inline void cs_destroy(ContentStore *cs) {
+    if (cs->sketch != NULL)
+        sketch_free(cs->sketch);
+    free(cs->sketch);
+    free(cs->slab);
+    free(cs->ghost.nodes);
+    memset(cs, 0, sizeof(*cs));
+}
+
+// Índice da entrada com o nome dado; *link aponta para a ligação que a refere
+static inline int32_t cs_find(ContentStore *cs, const NameView *nv, int32_t **link) {
+    int32_t *l = &cs->buckets[nv->hash & cs->mask];
+    while (*l != CS_NIL) {
+        CsEntry *e = &cs->slab[*l];
+        if (e->hash == nv->hash && name_view_eq(nv, e->name))
+            break;
+        l = &e->hnext;
+    }
+    if (link)
+        *link = l;
+    return *l;
+}
+
+// Retira da tabela a entrada i (já fora das listas da política) e
+// devolve-a à lista livre
+static inline void cs_release(ContentStore *cs, int32_t i) {
+    int32_t *link = &cs->buckets[cs->slab[i].hash & cs->mask];
+    while (*link != i)
+        link = &cs->slab[*link].hnext;
+    *link = cs->slab[i].hnext;
+    cs->slab[i].hnext = cs->free;
+    cs->free = i;
+    cs->count--;
+}
+
+// 1 se o objeto estiver na cache (conta como acesso para a política)
+static inline int cs_lookup(ContentStore *cs, const NameView *nv) {
+    if (cs->capacity == 0)
+        return 0;
+    cs->stats.lookups++;
+    if (cs->sketch != NULL)
+        sketch_add(cs->sketch, nv->hash);
+    int32_t i = cs_find(cs, nv, NULL);
+    if (i == CS_NIL)
+        return 0;
+    cs->stats.hits++;
+    cs->policy->hit(cs, i);
+    return 1;
+}
+
+// Guarda o objeto; se a cache estiver cheia sai o escolhido pela política,
+// cujo nome é copiado para evicted (se não for NULL; "" se nada saiu).
+// Devolve 1 se o objeto entrou, 0 se já estava, foi recusado pela admissão
+// ou a cache está desligada.
+static inline int cs_insert(ContentStore *cs, const NameView *nv, char *evicted) {
+    if (evicted)
+        evicted[0] = '\0';
+    if (cs->capacity == 0)
+        return 0;
+    uint32_t h = nv->hash;
+    int32_t *link;
+    int32_t i = cs_find(cs, nv, &link);
+    if (i != CS_NIL) {
+        cs->policy->hit(cs, i);
+        return 0;
+    }
+    if (cs->sketch != NULL && cs->free == CS_NIL) {
+        int32_t v = cs->policy->victim(cs);
+        if (sketch_estimate(cs->sketch, h) <= sketch_estimate(cs->sketch, cs->slab[v].hash)) {
+            cs->stats.rejected++;
+            return 0;
+        }
+    }
+    int32_t victim = cs->policy->miss(cs, h);
+    if (victim != CS_NIL) {
+        cs->stats.evictions++;
+        if (evicted)
+            memcpy(evicted, cs->slab[victim].name, sizeof(cs->slab[0].name));
+        cs_release(cs, victim);
+        cs_find(cs, nv, &link);  // a cadeia pode ter mudado
+    }
+    i = cs->free;
+    CsEntry *e = &cs->slab[i];
+    cs->free = e->hnext;
+    name_view_copy(e->name, nv);
+    e->hash = h;
+    e->hnext = CS_NIL;
+    *link = i;
+    cs->policy->admit(cs, i);
+    cs->count++;
+    cs->stats.inserts++;
+    return 1;
+}
+
+// Remove o objeto da cache; devolve 1 se existia
+static inline int cs_remove(ContentStore *cs, const NameView *nv) {
+    if (cs->capacity == 0)
+        return 0;
+    int32_t i = cs_find(cs, nv, NULL);
+    if (i == CS_NIL)
+        return 0;
+    cs->policy->remove(cs, i);
+    cs_release(cs, i);
+    return 1;
+}
+
+// Bytes reservados pela cache (entradas, tabela e fantasmas)
+static inline size_t cs_memory(const ContentStore *cs) {
+    if (cs->capacity == 0)
+        return 0;
+    size_t bytes = (size_t)cs->capacity * sizeof(CsEntry) + ((size_t)cs->mask + 1) * sizeof(int32_t);
+    if (cs->ghost.capacity > 0)
+        bytes += (size_t)cs->ghost.capacity * sizeof(CsGhostNode) +
+                 ((size_t)cs->ghost.mask + 1) * sizeof(int32_t);
+    if (cs->sketch != NULL)
+        bytes += sketch_bytes(cs->sketch);
+    return bytes;
+}
+
+// Lista os objetos em cache, lista a lista, do mais recente ao menos recente
+static inline void cs_print(const ContentStore *cs) {
+    printf("Cache %s (%d/%d):\n", cs->policy->name, cs->count, cs->capacity);
+    for (int l = 0; l < CS_LISTS; l++)
+        for (int32_t i = cs->lists[l].head; i != CS_NIL; i = cs->slab[i].next)
+            printf("  %s\n", cs->slab[i].name);
+}
+
+static inline void cs_print_stats(const ContentStore *cs) {
+    printf("Cache %s%s: %d/%d objetos, %lu procuras, %lu acertos, %lu inserções, "
+           "%lu remoções por falta de espaço, %lu recusados, %zu bytes\n",
+           cs->policy->name, cs->sketch ? "+tinylfu" : "", cs->count, cs->capacity,
+           cs->stats.lookups, cs->stats.hits, cs->stats.inserts, cs->stats.evictions,
+           cs->stats.rejected, cs_memory(cs));
+}
+
+/*
+ * Cache negativa: nomes procurados há pouco que não foram encontrados.
+ *
+ * Um NOOBJECT enviado para uma interface só garante que o nome não existe
+ * do lado oposto da árvore, por isso cada entrada guarda também a interface
+ * do pedido (scope); só responde a pedidos vindos dessa interface, ou a
+ * qualquer pedido se a procura cobriu a rede toda (NEG_SCOPE_ALL: retrieve
+ * feito neste nó). As entradas expiram ao fim de ttl_ms e ficam numa tabela
+ * de mapeamento direto com NEG_SLOTS posições (uma colisão substitui a
+ * entrada anterior). Com ttl_ms 0 fica desligada.
+ */
+
+#define NEG_SLOTS     256    // potência de 2
+#define NEG_TTL_MS    2000
+#define NEG_SCOPE_ALL (-1)
+
+typedef struct {
+    char name[NDN_NAME_MAX + 1];
+    uint32_t hash;
+    int scope;
+    long long expires;    // 0 = posição vazia
+} NegEntry;
+
+typedef struct {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long inserts;
+    unsigned long invalidated;   // entradas apagadas porque o nome apareceu
+} NegStats;
+
+typedef struct {
+    NegEntry slots[NEG_SLOTS];
+    int ttl_ms;
+    NegStats stats;
+} NegCache;
+
+static inline void negcache_init(NegCache *nc, int ttl_ms) {
+    memset(nc, 0, sizeof(*nc));
+    nc->ttl_ms = ttl_ms;
+}
+
+static inline NegEntry *negcache_slot(NegCache *nc, uint32_t h) {
+    return &nc->slots[h & (NEG_SLOTS - 1)];
+}
+
+// 1 se um pedido vindo de scope para o nome falhou há menos de ttl_ms
+static inline int negcache_lookup(NegCache *nc, const NameView *nv, int scope, long long now) {
+    if (nc->ttl_ms <= 0)
+        return 0;
+    NegEntry *e = negcache_slot(nc, nv->hash);
+    if (e->expires != 0 && e->expires <= now)
+        e->expires = 0;
+    if (e->expires == 0 || e->hash != nv->hash || !name_view_eq(nv, e->name) ||
+        (e->scope != NEG_SCOPE_ALL && e->scope != scope)) {
+        nc->stats.misses++;
+        return 0;
+    }
+    nc->stats.hits++;
+    return 1;
+}
+
+static inline void negcache_add(NegCache *nc, const NameView *nv, int scope, long long now) {
+    if (nc->ttl_ms <= 0)
+        return;
+    NegEntry *e = negcache_slot(nc, nv->hash);
+    // Uma falha na rede toda vale mais do que uma falha vista de um só lado
+    if (e->expires > now && e->hash == nv->hash && name_view_eq(nv, e->name) &&
+        e->scope == NEG_SCOPE_ALL)
+        scope = NEG_SCOPE_ALL;
+    name_view_copy(e->name, nv);
+    e->hash = nv->hash;
+    e->scope = scope;
+    e->expires = now + nc->ttl_ms;
+    nc->stats.inserts++;
+}
+
+// O nome passou a existir (create ou OBJECT recebido)
+static inline void negcache_remove(NegCache *nc, const NameView *nv) {
+    NegEntry *e = negcache_slot(nc, nv->hash);
+    if (e->expires != 0 && e->hash == nv->hash && name_view_eq(nv, e->name)) {
+        e->expires = 0;
+        nc->stats.invalidated++;
+    }
+}
+
+// A topologia mudou: as falhas anteriores podem já não valer
+static inline void negcache_clear(NegCache *nc) {
+    for (int i = 0; i < NEG_SLOTS; i++)
+        nc->slots[i].expires = 0;
+}
+
+static inline void negcache_print_stats(const NegCache *nc) {
+    printf("Cache negativa: %lu acertos, %lu falhas, %lu inserções, %lu invalidações\n",
+           nc->stats.hits, nc->stats.misses, nc->stats.inserts, nc->stats.invalidated);
+}
+
+#endif
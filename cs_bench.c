@@ -0,0 +1,156 @@
+// cs_bench.c
+//
+// Taxa de acertos, custo e memória das políticas da Content Store (cs.h)
+// num traço sintético:
+//
+//   gcc -O2 -o cs_bench cs_bench.c -lm
+//   ./cs_bench [alfa] [rajadas (0/1)] [pedidos]
+//
+// O traço tem 4M pedidos (por omissão) sobre 200k nomes com popularidade
+// Zipf de parâmetro alfa (0,9 por omissão). A ordem de popularidade é
+// baralhada para não coincidir com a dos hashes. Com rajadas, a cada 100k
+// pedidos entram 10k nomes novos pedidos uma só vez (um varrimento, que
+// expulsa os populares de uma LRU). Cada pedido é um cs_lookup() seguido
+// de cs_insert() na falta, como no ndn6 quando chega o OBJECT.
+//
+// Corre lru, clock, s3fifo e arc, com e sem a admissão TinyLFU, para
+// caches de 100, 1000, 10000 e 50000 objetos, e mostra a taxa de acertos,
+// os nanossegundos por pedido e os bytes reservados por entrada da cache.
+// Termina com 1 se as listas de alguma política não baterem certo com o
+// número de objetos guardados.
+
+#include <math.h>
+#include <time.h>
+
+#include "cs.h"
+
+#define CB_NAMES  200000
+#define CB_SCAN   10000     // nomes de cada rajada
+#define CB_PERIOD 100000    // pedidos entre rajadas
+
+static const char *cbPolicies[] = {"lru", "clock", "s3fifo", "arc"};
+static const int cbSizes[] = {100, 1000, 10000, 50000};
+
+static double cb_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Nomes do traço: os populares e os das rajadas, com o NameView já feito
+// (no ndn6 vem da análise da mensagem)
+static NameView *cb_names(int n, const char *prefix) {
+    NameView *nv = malloc((size_t)n * sizeof(*nv));
+    char *pool = malloc((size_t)n * 16);
+    if (nv == NULL || pool == NULL) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < n; i++) {
+        snprintf(pool + (size_t)i * 16, 16, "%s%d", prefix, i);
+        name_view(&nv[i], pool + (size_t)i * 16);
+    }
+    return nv;
+}
+
+// Traço com pedidos Zipf e, se scans, rajadas de nomes vistos uma vez
+static const NameView **cb_trace(long n, double alpha, int scans, NameView *hot,
+                                 NameView *cold, int ncold) {
+    const NameView **trace = malloc((size_t)n * sizeof(*trace));
+    double *cdf = malloc(CB_NAMES * sizeof(*cdf));
+    if (trace == NULL || cdf == NULL) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    double sum = 0;
+    for (int i = 0; i < CB_NAMES; i++) {
+        sum += 1 / pow(i + 1, alpha);
+        cdf[i] = sum;
+    }
+    uint64_t x = 88172645463325252ull;
+    int scan = 0;
+    for (long r = 0; r < n;) {
+        if (scans && r > 0 && r % CB_PERIOD == 0) {
+            for (int j = 0; j < CB_SCAN && r < n; j++)
+                trace[r++] = &cold[scan++ % ncold];
+            continue;
+        }
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        double u = (double)(x >> 11) / (double)(1ull << 53) * sum;
+        int lo = 0, hi = CB_NAMES - 1;
+        while (lo < hi) {
+            int m = (lo + hi) / 2;
+            if (cdf[m] < u)
+                lo = m + 1;
+            else
+                hi = m;
+        }
+        trace[r++] = &hot[((unsigned)lo * 2654435761u) % CB_NAMES];
+    }
+    free(cdf);
+    return trace;
+}
+
+// Objetos nas listas da política e na tabela
+static int cb_consistent(const ContentStore *cs) {
+    int listed = 0;
+    for (int l = 0; l < CS_LISTS; l++)
+        listed += cs->lists[l].len;
+    return listed == cs->count && cs->count <= cs->capacity;
+}
+
+int main(int argc, char *argv[]) {
+    double alpha = argc > 1 ? atof(argv[1]) : 0.9;
+    int scans = argc > 2 ? atoi(argv[2]) : 1;
+    long n = argc > 3 ? atol(argv[3]) : 4000000;
+    if (alpha <= 0 || n <= 0) {
+        fprintf(stderr, "Uso: %s [alfa] [rajadas (0/1)] [pedidos]\n", argv[0]);
+        return 2;
+    }
+    int ncold = (int)(n / CB_PERIOD + 1) * CB_SCAN;
+    NameView *hot = cb_names(CB_NAMES, "o");
+    NameView *cold = cb_names(ncold, "scan");
+    const NameView **trace = cb_trace(n, alpha, scans, hot, cold, ncold);
+    printf("%ld pedidos, %d nomes, Zipf alfa %.2f, %s\n", n, CB_NAMES, alpha,
+           scans ? "rajadas de 10k nomes a cada 100k pedidos" : "sem rajadas");
+    printf("acertos / ns por pedido / bytes por entrada\n");
+
+    int failed = 0;
+    int npol = (int)(sizeof(cbPolicies) / sizeof(cbPolicies[0]));
+    for (size_t s = 0; s < sizeof(cbSizes) / sizeof(cbSizes[0]); s++) {
+        printf("cache %d\n", cbSizes[s]);
+        for (int p = 0; p < npol; p++) {
+            for (int tlfu = 0; tlfu < 2; tlfu++) {
+                ContentStore cs;
+                if (cs_init(&cs, cbSizes[s], cs_policy_find(cbPolicies[p])) < 0 ||
+                    (tlfu && cs_enable_tinylfu(&cs) < 0))
+                    return EXIT_FAILURE;
+                long hits = 0;
+                double t0 = cb_now();
+                for (long r = 0; r < n; r++) {
+                    if (cs_lookup(&cs, trace[r]))
+                        hits++;
+                    else
+                        cs_insert(&cs, trace[r], NULL);
+                }
+                double t1 = cb_now();
+                if (!cb_consistent(&cs)) {
+                    printf("  %s: %d objetos, listas inconsistentes\n", cbPolicies[p], cs.count);
+                    failed = 1;
+                }
+                printf("  %-6s%-9s %6.2f%%  %6.1f ns  %6.1f bytes\n", cbPolicies[p],
+                       tlfu ? "+tinylfu" : "", 100.0 * (double)hits / (double)n,
+                       (t1 - t0) * 1e9 / (double)n, (double)cs_memory(&cs) / cs.capacity);
+                cs_destroy(&cs);
+            }
+        }
+    }
+    free(trace);
+    free((void *)hot[0].name);
+    free(hot);
+    free((void *)cold[0].name);
+    free(cold);
+    return failed;
+}
@@ -0,0 +1,163 @@
+#ifndef FIB_H
+#define FIB_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "name.h"
+#include "pool.h"
+
+/*
+ * Tabela de encaminhamento aprendida pelo caminho das respostas.
+ *
+ * Quando um OBJECT chega por uma interface, o nome fica associado a essa
+ * interface; os interesses seguintes para o mesmo nome seguem só por ela em
+ * vez de inundarem todos os vizinhos. Uma rota expira ttl_ms depois de ser
+ * aprendida (verificado na procura) e é apagada quando a interface fecha.
+ * As entradas vêm de um pool e o seu número é limitado a FIB_MAX.
+ * Com ttl_ms 0 a tabela fica desligada e os interesses são inundados.
+ */
+
+#define FIB_BUCKETS 1024     // potência de 2
+#define FIB_MAX     4096
+#define FIB_TTL_MS  30000
+
+typedef struct FibEntry {
+    char name[NDN_NAME_MAX + 1];
+    uint32_t hash;
+    int face;
+    long long learned;
+    struct FibEntry *hnext;
+} FibEntry;
+
+typedef struct {
+    unsigned long learned;
+    unsigned long hits;          // interesses encaminhados por uma rota
+    unsigned long expired;
+    unsigned long invalidated;   // rotas apagadas por NOOBJECT ou fecho da interface
+} FibStats;
+
+POOL_TYPED(FibEntryPool, fib_entry_pool, FibEntry)
+
+typedef struct {
+    FibEntry *buckets[FIB_BUCKETS];
+    int count;
+    int ttl_ms;
+    FibEntryPool entries;
+    FibStats stats;
+} Fib;
+
+// arena: origem dos lotes do pool de entradas (NULL para malloc); ttl_ms
+// negativo: FIB_TTL_MS
+static inline void fib_init(Fib *fib, int ttl_ms, Arena *arena) {
+    memset(fib, 0, sizeof(*fib));
+    fib->ttl_ms = ttl_ms >= 0 ? ttl_ms : FIB_TTL_MS;
+    fib_entry_pool_init(&fib->entries, "FIB", arena);
+}
+
+static inline void fib_unlink(Fib *fib, FibEntry **link) {
+    FibEntry *e = *link;
+    *link = e->hnext;
+    fib_entry_pool_free(&fib->entries, e);
+    fib->count--;
+}
+
+static inline void fib_destroy(Fib *fib) {
+    for (int b = 0; b < FIB_BUCKETS; b++)
+        while (fib->buckets[b] != NULL)
+            fib_unlink(fib, &fib->buckets[b]);
+    fib_entry_pool_destroy(&fib->entries);
+}
+
+static inline FibEntry **fib_find(Fib *fib, const NameView *nv) {
+    FibEntry **l = &fib->buckets[nv->hash & (FIB_BUCKETS - 1)];
+    while (*l != NULL && ((*l)->hash != nv->hash || !name_view_eq(nv, (*l)->name)))
+        l = &(*l)->hnext;
+    return l;
+}
+
+// Apaga as rotas expiradas
+static inline void fib_expire(Fib *fib, long long now) {
+    for (int b = 0; b < FIB_BUCKETS; b++) {
+        FibEntry **l = &fib->buckets[b];
+        while (*l != NULL) {
+            if (now - (*l)->learned >= fib->ttl_ms) {
+                fib->stats.expired++;
+                fib_unlink(fib, l);
+            } else {
+                l = &(*l)->hnext;
+            }
+        }
+    }
+}
+
+// Interface aprendida para o nome, ou -1 se não houver rota válida
+static inline int fib_lookup(Fib *fib, const NameView *nv, long long now) {
+    FibEntry **l = fib_find(fib, nv);
+    if (*l == NULL)
+        return -1;
+    if (now - (*l)->learned >= fib->ttl_ms) {
+        fib->stats.expired++;
+        fib_unlink(fib, l);
+        return -1;
+    }
+    return (*l)->face;
+}
+
+static inline void fib_learn(Fib *fib, const NameView *nv, int face, long long now) {
+    if (fib->ttl_ms == 0)
+        return;
+    FibEntry **l = fib_find(fib, nv);
+    FibEntry *e = *l;
+    if (e == NULL) {
+        if (fib->count >= FIB_MAX) {
+            fib_expire(fib, now);
+            if (fib->count >= FIB_MAX)
+                return;
+            l = fib_find(fib, nv);
+        }
+        e = fib_entry_pool_alloc(&fib->entries);
+        if (e == NULL)
+            return;
+        name_view_copy(e->name, nv);
+        e->hash = nv->hash;
+        e->hnext = NULL;
+        *l = e;
+        fib->count++;
+    }
+    e->face = face;
+    e->learned = now;
+    fib->stats.learned++;
+}
+
+static inline void fib_remove(Fib *fib, const NameView *nv) {
+    FibEntry **l = fib_find(fib, nv);
+    if (*l != NULL) {
+        fib->stats.invalidated++;
+        fib_unlink(fib, l);
+    }
+}
+
+// Apaga todas as rotas pela interface (vizinho saiu)
+static inline void fib_drop_face(Fib *fib, int face) {
+    for (int b = 0; b < FIB_BUCKETS; b++) {
+        FibEntry **l = &fib->buckets[b];
+        while (*l != NULL) {
+            if ((*l)->face == face) {
+                fib->stats.invalidated++;
+                fib_unlink(fib, l);
+            } else {
+                l = &(*l)->hnext;
+            }
+        }
+    }
+}
+
+static inline void fib_print_stats(const Fib *fib) {
+    printf("Rotas: %d ativas, %lu aprendidas, %lu usadas, %lu expiradas, %lu invalidadas\n",
+           fib->count, fib->stats.learned, fib->stats.hits, fib->stats.expired,
+           fib->stats.invalidated);
+}
+
+#endif
@@ -0,0 +1,134 @@
+// heartbeat_bench.c
+//
+// Tempo que os vizinhos de um nó parado levam a dar a ligação como
+// perdida, com e sem batimentos (opções -h e -m do ndn6):
+//
+//   gcc -O2 -o heartbeat_bench heartbeat_bench.c
+//   ./heartbeat_bench [porta base]
+//
+// Quatro nós no loopback: o 1 liga-se ao 0 e o 2 e o 3 ligam-se ao 1, que
+// fica com três vizinhos. Depois de alguns retrieves (o objeto está no nó
+// 3) o nó 1 recebe SIGSTOP: os sockets continuam abertos, por isso só os
+// batimentos em falta revelam a falha. Para cada configuração, numa rede
+// nova, mostra em cada vizinho o tempo até à linha "sem sinal há N ms",
+// medido por este programa desde o SIGSTOP e o N que o próprio nó mediu
+// desde o último batimento recebido. Sem batimentos a falha não é vista
+// dentro da janela de HB_WINDOW_MS.
+//
+// Termina com 1 se uma configuração com batimentos não detetou a falha em
+// todos os vizinhos, ou se a configuração sem batimentos a detetou.
+
+#define main ndn6_main
+#include "ndn6.c"
+#undef main
+
+#include "simnet.h"
+
+#define HB_NODES     4
+#define HB_VICTIM    1
+#define HB_WINDOW_MS 2000   // depois do SIGSTOP
+#define HB_POLL_MS   5
+
+typedef struct {
+    const char *name;
+    char *opts[5];
+    int detects;   // a falha tem de ser detetada na janela
+} HbMode;
+
+static HbMode hbModes[] = {
+    {"-h 100 -m 3", {"-h", "100", "-m", "3", NULL}, 1},
+    {"-h 200 -m 4", {"-h", "200", "-m", "4", NULL}, 1},
+    {"sem batimentos", {NULL}, 0},
+};
+
+static long long hb_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// N de "sem sinal há N ms", se ainda não foi lido
+static void hb_reported(const char *line, void *arg) {
+    long long *ms = arg;
+    const char *p = strstr(line, "sem sinal há ");
+    if (p != NULL && *ms < 0)
+        sscanf(p + strlen("sem sinal há "), "%lld", ms);
+}
+
+// Corre uma configuração; devolve 1 se a deteção não foi a esperada
+static int hb_run(const HbMode *mode, int base) {
+    sim_registry(base);
+    for (int i = 0; i < HB_NODES; i++)
+        sim_spawn(i, base + 1 + i, base, "0", mode->opts, NULL);
+    if (sim_started(HB_NODES) < 0)
+        exit(2);
+    sim_cmd(0, "dj 010 0.0.0.0 0");
+    sim_sleep_ms(100);
+    sim_cmd(1, "dj 010 127.0.0.1 %d", base + 1);
+    sim_sleep_ms(200);
+    sim_cmd(2, "dj 010 127.0.0.1 %d", base + 2);
+    sim_sleep_ms(100);
+    sim_cmd(3, "dj 010 127.0.0.1 %d", base + 2);
+    sim_sleep_ms(1000);
+    sim_cmd(3, "c obj");
+    sim_sleep_ms(200);
+    for (int k = 0; k < 20; k++) {
+        sim_cmd(0, "r obj");
+        sim_sleep_ms(20);
+    }
+    sim_sleep_ms(500);
+
+    off_t marks[HB_NODES];
+    long long wall[HB_NODES], reported[HB_NODES];
+    int pending = 0;
+    sim_mark_all(HB_NODES, marks);
+    for (int i = 0; i < HB_NODES; i++) {
+        wall[i] = reported[i] = -1;
+        pending += i != HB_VICTIM;
+    }
+    long long t0 = hb_now_ms();
+    sim_kill(HB_VICTIM, SIGSTOP);
+    while (pending > 0 && hb_now_ms() - t0 < HB_WINDOW_MS) {
+        sim_sleep_ms(HB_POLL_MS);
+        for (int i = 0; i < HB_NODES; i++) {
+            if (i == HB_VICTIM || wall[i] >= 0)
+                continue;
+            if (sim_lines(i, marks[i], -1, "sem sinal há", hb_reported, &reported[i]) > 0) {
+                wall[i] = hb_now_ms() - t0;
+                pending--;
+            }
+        }
+    }
+    sim_kill(HB_VICTIM, SIGCONT);
+
+    int detected = 0;
+    for (int i = 0; i < HB_NODES; i++) {
+        if (i == HB_VICTIM)
+            continue;
+        if (wall[i] >= 0) {
+            printf("  nó %d %5lld /%5lld", i, wall[i], reported[i]);
+            detected++;
+        } else {
+            printf("  nó %d   sem deteção", i);
+        }
+    }
+    printf("  %s\n", mode->name);
+    sim_stop(HB_NODES);
+    return mode->detects ? detected < HB_NODES - 1 : detected > 0;
+}
+
+int main(int argc, char *argv[]) {
+    int base = argc > 1 ? atoi(argv[1]) : 47000;
+    int nmodes = (int)(sizeof(hbModes) / sizeof(hbModes[0]));
+    if (base <= 0 || base + nmodes * 100 > 65535) {
+        fprintf(stderr, "Uso: %s [porta base]\n", argv[0]);
+        return 2;
+    }
+    printf("%d nós, SIGSTOP no nó %d (vizinho dos nós 0, 2 e 3), janela de %d ms\n", HB_NODES,
+           HB_VICTIM, HB_WINDOW_MS);
+    printf("ms até \"sem sinal\" em cada vizinho: desde o SIGSTOP / medidos pelo nó\n");
+    int failed = 0;
+    for (int m = 0; m < nmodes; m++)
+        failed |= hb_run(&hbModes[m], base + m * 100);
+    return failed;
+}
@@ -0,0 +1,91 @@
+#ifndef MSGBUF_H
+#define MSGBUF_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "pool.h"
+
+/*
+ * Buffers de mensagens partilhados entre interfaces.
+ *
+ * Uma mensagem que segue por várias interfaces (um interesse inundado, a
+ * resposta às interfaces agregadas numa entrada da PIT) é codificada uma
+ * só vez num MsgBuf, e o mesmo buffer é entregue a todas as sessões.
+ * Com reactor_write_ref() cada fila fica com uma referência e o buffer
+ * volta ao pool quando a última o escreveu; mas as mensagens entre nós são
+ * mais curtas do que REACTOR_OUT_REF_MIN e o reactor copia-as para os
+ * blocos da fila, o que sai mais barato do que um segmento do writev por
+ * mensagem (msgbuf_bench.c). O que se poupa é a codificação por interface.
+ * Os buffers têm tamanho fixo (MSGBUF_SIZE, mais do que a maior mensagem
+ * entre nós, em texto ou binário) e vêm de um Pool, sem malloc por
+ * mensagem.
+ */
+
+#define MSGBUF_SIZE 256
+
+typedef struct MsgBufPool MsgBufPool;
+
+typedef struct {
+    MsgBufPool *owner;
+    uint32_t refs;
+    uint32_t len;
+    char data[MSGBUF_SIZE];
+} MsgBuf;
+
+typedef struct {
+    unsigned long allocs;   // mensagens codificadas
+    unsigned long refs;     // referências entregues a filas de saída
+} MsgBufStats;
+
+struct MsgBufPool {
+    Pool pool;
+    MsgBufStats stats;
+};
+
+// arena: origem dos lotes do pool (NULL para malloc)
+static inline void msgbuf_pool_init(MsgBufPool *mp, Arena *arena) {
+    pool_init_arena(&mp->pool, "mensagens", sizeof(MsgBuf), arena);
+    memset(&mp->stats, 0, sizeof(mp->stats));
+}
+
+static inline void msgbuf_pool_destroy(MsgBufPool *mp) {
+    pool_destroy(&mp->pool);
+}
+
+// Buffer vazio com uma referência (a de quem o pediu), ou NULL sem memória
+static inline MsgBuf *msgbuf_alloc(MsgBufPool *mp) {
+    MsgBuf *b = pool_alloc_raw(&mp->pool);
+    if (b == NULL)
+        return NULL;
+    b->owner = mp;
+    b->refs = 1;
+    b->len = 0;
+    mp->stats.allocs++;
+    return b;
+}
+
+static inline MsgBuf *msgbuf_ref(MsgBuf *b) {
+    b->refs++;
+    b->owner->stats.refs++;
+    return b;
+}
+
+static inline void msgbuf_unref(MsgBuf *b) {
+    if (b != NULL && --b->refs == 0)
+        pool_free(&b->owner->pool, b);
+}
+
+// Para reactor_write_ref(): a fila de saída largou a sua referência
+static inline void msgbuf_release(void *arg) {
+    msgbuf_unref(arg);
+}
+
+static inline void msgbuf_print_stats(const MsgBufPool *mp) {
+    printf("Buffers de mensagens: %lu codificadas, %lu envios partilhados (%.2f por mensagem), "
+           "%lu em uso, %lu reservados\n", mp->stats.allocs, mp->stats.refs,
+           mp->stats.allocs ? (double)mp->stats.refs / mp->stats.allocs : 0.0,
+           mp->pool.in_use, mp->pool.capacity);
+}
+
+#endif
@@ -0,0 +1,183 @@
+// msgbuf_bench.c
+//
+// Custo de uma mensagem enviada a várias interfaces (msgbuf.h e
+// reactor_write_ref), em nanossegundos e alocações por mensagem:
+//
+//   gcc -O2 -o msgbuf_bench msgbuf_bench.c -Wl,--wrap=malloc
+//   ./msgbuf_bench [faces] [iterações]
+//
+// Cada face é um socketpair; em cada iteração seguem 32 mensagens para
+// todas as faces (8 por omissão), o reactor escreve as filas
+// (reactor_out_flush, como no fim de uma iteração do ndn6) e o outro lado
+// de cada face é lido até ficar vazio. Três maneiras de enviar:
+//
+//   por face     snprintf e reactor_write() em cada face (antes do MsgBuf)
+//   cópia        codificada uma vez num MsgBuf e copiada para cada fila
+//   referência   codificada uma vez; reactor_write_ref() põe na fila de
+//                cada face uma referência (out_ref_min a 0)
+//
+// com INTERESTs como os do ndn6 e com cargas de 64 a 1400 bytes. As cargas
+// acima de MSGBUF_SIZE não cabem num MsgBuf e vêm de um buffer estático.
+// Mostra os nanossegundos e as chamadas a malloc por mensagem (todas as
+// faces) e os sendmsg por iteração; as primeiras 100 iterações aquecem as
+// listas livres do reactor e o pool e não contam. Termina com 1 se o
+// número de libertações das referências não bater com o de referências.
+
+#include <signal.h>
+#include <time.h>
+
+#include "reactor.h"
+#include "msgbuf.h"
+
+#define MB_BATCH  32     // mensagens entre escritas das filas
+#define MB_WARMUP 100    // iterações antes de contar
+#define MB_FACES  64
+
+static unsigned long mbMallocs;
+static unsigned long mbRefs, mbReleases;   // do buffer estático
+
+void *__real_malloc(size_t n);
+
+void *__wrap_malloc(size_t n) {
+    mbMallocs++;
+    return __real_malloc(n);
+}
+
+enum { MB_PER_FACE, MB_COPY, MB_REF };
+
+static const char *mbModes[] = {"por face", "cópia", "referência"};
+static const int mbSizes[] = {0, 64, 128, 256, 512, 1400};   // 0: INTEREST
+
+static double mb_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void mb_data(Reactor *r, int fd, const char *data, ssize_t len, void *arg) {
+    (void)r, (void)fd, (void)data, (void)len, (void)arg;
+}
+
+static void mb_static_release(void *arg) {
+    (void)arg;
+    mbReleases++;
+}
+
+// Codifica a mensagem k da iteração it em out; devolve o comprimento
+static size_t mb_encode(char *out, int size, long it, int k) {
+    if (size == 0)
+        return (size_t)snprintf(out, MSGBUF_SIZE, "INTEREST objeto%ld %08x\n", it + k,
+                                (uint32_t)(it * MB_BATCH + k) * 2654435761u);
+    memset(out, 'x', (size_t)size - 1);
+    out[size - 1] = '\n';
+    return (size_t)size;
+}
+
+// Corre um modo com um tamanho; devolve 1 se as referências não baterem
+static int mb_run(int mode, int size, int nfaces, long iters) {
+    static char big[2048], drain[1 << 16];
+    int tx[MB_FACES], rx[MB_FACES];
+    Reactor r;
+    MsgBufPool mp;
+    if (reactor_init(&r) < 0) {
+        perror("reactor_init");
+        exit(EXIT_FAILURE);
+    }
+    msgbuf_pool_init(&mp, NULL);
+    if (mode == MB_REF)
+        r.out_ref_min = 0;
+    for (int f = 0; f < nfaces; f++) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+            perror("socketpair");
+            exit(EXIT_FAILURE);
+        }
+        set_nonblocking(sv[0]);
+        set_nonblocking(sv[1]);
+        tx[f] = sv[0];
+        rx[f] = sv[1];
+        reactor_add_stream(&r, tx[f], mb_data, NULL);
+    }
+    mbRefs = mbReleases = 0;
+    unsigned long mallocs = 0, flushes = 0;
+    double t0 = 0;
+    for (long it = 0; it < MB_WARMUP + iters; it++) {
+        if (it == MB_WARMUP) {
+            mallocs = mbMallocs;
+            flushes = r.stats.flushes;
+            t0 = mb_now();
+        }
+        for (int k = 0; k < MB_BATCH; k++) {
+            if (mode == MB_PER_FACE) {
+                for (int f = 0; f < nfaces; f++) {
+                    char msg[sizeof(big)];
+                    size_t len = mb_encode(msg, size, it, k);
+                    reactor_write(&r, tx[f], msg, len);
+                }
+            } else if (size > MSGBUF_SIZE) {
+                size_t len = mb_encode(big, size, it, k);
+                for (int f = 0; f < nfaces; f++) {
+                    if (mode == MB_COPY) {
+                        reactor_write(&r, tx[f], big, len);
+                    } else {
+                        mbRefs++;
+                        reactor_write_ref(&r, tx[f], big, len, mb_static_release, NULL);
+                    }
+                }
+            } else {
+                MsgBuf *b = msgbuf_alloc(&mp);
+                if (b == NULL)
+                    exit(EXIT_FAILURE);
+                b->len = (uint32_t)mb_encode(b->data, size, it, k);
+                for (int f = 0; f < nfaces; f++) {
+                    if (mode == MB_COPY)
+                        reactor_write(&r, tx[f], b->data, b->len);
+                    else
+                        reactor_write_ref(&r, tx[f], b->data, b->len, msgbuf_release,
+                                          msgbuf_ref(b));
+                }
+                msgbuf_unref(b);
+            }
+        }
+        reactor_out_flush(&r);
+        for (int f = 0; f < nfaces; f++)
+            while (read(rx[f], drain, sizeof(drain)) > 0)
+                ;
+    }
+    double ns = (mb_now() - t0) * 1e9 / (double)(iters * MB_BATCH);
+    double per = (double)(mbMallocs - mallocs) / (double)(iters * MB_BATCH);
+    printf("  %-11s %7.1f ns  %6.3f malloc  %6.2f sendmsg por iteração\n", mbModes[mode], ns, per,
+           (double)(r.stats.flushes - flushes) / (double)iters);
+    for (int f = 0; f < nfaces; f++) {
+        reactor_del(&r, tx[f]);
+        close(tx[f]);
+        close(rx[f]);
+    }
+    reactor_destroy(&r);
+    msgbuf_pool_destroy(&mp);
+    return mbRefs != mbReleases;
+}
+
+int main(int argc, char *argv[]) {
+    int nfaces = argc > 1 ? atoi(argv[1]) : 8;
+    long iters = argc > 2 ? atol(argv[2]) : 20000;
+    if (nfaces < 1 || nfaces > MB_FACES || iters <= 0) {
+        fprintf(stderr, "Uso: %s [faces (1..%d)] [iterações]\n", argv[0], MB_FACES);
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    printf("%d faces, %d mensagens por iteração, %ld iterações; por mensagem (todas as faces)\n",
+           nfaces, MB_BATCH, iters);
+    int failed = 0;
+    for (size_t s = 0; s < sizeof(mbSizes) / sizeof(mbSizes[0]); s++) {
+        if (mbSizes[s] == 0)
+            printf("INTEREST\n");
+        else
+            printf("%d bytes\n", mbSizes[s]);
+        for (int mode = MB_PER_FACE; mode <= MB_REF; mode++)
+            failed |= mb_run(mode, mbSizes[s], nfaces, iters);
+    }
+    if (failed)
+        printf("Referências do buffer estático sem libertação (ou libertadas duas vezes)\n");
+    return failed;
+}
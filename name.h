@@ -0,0 +1,154 @@
+#ifndef NAME_H
+#define NAME_H
+
+#include <stdint.h>
+#include <ctype.h>
+#include <string.h>
+
+/*
+ * Nomes de objetos: sequências alfanuméricas com um máximo de 100 carateres.
+ *
+ * O hash de um nome é calculado uma só vez, quando o nome é extraído da
+ * mensagem ou do comando, e segue com ele num NameView; a PIT, a cache, a
+ * cache negativa, o armazém, as rotas, a supressão e os resumos usam esse
+ * valor em vez de voltarem a percorrer a string.
+ *
+ * name_hash64 segue o wyhash: lê o nome em palavras de 8 bytes e mistura-as
+ * com multiplicações de 64x64 -> 128 bits. Para nomes de até 100 bytes isto
+ * é mais rápido do que preparar registos SIMD, e a qualidade é suficiente
+ * para usar as duas metades como hashes independentes.
+ */
+
+#define NDN_NAME_MAX 100
+
+// Nome com o comprimento e os hashes já calculados
+typedef struct {
+    const char *name;     // pode apontar para o meio de uma mensagem: usar len
+    uint32_t len;
+    uint32_t hash;        // 32 bits baixos de name_hash64: tabelas de dispersão
+    uint32_t hash2;       // 32 bits altos (ímpar): segundo hash dos filtros de Bloom
+} NameView;
+
+static inline uint64_t name_mix(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t ha = a >> 32, la = (uint32_t)a, hb = b >> 32, lb = (uint32_t)b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    return lo ^ hi;
+#endif
+}
+
+static inline uint64_t name_read8(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t name_read4(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// Hash de 64 bits de len bytes
+static inline uint64_t name_hash64(const char *name, size_t len) {
+    static const uint64_t s0 = 0xa0761d6478bd642full, s1 = 0xe7037ed1a0b428dbull;
+    const unsigned char *p = (const unsigned char *)name;
+    uint64_t seed = name_mix(s0, s1), a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (name_read4(p) << 32) | name_read4(p + ((len >> 3) << 2));
+            b = (name_read4(p + len - 4) << 32) | name_read4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        while (i > 16) {
+            seed = name_mix(name_read8(p) ^ s1, name_read8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = name_read8(p + i - 16);
+        b = name_read8(p + i - 8);
+    }
+    return name_mix(s1 ^ len, name_mix(a ^ s1, b ^ seed));
+}
+
+// Hash de 32 bits do nome, para quem não tem um NameView
+static inline uint32_t name_hash(const char *name) {
+    return (uint32_t)name_hash64(name, strlen(name));
+}
+
+static inline void name_view_set(NameView *nv, const char *name, size_t len) {
+    uint64_t h = name_hash64(name, len);
+    nv->name = name;
+    nv->len = (uint32_t)len;
+    nv->hash = (uint32_t)h;
+    nv->hash2 = (uint32_t)(h >> 32) | 1;
+}
+
+// NameView de um nome já validado
+static inline void name_view(NameView *nv, const char *name) {
+    name_view_set(nv, name, strlen(name));
+}
+
+// Valida os len bytes do nome (não vazio, alfanumérico, até NDN_NAME_MAX
+// carateres) e preenche o NameView; devolve 0 se for inválido
+static inline int name_view_parse(NameView *nv, const char *name, size_t len) {
+    if (len == 0 || len > NDN_NAME_MAX)
+        return 0;
+    for (size_t n = 0; n < len; n++)
+        if (!isalnum((unsigned char)name[n]))
+            return 0;
+    name_view_set(nv, name, len);
+    return 1;
+}
+
+// Como name_view_parse, mas com os hashes já calculados por quem enviou o
+// nome (formato binário); só a validação percorre o nome
+static inline int name_view_parse_hashed(NameView *nv, const char *name, size_t len,
+                                         uint32_t hash, uint32_t hash2) {
+    if (len == 0 || len > NDN_NAME_MAX)
+        return 0;
+    for (size_t n = 0; n < len; n++)
+        if (!isalnum((unsigned char)name[n]))
+            return 0;
+    nv->name = name;
+    nv->len = (uint32_t)len;
+    nv->hash = hash;
+    nv->hash2 = hash2 | 1;
+    return 1;
+}
+
+// 1 se s (terminado em '\0') for o nome do NameView
+static inline int name_view_eq(const NameView *nv, const char *s) {
+    return memcmp(s, nv->name, nv->len) == 0 && s[nv->len] == '\0';
+}
+
+// Copia o nome para dst (NDN_NAME_MAX + 1 bytes), terminado em '\0'
+static inline void name_view_copy(char *dst, const NameView *nv) {
+    memcpy(dst, nv->name, nv->len);
+    dst[nv->len] = '\0';
+}
+
+// 1 se o nome for válido (não vazio, alfanumérico, até NDN_NAME_MAX carateres)
+static inline int name_valid(const char *name) {
+    size_t n = 0;
+    for (; name[n]; n++) {
+        if (n >= NDN_NAME_MAX || !isalnum((unsigned char)name[n]))
+            return 0;
+    }
+    return n > 0;
+}
+
+#endif
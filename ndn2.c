@@ -4,10 +4,12 @@
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
-#include <sys/select.h>
 #include <netdb.h>
 #include <time.h>
 
+#include "reactor.h"
+#include "regclient.h"
+
 #define MAX_NODES 10
 #define BUFFER_SIZE 1024
 #define REG_SERVER_IP "193.136.138.142"
@@ -32,20 +34,11 @@ typedef struct {
     Topology topology;
     int tcp_fd;
     int udp_fd;
-    fd_set read_fds;
+    Reactor reactor;
+    RegClient reg;
     struct sockaddr_in reg_server_addr;
 } NDNNode;
 
-// Função para enviar mensagens ao servidor de registo
-void send_reg_message(NDNNode *node, const char *message) {
-    ssize_t n = sendto(node->udp_fd, message, strlen(message), 0,
-                      (struct sockaddr *)&node->reg_server_addr, 
-                      sizeof(node->reg_server_addr));
-    if (n == -1) {
-        perror("Error sending UDP message");
-    }
-}
-
 // Funções auxiliares
 void init_node(NDNNode *node, int cache, char *ip, int tcp_port, char *reg_ip, int reg_udp) {
     node->cache_size = cache;
@@ -119,16 +112,22 @@ int tcp_connect(const char *host, const char *port) {
 }
 
 // Função para processar mensagem NODESLIST
-void process_nodeslist(NDNNode *node, char *buffer) {
-    char *line = strtok(buffer, "\n");
-    if (strncmp(line, "NODESLIST", 9) != 0) return;
+void process_nodeslist(NDNNode *node, const char *reply) {
+    ProtoLines it;
+    StrView line, ip;
+    ProtoMsg m;
+    proto_lines_init(&it, reply, strlen(reply));
+    if (!proto_lines_next(&it, &line) || proto_parse(line.p, line.len, &m) != PROTO_OK ||
+        m.type != MSG_NODESLIST)
+        return;
 
     NodeID nodes[MAX_NODES];
     int count = 0;
-    
-    while ((line = strtok(NULL, "\n")) != NULL && count < MAX_NODES) {
-        sscanf(line, "%s %d", nodes[count].ip, &nodes[count].port);
-        count++;
+
+    while (count < MAX_NODES && proto_lines_next(&it, &line)) {
+        if (proto_parse_node(line, &ip, &nodes[count].port) == 0 &&
+            sv_copy(nodes[count].ip, sizeof(nodes[count].ip), ip) == 0)
+            count++;
     }
 
     if (count > 0) {
@@ -162,42 +161,35 @@ void show_topology(NDNNode *node) {
     printf("=======================\n");
 }
 
-// Modificar handle_join
-void handle_join(NDNNode *node, char *net) {
-    // Enviar pedido de lista de nós
-    char request[BUFFER_SIZE];
-    snprintf(request, BUFFER_SIZE, "NODES %s\n", net);
-    send_reg_message(node, request);
+void on_reg_reply(RegClient *rc, const RegRequest *req, const char *reply, void *arg) {
+    (void)rc; (void)arg;
+    if (reply == NULL)
+        printf("No response from registration server to %s %s\n", regclient_op_name(req->op), req->net);
+    else if (req->op == REG_OP_REG)
+        printf("Registration confirmed\n");
+    else
+        printf("Unregistration confirmed\n");
+}
 
-    // Receber resposta
-    char buffer[BUFFER_SIZE];
-    struct sockaddr_in addr;
-    socklen_t addrlen = sizeof(addr);
-    
-    fd_set fds;
-    struct timeval tv;
-    FD_ZERO(&fds);
-    FD_SET(node->udp_fd, &fds);
-    tv.tv_sec = 2; // Timeout de 2 segundos
-    tv.tv_usec = 0;
-
-    int ret = select(node->udp_fd + 1, &fds, NULL, NULL, &tv);
-    if (ret > 0) {
-        ssize_t n = recvfrom(node->udp_fd, buffer, BUFFER_SIZE, 0,
-                            (struct sockaddr *)&addr, &addrlen);
-        if (n > 0) {
-            buffer[n] = '\0';
-            process_nodeslist(node, buffer);
-            
-            // Registrar-se no servidor
-            char reg_msg[BUFFER_SIZE];
-            snprintf(reg_msg, BUFFER_SIZE, "REG %s %s %d\n", 
-                     net, node->self.ip, node->self.port);
-            send_reg_message(node, reg_msg);
-        }
-    } else {
+// NODESLIST recebido (ou pedido esgotado): liga-se a um nó e regista-se
+void on_nodeslist(RegClient *rc, const RegRequest *req, const char *reply, void *arg) {
+    NDNNode *node = arg;
+    if (reply == NULL) {
         printf("No response from registration server\n");
+        return;
     }
+    process_nodeslist(node, reply);
+
+    // Registrar-se no servidor
+    char port_str[8];
+    snprintf(port_str, sizeof(port_str), "%d", node->self.port);
+    regclient_send(rc, REG_OP_REG, req->net, node->self.ip, port_str, on_reg_reply, node);
+}
+
+// Pede a lista de nós; a resposta chega pelo reactor (on_udp) e o pedido é
+// retransmitido pelo cliente de registo se se perder
+void handle_join(NDNNode *node, char *net) {
+    regclient_send(&node->reg, REG_OP_NODES, net, NULL, NULL, on_nodeslist, node);
 }
 
 void handle_direct_join(NDNNode *node, char *net, char *connect_ip, int connect_port) {
@@ -225,9 +217,12 @@ void handle_direct_join(NDNNode *node, char *net, char *connect_ip, int connect_
     char response[BUFFER_SIZE];
     ssize_t n = recv(sock, response, BUFFER_SIZE - 1, 0);
     if (n > 0) {
-        response[n] = '\0';
-        if (strncmp(response, "SAFE", 4) == 0) {
-            sscanf(response + 5, "%s %d", node->topology.safeguard.ip, &node->topology.safeguard.port);
+        ProtoMsg m;
+        const char *nl = memchr(response, '\n', (size_t)n);
+        if (proto_parse(response, nl ? (size_t)(nl - response) : (size_t)n, &m) == PROTO_OK &&
+            m.type == MSG_SAFE &&
+            sv_copy(node->topology.safeguard.ip, sizeof(node->topology.safeguard.ip), m.ip) == 0) {
+            node->topology.safeguard.port = m.port;
         }
     }
 
@@ -261,59 +256,72 @@ void process_command(NDNNode *node, char *command) {
     }
 }
 
-// Loop principal
-void event_loop(NDNNode *node) {
-    FD_ZERO(&node->read_fds);
-    FD_SET(STDIN_FILENO, &node->read_fds);
-    FD_SET(node->tcp_fd, &node->read_fds);
-    FD_SET(node->udp_fd, &node->read_fds);
-
-
-    while (1) {
-        fd_set tmp_fds = node->read_fds;
-        if (select(FD_SETSIZE, &tmp_fds, NULL, NULL, NULL) == -1) {
-            perror("select");
-            exit(EXIT_FAILURE);
+// Callbacks do reactor
+void on_stdin(Reactor *r, int fd, uint32_t events, void *arg) {
+    (void)events;
+    NDNNode *node = arg;
+    char command[BUFFER_SIZE];
+    do {
+        if (!fgets(command, BUFFER_SIZE, stdin)) {
+            reactor_stop(r);
+            return;
         }
+        process_command(node, command);
+    } while (fd_pending_bytes(fd) > 0);
+}
 
-        if (FD_ISSET(STDIN_FILENO, &tmp_fds)) {
-            char command[BUFFER_SIZE];
-            if (fgets(command, BUFFER_SIZE, stdin)) {
-                process_command(node, command);
-            }
-        }
+void on_udp(Reactor *r, int fd, uint32_t events, void *arg) {
+    (void)r; (void)events;
+    NDNNode *node = arg;
+    char buffer[BUFFER_SIZE];
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+    ssize_t n;
+
+    while ((n = recvfrom(fd, buffer, BUFFER_SIZE - 1, 0,
+                         (struct sockaddr *)&addr, &addrlen)) > 0) {
+        buffer[n] = '\0';
+        if (!regclient_handle(&node->reg, buffer))
+            printf("Unexpected UDP message: %s\n", buffer);
+        addrlen = sizeof(addr);
+    }
+}
 
-        if (FD_ISSET(node->udp_fd, &tmp_fds)) {
-            char buffer[BUFFER_SIZE];
-            struct sockaddr_in addr;
-            socklen_t addrlen = sizeof(addr);
-            
-            ssize_t n = recvfrom(node->udp_fd, buffer, BUFFER_SIZE, 0,
-                                 (struct sockaddr *)&addr, &addrlen);
-            if (n > 0) {
-                buffer[n] = '\0';
-                if (strncmp(buffer, "OKREG", 5) == 0) {
-                    printf("Registration confirmed\n");
-                } else if (strncmp(buffer, "OKUNREG", 7) == 0) {
-                    printf("Unregistration confirmed\n");
-                }
-            }
-        }
-        if (FD_ISSET(node->tcp_fd, &tmp_fds)) {
-            struct sockaddr_in addr;
-            socklen_t addrlen = sizeof(addr);
-            int newfd = accept(node->tcp_fd, (struct sockaddr *)&addr, &addrlen);
-            close(newfd); // Simplificado para exemplo
-        }
+void on_accept(Reactor *r, int fd, uint32_t events, void *arg) {
+    (void)r; (void)events; (void)arg;
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+    int newfd;
+    while ((newfd = accept(fd, (struct sockaddr *)&addr, &addrlen)) != -1) {
+        close(newfd); // Simplificado para exemplo
+        addrlen = sizeof(addr);
+    }
+}
+
+// Loop principal
+void event_loop(NDNNode *node) {
+    if (reactor_init(&node->reactor) == -1)
+        exit(EXIT_FAILURE);
+    set_nonblocking(node->tcp_fd);
+    set_nonblocking(node->udp_fd);
+    setvbuf(stdin, NULL, _IONBF, 0);
+    if (reactor_add(&node->reactor, STDIN_FILENO, REACTOR_READ, on_stdin, node) == -1 ||
+        reactor_add(&node->reactor, node->tcp_fd, REACTOR_READ | REACTOR_ET, on_accept, node) == -1 ||
+        reactor_add(&node->reactor, node->udp_fd, REACTOR_READ | REACTOR_ET, on_udp, node) == -1) {
+        exit(EXIT_FAILURE);
     }
+    // As retransmissões ao servidor de registo são temporizadores do reactor
+    regclient_init(&node->reg, node->udp_fd, (struct sockaddr *)&node->reg_server_addr,
+                   sizeof(node->reg_server_addr), &node->reactor.timers);
+    reactor_run(&node->reactor);
+    reactor_destroy(&node->reactor);
 }
 
 void handle_leave(NDNNode *node) {
     if (node->topology.external.port != -1) {
-        char unreg_msg[BUFFER_SIZE];
-        snprintf(unreg_msg, BUFFER_SIZE, "UNREG %s %s %d\n", 
-                 "net", node->self.ip, node->self.port);
-        send_reg_message(node, unreg_msg);
+        char port_str[8];
+        snprintf(port_str, sizeof(port_str), "%d", node->self.port);
+        regclient_send(&node->reg, REG_OP_UNREG, "net", node->self.ip, port_str, on_reg_reply, node);
     }
 }
 
@@ -337,6 +345,26 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
+    // Socket UDP para o servidor de registo
+    struct addrinfo hints, *res;
+    char reg_port[6];
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    snprintf(reg_port, sizeof(reg_port), "%d", node.reg_server.port);
+    int errcode = getaddrinfo(node.reg_server.ip, reg_port, &hints, &res);
+    if (errcode != 0) {
+        fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(errcode));
+        exit(EXIT_FAILURE);
+    }
+    node.udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (node.udp_fd == -1) {
+        perror("socket");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(&node.reg_server_addr, res->ai_addr, sizeof(node.reg_server_addr));
+    freeaddrinfo(res);
+
     printf("Node %s:%d ready\n", node.self.ip, node.self.port);
     event_loop(&node);
 
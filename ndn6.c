@@ -5,175 +5,2081 @@
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
-#include <sys/select.h>
+#include <sys/resource.h>
+#include <poll.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <time.h>
+
+#include "reactor.h"
+#include "regclient.h"
+#include "cs.h"
+#include "pit.h"
+#include "store.h"
+#include "suppress.h"
+#include "fib.h"
+#include "bloom.h"
+#include "proto.h"
+#include "msgbuf.h"
+#include "arena.h"
+#include "nodeid.h"
 
 #define MAX_BUFFER 256
-#define MAX_INTERNAL 10
-#define MAX_CLIENTS 10
+#define SESSION_BUF 1024  // buffer de receção de cada sessão TCP
+#define SESSION_HWM (64 * 1024)  // bytes em fila acima dos quais a sessão não recebe interesses
+#define MAX_CANDIDATES 16
+#define JOIN_TIMEOUT_MS 3000  // tempo máximo por candidato (opção -t)
+#define HB_MISSES 3           // batimentos perdidos até a ligação ser dada como perdida (opção -m)
 
 // Estrutura para armazenar vizinhos (topologia)
 typedef struct {
-    char ip[INET_ADDRSTRLEN];
-    int port;
+    NodeId id;  // IPv4 e porta TCP (NODEID_NONE se não houver vizinho)
+    int fd;     // socket da sessão com o vizinho (-1 se não houver)
 } Neighbor;
 
+// Sessão TCP persistente com um vizinho; dura enquanto durar a adjacência.
+// O descritor identifica também a interface da sessão na PIT e na FIB.
+typedef struct Session {
+    int fd;
+    int in_use;
+    Neighbor peer;            // vizinho (ENTRY recebido ou destino do join); id 0 se ainda não
+    int internal;             // vizinho interno (enviou ENTRY por esta sessão)
+    int slot;                 // posição na lista de sessões abertas
+    NodeId id;                // peer.id enquanto a sessão está na tabela de ids, 0 se não
+    struct Session *hnext;    // cadeia do balde do id
+    char rbuf[SESSION_BUF];   // bytes recebidos ainda sem '\n' (mensagem parcial)
+    size_t rlen;
+    BloomFilter digest;       // resumo dos nomes do vizinho (map NULL: ainda não recebido)
+    int tlv_offered;          // "TLV" enviado no ENTRY ou SAFE
+    int tlv_peer;             // o vizinho também ofereceu "TLV"
+    int tlv_tx, tlv_rx;       // a enviar / a receber tramas binárias
+    Timer hb_tx;              // próximo batimento a enviar
+    Timer hb_rx;              // prazo para voltar a ouvir o vizinho
+    int hb_sent;              // houve tráfego enviado desde o último batimento
+    uint32_t hb_peer;         // intervalo dos batimentos do vizinho (0: não os envia)
+    long long last_rx;        // última receção, com os batimentos ligados
+} Session;
+
+POOL_TYPED(SessionPool, session_pool, Session)
+
+// Sessões abertas, sem limite fixo: indexadas pelo descritor (despacho e
+// interfaces da PIT em O(1)), numa lista densa para as difusões e numa
+// tabela de dispersão pelo id do vizinho (ENTRY e LEAVE). As três crescem
+// por duplicação; as sessões vêm de um pool e não mudam de endereço.
+typedef struct {
+    Session **by_fd;
+    int capacity;
+    Session **list;
+    int count, list_cap;
+    Session **buckets;
+    uint32_t nbuckets;        // potência de 2
+    uint32_t nids;            // sessões com id na tabela
+    SessionPool pool;
+    int peak;                 // máximo de sessões abertas
+    unsigned long rehashes;
+} SessionTable;
+
+// Estados de uma tentativa de join não bloqueante
+typedef enum {
+    JOIN_IDLE,
+    JOIN_CONNECTING,      // connect() em curso
+    JOIN_ENTRY_SENT,      // ligação estabelecida, ENTRY enviado
+    JOIN_AWAITING_SAFE,   // à espera do SAFE do novo vizinho externo
+    JOIN_ESTABLISHED
+} JoinState;
+
+// Join em curso: percorre os candidatos até um responder com SAFE
+typedef struct {
+    JoinState state;
+    char net[16];
+    Neighbor candidates[MAX_CANDIDATES];
+    int numCandidates;
+    int next;                 // próximo candidato a tentar
+    int fd;                   // socket da tentativa atual
+    Session *session;
+    Timer timer;              // expira a tentativa atual
+    long long started;        // início do join (pedido NODES incluído), para medir a latência
+    int registerOnSuccess;    // envia REG quando o join terminar
+    int repair;               // reparação da topologia: liga ao vizinho de salvaguarda
+} JoinAttempt;
+
 // Variáveis globais para TCP (topologia)
-Neighbor externalNeighbor = {"", 0};
-Neighbor safeguardNeighbor = {"", 0};
-Neighbor internalNeighbors[MAX_INTERNAL];
+Neighbor externalNeighbor = {NODEID_NONE, -1};
+Neighbor safeguardNeighbor = {NODEID_NONE, -1};
 int numInternal = 0;
+SessionTable sessions;
 
 // Identificador do nó (IP e porta TCP)
 char myIP[INET_ADDRSTRLEN];
 int myPort;
+NodeId myId;     // myIP e myPort empacotados
 char myTCP[16];  // string para o número da porta TCP
+char myNet[16] = "";  // rede a que o nó pertence ("" fora de qualquer rede)
 
 // UDP globals
 int udp_sock;  // socket UDP
 struct sockaddr_storage server_addr;
 socklen_t server_addr_len;
+RegClient regclient;  // pedidos pendentes ao servidor de registo
+
+// Reactor (epoll) que multiplexa STDIN, o servidor TCP, o UDP e os clientes
+Reactor reactor;
+int server_sock;
+
+ContentStore cs;  // cache de objetos (capacidade = argumento cache)
+const CsPolicy *csPolicy = NULL;  // opção -p (NULL: LRU)
+int csTinyLfu = 0;                // opção -a: admissão TinyLFU
+NegCache negcache;  // nomes procurados há pouco sem sucesso
+int negTtlMs = NEG_TTL_MS;  // opção -n (0 desliga a cache negativa)
+unsigned topologyEpoch = 0;  // muda a cada sessão aberta ou fechada
+Pit pit;          // interesses pendentes; as interfaces são os descritores das sessões
+ObjectStore store;  // objetos criados neste nó
+SuppressTable suppress;  // interesses reencaminhados recentemente
+Fib fib;          // rotas aprendidas pelos OBJECT recebidos
+MsgBufPool msgbufs;  // mensagens codificadas uma vez e enviadas a várias sessões
+// Memória que vive tanto como o nó: os lotes dos pools da PIT, das rotas e
+// dos buffers de mensagens. Os pools são aquecidos no arranque com
+// MEM_PREWARM objetos para o encaminhamento não reservar memória.
+#define MEM_PREWARM 256
+Arena arena;
+
+// Resumo (filtro de Bloom) dos nomes do armazém e da cache, enviado aos
+// vizinhos: "DIGEST bits k" recomeça o filtro, "DIGESTSET p..." e
+// "DIGESTCLR p..." ligam e desligam posições
+#define DIGEST_PENDING 512  // posições alteradas antes de reenviar tudo
+BloomCounter localDigest;
+BloomFilter digestDirty;    // posições já na lista de pendentes
+uint32_t digestPending[DIGEST_PENDING];
+int numDigestPending = 0;
+int digestResend = 0;       // demasiadas alterações: reenvia o resumo completo
+int digestBits = BLOOM_BITS;  // opção -b (0 desliga o envio de resumos)
+int digestK = BLOOM_K;        // opção -k
+
+typedef struct {
+    unsigned long directed;        // interesses enviados só aos vizinhos com o nome no resumo
+    unsigned long false_positives; // desses, os que acabaram em NOOBJECT
+    unsigned long messages;        // mensagens DIGEST* enviadas
+    unsigned long positions;       // posições enviadas nessas mensagens
+} DigestStats;
+DigestStats digestStats;
+
+// Formato das mensagens entre nós (opção -w): com "tlv" o formato binário é
+// oferecido a cada vizinho e usado com os que também o oferecem
+int wireTlv = 1;
+
+typedef struct {
+    unsigned long text_msgs, text_bytes;  // enviadas em texto
+    unsigned long tlv_msgs, tlv_bytes;    // enviadas em tramas binárias
+    unsigned long throttled;  // interesses não enviados a sessões acima de SESSION_HWM
+    unsigned long dropped;    // mensagens perdidas com a fila de saída cheia
+} WireStats;
+WireStats wireStats;
+
+JoinAttempt join = {JOIN_IDLE, "", {{NODEID_NONE, -1}}, 0, 0, -1, NULL, {0}, 0, 0, 0};
+int joinTimeoutMs = JOIN_TIMEOUT_MS;
+int routeTtlMs = FIB_TTL_MS;  // opção -r (0 desliga as rotas aprendidas)
+
+// Batimentos (opção -h): cada sessão envia HELLO quando não enviou mais
+// nada durante um intervalo, e um vizinho que também os envia é dado como
+// perdido se ficar hbMisses intervalos calado (o maior dos dois intervalos)
+int hbIntervalMs = 0;       // opção -h (0 desliga os batimentos)
+int hbMisses = HB_MISSES;   // opção -m
+
+typedef struct {
+    unsigned long sent, received;
+    unsigned long failures;      // vizinhos dados como perdidos
+    long long detect_sum;        // silêncio até à deteção, somado sobre as falhas
+    long long detect_max;
+} HeartbeatStats;
+HeartbeatStats hbStats;
+
+// Reparação da topologia quando se perde o vizinho externo: o nó liga ao
+// vizinho de salvaguarda ou, se for a sua própria salvaguarda (uma das
+// duas âncoras da árvore), promove um interno a externo; depois envia o
+// novo SAFE aos internos. Quem perde um interno também espera: os internos
+// dele têm este nó como salvaguarda e vão ligar-se aqui. Enquanto a janela
+// de reparação está aberta, os interesses que ficam sem interfaces de saída
+// esperam pelas novas adjacências em vez de responderem NOOBJECT.
+typedef struct {
+    long long started;        // perda do vizinho externo
+    Timer window;             // fecha a janela (joinTimeoutMs após o último passo)
+} Repair;
+Repair repair;
+
+typedef struct {
+    unsigned long losses;          // perdas do vizinho externo
+    unsigned long via_safeguard;   // reparadas com ligação ao vizinho de salvaguarda
+    unsigned long promotions;      // reparadas com um interno promovido a externo
+    unsigned long alone;           // o nó ficou sozinho na rede
+    long long time_sum, time_max;  // da perda à topologia reparada
+    unsigned long parked;          // interesses que esperaram pela reparação
+    unsigned long reexpressed;     // desses, os reenviados pela topologia nova
+    unsigned long lost;            // e os que ficaram sem resposta ao fechar a janela
+} RepairStats;
+RepairStats repairStats;
+
+// Relógio monótono em milissegundos
+long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+const char *join_state_name(JoinState st) {
+    switch (st) {
+    case JOIN_CONNECTING: return "CONNECTING";
+    case JOIN_ENTRY_SENT: return "ENTRY_SENT";
+    case JOIN_AWAITING_SAFE: return "AWAITING_SAFE";
+    case JOIN_ESTABLISHED: return "ESTABLISHED";
+    default: return "IDLE";
+    }
+}
+
+void join_set_state(JoinState st) {
+    join.state = st;
+    if (st == JOIN_ESTABLISHED)
+        timer_cancel(&join.timer);
+    printf("Join: estado %s\n", join_state_name(st));
+}
+
+int perform_registration(const char *net);
+void join_try_next(void);
+int join_start(const char *net, const Neighbor *candidates, int n, int registerOnSuccess,
+               int repair);
+void repair_begin(void);
+void repair_wait(void);
+void repair_external(void);
+void repair_promote(void);
+void repair_reexpress(void);
+int pit_reexpress(PitEntry *e);
+void repair_done(const char *how, int wait);
+int session_face(const Session *s);
+void pit_face_closed(int face);
+
+/* ---------- tabela de sessões ---------- */
+
+uint32_t session_id_bucket(NodeId id, uint32_t nbuckets) {
+    return nodeid_hash(id) & (nbuckets - 1);
+}
+
+void session_table_init(SessionTable *t, Arena *arena) {
+    memset(t, 0, sizeof(*t));
+    session_pool_init(&t->pool, "sessões", arena);
+}
+
+void session_table_destroy(SessionTable *t) {
+    free(t->by_fd);
+    free(t->list);
+    free(t->buckets);
+    session_pool_destroy(&t->pool);
+}
+
+// Sessão aberta no descritor fd, ou NULL
+Session *session_at(int fd) {
+    if (fd < 0 || fd >= sessions.capacity)
+        return NULL;
+    return sessions.by_fd[fd];
+}
+
+// Garante espaço para o descritor fd e para mais uma sessão na lista
+int session_table_reserve(SessionTable *t, int fd) {
+    if (fd >= t->capacity) {
+        int cap = t->capacity ? t->capacity : 64;
+        while (cap <= fd)
+            cap *= 2;
+        Session **b = realloc(t->by_fd, (size_t)cap * sizeof(*b));
+        if (b == NULL)
+            return -1;
+        memset(b + t->capacity, 0, (size_t)(cap - t->capacity) * sizeof(*b));
+        t->by_fd = b;
+        t->capacity = cap;
+    }
+    if (t->count == t->list_cap) {
+        int cap = t->list_cap ? t->list_cap * 2 : 16;
+        Session **l = realloc(t->list, (size_t)cap * sizeof(*l));
+        if (l == NULL)
+            return -1;
+        t->list = l;
+        t->list_cap = cap;
+    }
+    return 0;
+}
+
+// Duplica os baldes e volta a distribuir as sessões com id
+int session_table_rehash(SessionTable *t) {
+    uint32_t n = t->nbuckets ? t->nbuckets * 2 : 64;
+    Session **b = calloc(n, sizeof(*b));
+    if (b == NULL)
+        return -1;
+    for (int i = 0; i < t->count; i++) {
+        Session *s = t->list[i];
+        if (s->id == NODEID_NONE)
+            continue;
+        uint32_t k = session_id_bucket(s->id, n);
+        s->hnext = b[k];
+        b[k] = s;
+    }
+    free(t->buckets);
+    t->buckets = b;
+    t->nbuckets = n;
+    t->rehashes++;
+    return 0;
+}
+
+// Sessão do vizinho com o id dado, ou NULL
+Session *session_by_id(NodeId id) {
+    if (id == NODEID_NONE || sessions.nids == 0)
+        return NULL;
+    for (Session *s = sessions.buckets[session_id_bucket(id, sessions.nbuckets)]; s != NULL;
+         s = s->hnext)
+        if (nodeid_eq(s->id, id))
+            return s;
+    return NULL;
+}
+
+// Tira a sessão da tabela de ids
+void session_unhash(Session *s) {
+    if (s->id == NODEID_NONE)
+        return;
+    Session **pp = &sessions.buckets[session_id_bucket(s->id, sessions.nbuckets)];
+    while (*pp != s)
+        pp = &(*pp)->hnext;
+    *pp = s->hnext;
+    s->hnext = NULL;
+    s->id = NODEID_NONE;
+    sessions.nids--;
+}
+
+// Identifica o vizinho da sessão e indexa-a pelo seu id. Devolve a sessão
+// que tinha o mesmo id (ligação anterior do mesmo vizinho), que sai da
+// tabela, ou NULL.
+Session *session_identify(Session *s, NodeId id) {
+    s->peer.id = id;
+    if (nodeid_eq(id, s->id))
+        return NULL;
+    session_unhash(s);
+    Session *old = session_by_id(id);
+    if (old != NULL)
+        session_unhash(old);
+    if (sessions.nids >= sessions.nbuckets && session_table_rehash(&sessions) < 0)
+        return old;
+    uint32_t k = session_id_bucket(id, sessions.nbuckets);
+    s->id = id;
+    s->hnext = sessions.buckets[k];
+    sessions.buckets[k] = s;
+    sessions.nids++;
+    return old;
+}
+
+void session_table_print_stats(void) {
+    printf("Sessões: %d abertas (máximo %d), %d internos, %d descritores indexados, "
+           "%u ids em %u baldes (%lu redimensionamentos)\n", sessions.count, sessions.peak,
+           numInternal, sessions.capacity, sessions.nids, sessions.nbuckets, sessions.rehashes);
+}
+
+// Texto do vizinho para mostrar ("" se não houver)
+NodeIdText neighbor_text(const Neighbor *n) {
+    NodeIdText t = {""};
+    if (n->id != NODEID_NONE)
+        t = nodeid_text(n->id);
+    return t;
+}
 
 // Função para exibir a topologia atual
 void show_topology() {
     printf("----- Topologia Atual -----\n");
-    printf("Vizinho Externo: %s:%d\n", externalNeighbor.ip, externalNeighbor.port);
-    printf("Vizinho de Salvaguarda: %s:%d\n", safeguardNeighbor.ip, safeguardNeighbor.port);
+    printf("Vizinho Externo: %s\n", neighbor_text(&externalNeighbor).s);
+    printf("Vizinho de Salvaguarda: %s\n", neighbor_text(&safeguardNeighbor).s);
     printf("Vizinhos Internos (%d):\n", numInternal);
-    for (int i = 0; i < numInternal; i++) {
-        printf("  %s:%d\n", internalNeighbors[i].ip, internalNeighbors[i].port);
+    for (int i = 0; i < sessions.count; i++) {
+        Session *s = sessions.list[i];
+        if (s->internal)
+            printf("  %s\n", nodeid_text(s->peer.id).s);
     }
     printf("---------------------------\n");
 }
 
-// Função para adicionar um vizinho interno
-void add_internal_neighbor(const char *ip, int port) {
-    if (numInternal < MAX_INTERNAL) {
-        strcpy(internalNeighbors[numInternal].ip, ip);
-        internalNeighbors[numInternal].port = port;
-        numInternal++;
-        printf("Adicionado vizinho interno: %s:%d\n", ip, port);
+// O vizinho da sessão passa a interno. Um ENTRY numa sessão que já é
+// interna (interno que passou a externo numa reparação) não acrescenta nada.
+void add_internal_neighbor(Session *s) {
+    if (s->internal)
+        return;
+    s->internal = 1;
+    numInternal++;
+    printf("Adicionado vizinho interno: %s\n", nodeid_text(s->peer.id).s);
+}
+
+void remove_internal_neighbor(Session *s) {
+    if (!s->internal)
+        return;
+    s->internal = 0;
+    numInternal--;
+    printf("Removido vizinho interno: %s\n", nodeid_text(s->peer.id).s);
+}
+
+int is_self(const Neighbor *n) {
+    return nodeid_eq(n->id, myId);
+}
+
+void handle_session(Reactor *r, int fd, const char *data, ssize_t len, void *arg);
+void session_heartbeat(void *arg);
+void session_silent(void *arg);
+
+// Regista um socket TCP ligado a um vizinho como sessão persistente
+// (NULL sem memória ou se o reactor não aceitar o descritor)
+Session *session_open(int fd) {
+    if (session_table_reserve(&sessions, fd) < 0) {
+        perror("session_open");
+        return NULL;
+    }
+    Session *s = session_pool_alloc(&sessions.pool);
+    if (s == NULL)
+        return NULL;
+    s->fd = fd;
+    s->peer.fd = fd;
+    // As escritas já seguem juntas no fim de cada iteração; com o Nagle
+    // ligado, uma mensagem atrás de um HELLO ainda por confirmar
+    // esperaria pelo ACK atrasado do vizinho (40 ms)
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (reactor_add_stream(&reactor, fd, handle_session, s) < 0) {
+        session_pool_free(&sessions.pool, s);
+        return NULL;
+    }
+    s->in_use = 1;
+    sessions.by_fd[fd] = s;
+    s->slot = sessions.count;
+    sessions.list[sessions.count++] = s;
+    if (sessions.count > sessions.peak)
+        sessions.peak = sessions.count;
+    topologyEpoch++;
+    negcache_clear(&negcache);
+    timer_init(&s->hb_tx, session_heartbeat, s);
+    timer_init(&s->hb_rx, session_silent, s);
+    if (hbIntervalMs > 0) {
+        s->last_rx = now_ms();
+        timer_arm(&reactor.timers, &s->hb_tx, s->last_rx + hbIntervalMs);
+    }
+    return s;
+}
+
+// Fecha a sessão e desfaz a adjacência correspondente
+void session_close(Session *s) {
+    if (!s->in_use)
+        return;
+    int failed_join = (join.session == s && join.state != JOIN_ESTABLISHED);
+    int lost_external = !failed_join && externalNeighbor.fd == s->fd;
+    if (join.session == s)
+        join.session = NULL;
+    // A janela abre antes de a interface sair da PIT, para os interesses
+    // que seguiam só por ela ficarem à espera da reparação
+    if (lost_external)
+        repair_begin();
+    else if (!failed_join && s->internal)
+        repair_wait();
+    timer_cancel(&s->hb_tx);
+    timer_cancel(&s->hb_rx);
+    pit_face_closed(session_face(s));
+    bloom_free(&s->digest);
+    remove_internal_neighbor(s);
+    if (externalNeighbor.fd == s->fd) {
+        printf("Perdida a ligação ao vizinho externo %s\n", nodeid_text(externalNeighbor.id).s);
+        externalNeighbor.id = NODEID_NONE;
+        externalNeighbor.fd = -1;
+    }
+    reactor_del(&reactor, s->fd);
+    close(s->fd);
+    session_unhash(s);
+    sessions.by_fd[s->fd] = NULL;
+    Session *last = sessions.list[--sessions.count];
+    sessions.list[s->slot] = last;
+    last->slot = s->slot;
+    s->in_use = 0;
+    session_pool_free(&sessions.pool, s);
+    topologyEpoch++;
+    negcache_clear(&negcache);
+    if (failed_join) {
+        printf("Join: ligação fechada antes do SAFE\n");
+        join_try_next();
+    } else if (lost_external) {
+        repair_external();
+    }
+}
+
+void wire_count(const Session *s, size_t len) {
+    if (s->tlv_tx) {
+        wireStats.tlv_msgs++;
+        wireStats.tlv_bytes += len;
     } else {
-        printf("Limite de vizinhos internos atingido.\n");
-    }
-}
-
-// Processa a mensagem recebida de um cliente TCP conectado
-void process_client_message(int client_sock) {
-    char buffer[MAX_BUFFER];
-    ssize_t n = read(client_sock, buffer, MAX_BUFFER - 1);
-    if (n > 0) {
-        buffer[n] = '\0';
-        printf("Mensagem TCP recebida: %s", buffer);
-        char command[16], ip[INET_ADDRSTRLEN];
-        int port;
-        if (sscanf(buffer, "%s %s %d", command, ip, &port) == 3) {
-            if (strcmp(command, "ENTRY") == 0) {
-                add_internal_neighbor(ip, port);
-            } else if (strcmp(command, "SAFE") == 0) {
-                strcpy(safeguardNeighbor.ip, ip);
-                safeguardNeighbor.port = port;
-                printf("Atualizado vizinho de salvaguarda: %s:%d\n", ip, port);
-            } else {
-                printf("Comando TCP desconhecido: %s\n", command);
-            }
+        wireStats.text_msgs++;
+        wireStats.text_bytes += len;
+    }
+}
+
+// Envia len bytes (uma ou mais mensagens inteiras) pela sessão. Os dados
+// ficam na fila de saída e seguem todos juntos no fim da iteração.
+int session_write(Session *s, const void *msg, size_t len) {
+    if (reactor_write(&reactor, s->fd, msg, len) < 0) {
+        wireStats.dropped++;
+        perror("Erro ao enviar mensagem TCP");
+        return -1;
+    }
+    s->hb_sent = 1;
+    wire_count(s, len);
+    return 0;
+}
+
+// Como session_write, com um buffer partilhado por várias sessões. Abaixo
+// de REACTOR_OUT_REF_MIN (todas as mensagens entre nós) os bytes são
+// copiados para a fila e o buffer é largado logo.
+int session_write_buf(Session *s, MsgBuf *b) {
+    if (reactor_write_ref(&reactor, s->fd, b->data, b->len, msgbuf_release, msgbuf_ref(b)) < 0) {
+        wireStats.dropped++;
+        perror("Erro ao enviar mensagem TCP");
+        return -1;
+    }
+    s->hb_sent = 1;
+    wire_count(s, b->len);
+    return 0;
+}
+
+// Mensagem enviada a várias sessões: é codificada no máximo uma vez por
+// formato (texto e binário) e o mesmo buffer vai para todas as filas
+typedef struct {
+    MsgBuf *buf[2];   // indexado por Session.tlv_tx
+} FanOut;
+
+#define FANOUT_INIT {{NULL, NULL}}
+
+void fanout_done(FanOut *fo) {
+    msgbuf_unref(fo->buf[0]);
+    msgbuf_unref(fo->buf[1]);
+    fo->buf[0] = fo->buf[1] = NULL;
+}
+
+// Envia uma mensagem de texto (já terminada em '\n') pela sessão
+int session_send(Session *s, const char *msg) {
+    return session_write(s, msg, strlen(msg));
+}
+
+// Contrapressão: com SESSION_HWM bytes por enviar o vizinho não está a
+// acompanhar, e os interesses seguem por outras interfaces (as respostas
+// continuam a ser enviadas)
+int session_congested(const Session *s) {
+    return reactor_pending(&reactor, s->fd) >= SESSION_HWM;
+}
+
+// Os dois lados ofereceram o formato binário: a linha "TLV" é a última
+// mensagem de texto enviada nesta sessão
+void tlv_negotiate(Session *s) {
+    if (!s->tlv_offered || !s->tlv_peer || s->tlv_tx)
+        return;
+    if (session_send(s, "TLV\n") == 0) {
+        s->tlv_tx = 1;
+        printf("Sessão com %s passa ao formato binário\n", nodeid_text(s->peer.id).s);
+    }
+}
+
+// Envia "ENTRY ip port", "SAFE ip port" ou "LEAVE ip port". Em texto, o
+// ENTRY e o SAFE levam a oferta do formato binário.
+int send_addr_message(Session *s, MsgType type, NodeId id) {
+    if (s->tlv_tx) {
+        uint8_t frame[TLV_HDR_MAX + 6];
+        return session_write(s, frame, tlv_put_addr(frame, type, id));
+    }
+    char message[MAX_BUFFER];
+    int offer = wireTlv && type != MSG_LEAVE;
+    const char *cmd = proto_type_name(type);
+    size_t len = strlen(cmd);
+    memcpy(message, cmd, len);
+    message[len++] = ' ';
+    len += nodeid_put_addr(message + len, id);
+    if (offer) {
+        memcpy(message + len, " TLV", 4);
+        len += 4;
+    }
+    message[len++] = '\n';
+    if (session_write(s, message, len) < 0)
+        return -1;
+    if (offer) {
+        s->tlv_offered = 1;
+        tlv_negotiate(s);
+    }
+    return 0;
+}
+
+// Envia "OBJECT name" ou "NOOBJECT name" pela sessão, com a codificação
+// partilhada em fo
+void send_name_shared(Session *s, MsgType type, const NameView *nv, FanOut *fo) {
+    MsgBuf *b = fo->buf[s->tlv_tx];
+    if (b == NULL) {
+        if ((b = msgbuf_alloc(&msgbufs)) == NULL)
+            return;
+        if (s->tlv_tx)
+            b->len = (uint32_t)tlv_put_name((uint8_t *)b->data, type, nv->name, nv->len,
+                                            nv->hash, nv->hash2, 0);
+        else
+            b->len = (uint32_t)snprintf(b->data, MSGBUF_SIZE, "%s %.*s\n", proto_type_name(type),
+                                        (int)nv->len, nv->name);
+        fo->buf[s->tlv_tx] = b;
+    }
+    session_write_buf(s, b);
+}
+
+void send_name_message(Session *s, MsgType type, const NameView *nv) {
+    FanOut fo = FANOUT_INIT;
+    send_name_shared(s, type, nv, &fo);
+    fanout_done(&fo);
+}
+
+// Envia as posições dadas em mensagens "DIGESTSET p p ..." ou
+// "DIGESTCLR p p ..." que cabem em MAX_BUFFER
+void digest_send_positions(Session *s, MsgType type, const uint32_t *pos, int n) {
+    char message[MAX_BUFFER];
+    int i = 0;
+    while (s->tlv_tx && i < n) {
+        uint8_t *frame = (uint8_t *)message, v[MAX_BUFFER - TLV_HDR_MAX];
+        size_t len = 0;
+        // Cada posição ocupa no máximo 5 bytes
+        while (i < n && len + 5 <= sizeof(v)) {
+            len += tlv_put_varint(v + len, pos[i++]);
+            digestStats.positions++;
+        }
+        size_t h = tlv_put_header(frame, type, (uint32_t)len);
+        memcpy(frame + h, v, len);
+        session_write(s, frame, h + len);
+        digestStats.messages++;
+    }
+    while (i < n) {
+        int len = snprintf(message, sizeof(message), "%s", proto_type_name(type));
+        // Cada posição ocupa no máximo 11 carateres, mais o '\n'
+        while (i < n && len + 12 < (int)sizeof(message)) {
+            len += snprintf(message + len, sizeof(message) - len, " %u", pos[i++]);
+            digestStats.positions++;
+        }
+        message[len++] = '\n';
+        message[len] = '\0';
+        session_send(s, message);
+        digestStats.messages++;
+    }
+}
+
+// Envia o resumo completo: cabeçalho com o tamanho e as posições ligadas
+void digest_send_full(Session *s) {
+    if (localDigest.count == NULL)
+        return;
+    char message[MAX_BUFFER];
+    if (s->tlv_tx) {
+        size_t len = tlv_put_digest((uint8_t *)message, localDigest.bits, localDigest.k);
+        session_write(s, message, len);
+    } else {
+        snprintf(message, sizeof(message), "DIGEST %u %d\n", localDigest.bits, localDigest.k);
+        session_send(s, message);
+    }
+    digestStats.messages++;
+    uint32_t pos[64];
+    int n = 0;
+    for (uint32_t p = 0; p < localDigest.bits; p++) {
+        if (!bloom_counter_isset(&localDigest, p))
+            continue;
+        pos[n++] = p;
+        if (n == 64) {
+            digest_send_positions(s, MSG_DIGESTSET, pos, n);
+            n = 0;
+        }
+    }
+    digest_send_positions(s, MSG_DIGESTSET, pos, n);
+}
+
+// Posição do resumo local que mudou: fica pendente até digest_flush()
+void digest_changed(uint32_t pos, int on, void *arg) {
+    (void)on; (void)arg;
+    if (digestResend || bloom_get(&digestDirty, pos))
+        return;
+    if (numDigestPending == DIGEST_PENDING) {
+        digestResend = 1;
+        return;
+    }
+    bloom_set(&digestDirty, pos, 1);
+    digestPending[numDigestPending++] = pos;
+}
+
+// Envia aos vizinhos as posições alteradas desde a última chamada, com o
+// estado atual (uma posição ligada e desligada entretanto não muda nada)
+void digest_flush(void) {
+    if (numDigestPending == 0 && !digestResend)
+        return;
+    uint32_t set[DIGEST_PENDING], clr[DIGEST_PENDING];
+    int nset = 0, nclr = 0;
+    for (int i = 0; i < numDigestPending; i++) {
+        uint32_t p = digestPending[i];
+        bloom_set(&digestDirty, p, 0);
+        if (bloom_counter_isset(&localDigest, p))
+            set[nset++] = p;
+        else
+            clr[nclr++] = p;
+    }
+    numDigestPending = 0;
+    for (int i = 0; i < sessions.count; i++) {
+        Session *s = sessions.list[i];
+        if (s->peer.id == NODEID_NONE)
+            continue;
+        if (digestResend) {
+            digest_send_full(s);
         } else {
-            printf("Formato de mensagem TCP inválido.\n");
+            digest_send_positions(s, MSG_DIGESTSET, set, nset);
+            digest_send_positions(s, MSG_DIGESTCLR, clr, nclr);
+        }
+    }
+    if (digestResend) {
+        memset(digestDirty.map, 0, (digestDirty.bits + 7) / 8);
+        digestResend = 0;
+    }
+}
+
+// Um nome entrou ou saiu do armazém ou da cache
+void local_name_added(const NameView *nv) {
+    if (localDigest.count != NULL)
+        bloom_counter_add(&localDigest, nv->hash, nv->hash2, digest_changed, NULL);
+}
+
+void local_name_removed(const NameView *nv) {
+    if (localDigest.count != NULL)
+        bloom_counter_del(&localDigest, nv->hash, nv->hash2, digest_changed, NULL);
+}
+
+// Guarda na cache um objeto recebido, acompanhando o resumo local
+void cache_object(const NameView *nv) {
+    char evicted[NDN_NAME_MAX + 1];
+    if (cs_insert(&cs, nv, evicted))
+        local_name_added(nv);
+    if (evicted[0] != '\0') {
+        NameView ev;
+        name_view(&ev, evicted);
+        local_name_removed(&ev);
+    }
+}
+
+void wire_print_stats(void) {
+    printf("Mensagens enviadas: %lu em texto (%lu bytes), %lu em binário (%lu bytes), "
+           "%lu interesses retidos por congestionamento, %lu perdidas\n",
+           wireStats.text_msgs, wireStats.text_bytes, wireStats.tlv_msgs, wireStats.tlv_bytes,
+           wireStats.throttled, wireStats.dropped);
+}
+
+// Arena do nó e ocupação dos pools que dela vivem (máximos incluídos)
+void mem_print_stats(void) {
+    arena_print_stats(&arena);
+    pool_print_stats(&pit.entries.pool);
+    pool_print_stats(&pit.faces.pool);
+    pool_print_stats(&fib.entries.pool);
+    pool_print_stats(&msgbufs.pool);
+    pool_print_stats(&sessions.pool.pool);
+}
+
+void heartbeat_print_stats(void) {
+    printf("Batimentos: intervalo %d ms, %d perdidos para falhar, %lu enviados, %lu recebidos, "
+           "%lu vizinhos dados como perdidos (deteção média %.0f ms, máxima %lld ms)\n",
+           hbIntervalMs, hbMisses, hbStats.sent, hbStats.received, hbStats.failures,
+           hbStats.failures ? (double)hbStats.detect_sum / hbStats.failures : 0.0,
+           hbStats.detect_max);
+}
+
+void digest_print_stats(void) {
+    printf("Resumos: %d bits, k=%d, %lu nomes, %lu interesses dirigidos, %lu falsos positivos, "
+           "%lu mensagens com %lu posições enviadas\n", digestBits, digestK, localDigest.names,
+           digestStats.directed, digestStats.false_positives, digestStats.messages,
+           digestStats.positions);
+}
+
+// Mensagens DIGEST, DIGESTSET e DIGESTCLR de um vizinho
+void process_digest(Session *s, const ProtoMsg *m) {
+    if (m->type == MSG_DIGEST) {
+        if (m->bits < 64 || m->bits > BLOOM_MAX_BITS || m->k < 1 || m->k > BLOOM_MAX_K) {
+            printf("Resumo inválido de %s: %u bits, k=%d\n", nodeid_text(s->peer.id).s,
+                   m->bits, m->k);
+            return;
         }
-    } else if (n == 0) {
-        // Conexão fechada pelo cliente
+        if (bloom_reset(&s->digest, m->bits, m->k) < 0)
+            perror("Erro ao reservar o resumo do vizinho");
+        return;
+    }
+    // Sem cabeçalho DIGEST (ou sem memória) as atualizações são ignoradas
+    if (s->digest.map == NULL)
+        return;
+    int on = m->type == MSG_DIGESTSET;
+    const char *p = m->rest.p;
+    uint32_t pos;
+    while (proto_next_position(m, &p, &pos))
+        bloom_set(&s->digest, pos, on);
+}
+
+int session_face(const Session *s) {
+    return s->fd;
+}
+
+// Texto que identifica uma interface da PIT
+const char *face_name(int face) {
+    static NodeIdText buf;
+    if (face == PIT_FACE_LOCAL)
+        return "local";
+    Session *s = session_at(face);
+    if (s == NULL)
+        return "?";
+    buf = nodeid_text(s->peer.id);
+    return buf.s;
+}
+
+// Envia a resposta (type: MSG_OBJECT ou MSG_NOOBJECT) a todas as interfaces
+// que a esperam e apaga a entrada
+void pit_answer(PitEntry *e, MsgType type) {
+    int found = type == MSG_OBJECT;
+    NameView nv = pit_name(e);
+    FanOut fo = FANOUT_INIT;
+    if (found)
+        pit.stats.satisfied++;
+    else
+        pit.stats.failed++;
+    for (PitFace *f = e->faces; f != NULL; f = f->next) {
+        if (!f->reply || (!found && f->told))
+            continue;
+        // A procura cobriu a rede toda exceto o lado da interface que pediu
+        // (não é o caso se alguma interface foi saltada por congestionamento,
+        // ficou sem responder até a entrada expirar ou se as adjacências
+        // mudaram desde que o interesse foi enviado)
+        if (!found && !e->throttled && !e->expired && e->epoch == topologyEpoch)
+            negcache_add(&negcache, &nv, f->face == PIT_FACE_LOCAL ? NEG_SCOPE_ALL : f->face,
+                         now_ms());
+        if (f->face == PIT_FACE_LOCAL)
+            printf(found ? "Objeto %s encontrado\n" : "Objeto %s não encontrado\n", e->name);
+        else
+            send_name_shared(session_at(f->face), type, &nv, &fo);
+    }
+    fanout_done(&fo);
+    pit_remove(&pit, e);
+}
+
+// Entrada sem resposta ao fim de PIT_LIFETIME_MS: um vizinho que não
+// responde nem fecha a ligação não deixa o pedido pendente para sempre
+void pit_expired(void *arg) {
+    PitEntry *e = arg;
+    pit.stats.expired++;
+    e->expired = 1;
+    printf("Interesse em %s expirou sem resposta\n", e->name);
+    pit_answer(e, MSG_NOOBJECT);
+}
+
+// Nonce aleatório (nunca 0) que identifica um pedido ao longo da árvore
+uint32_t new_nonce(void) {
+    uint32_t n;
+    do {
+        n = ((uint32_t)random() << 16) ^ (uint32_t)random();
+    } while (n == 0);
+    return n;
+}
+
+// Envia o interesse da entrada pela sessão, com a codificação partilhada em fo
+void send_interest(Session *s, const PitEntry *e, FanOut *fo) {
+    MsgBuf *b = fo->buf[s->tlv_tx];
+    if (b == NULL) {
+        if ((b = msgbuf_alloc(&msgbufs)) == NULL)
+            return;
+        if (s->tlv_tx)
+            b->len = (uint32_t)tlv_put_name((uint8_t *)b->data, MSG_INTEREST, e->name, e->len,
+                                            e->hash, e->hash2, e->nonce);
+        else
+            b->len = (uint32_t)snprintf(b->data, MSGBUF_SIZE, "INTEREST %s %08x\n", e->name,
+                                        e->nonce);
+        fo->buf[s->tlv_tx] = b;
+    }
+    session_write_buf(s, b);
+}
+
+// Sessão que não pode receber o interesse por estar congestionada; fica
+// registado na entrada
+int forward_throttled(PitEntry *e, const Session *s) {
+    if (!session_congested(s))
+        return 0;
+    wireStats.throttled++;
+    e->throttled = 1;
+    return 1;
+}
+
+// Envia o interesse por todas as sessões que ainda não estão na entrada,
+// exceto exclude; devolve quantas foram usadas
+int pit_flood(PitEntry *e, int exclude) {
+    FanOut fo = FANOUT_INIT;
+    int sent = 0;
+    for (int i = 0; i < sessions.count; i++) {
+        Session *s = sessions.list[i];
+        if (s->fd == exclude || pit_get_face(e, s->fd) != NULL)
+            continue;
+        if (forward_throttled(e, s))
+            continue;
+        if (pit_set_face(&pit, e, s->fd, PIT_WAITING) == 0) {
+            pit.stats.sent++;
+            send_interest(s, e, &fo);
+            sent++;
+        }
+    }
+    fanout_done(&fo);
+    return sent;
+}
+
+// Envia o interesse só às sessões cujo resumo pode conter o nome, exceto
+// exclude; devolve quantas foram usadas
+int digest_forward(PitEntry *e, int exclude) {
+    FanOut fo = FANOUT_INIT;
+    int sent = 0;
+    for (int i = 0; i < sessions.count; i++) {
+        Session *s = sessions.list[i];
+        if (s->fd == exclude || !bloom_test(&s->digest, e->hash, e->hash2))
+            continue;
+        if (forward_throttled(e, s))
+            continue;
+        if (pit_set_face(&pit, e, s->fd, PIT_WAITING) == 0) {
+            pit.stats.sent++;
+            send_interest(s, e, &fo);
+            sent++;
+        }
+    }
+    fanout_done(&fo);
+    return sent;
+}
+
+// Já não há interfaces de saída à espera. Se o interesse só tinha seguido
+// pela rota aprendida (que é esquecida) ou pelos resumos dos vizinhos,
+// tenta-se a inundação; senão responde-se NOOBJECT. exclude é uma
+// interface a não usar (a que fecha).
+void pit_exhausted(PitEntry *e, int exclude) {
+    if (e->routed == PIT_ROUTED_FIB) {
+        NameView nv = pit_name(e);
+        fib_remove(&fib, &nv);
+        printf("Rota para %s falhou, a inundar\n", e->name);
+    } else if (e->routed == PIT_ROUTED_DIGEST) {
+        digestStats.false_positives++;
+        printf("Resumo dos vizinhos falhou para %s, a inundar\n", e->name);
+    }
+    if (e->routed != PIT_FLOODED) {
+        e->routed = PIT_FLOODED;
+        if (pit_flood(e, exclude) > 0)
+            return;
+    }
+    // As adjacências mudaram desde o envio: as respostas negativas podem
+    // vir da topologia antiga, e as sessões novas ainda não foram tentadas
+    if (e->epoch != topologyEpoch && pit_reexpress(e) > 0)
+        return;
+    // Topologia em reparação: a resposta pode estar do outro lado da
+    // ligação perdida, alcançável pelas adjacências que vão aparecer
+    if (timer_pending(&repair.window) && pit_replies(e) > 0) {
+        if (!e->parked) {
+            e->parked = 1;
+            repairStats.parked++;
+            printf("Interesse em %s à espera da reparação da topologia\n", e->name);
+        }
+        return;
+    }
+    pit_answer(e, MSG_NOOBJECT);
+}
+
+// A única interface de saída ainda à espera também pediu o nome: os dois
+// vizinhos enviaram o interesse um ao outro e cada um espera pelo outro.
+// Depois de tentadas todas as outras interfaces, o NOOBJECT diz-lhe que do
+// lado deste nó não há nada, e a resposta dela (que fica a contar como
+// saída) decide a entrada.
+void pit_mutual(PitEntry *e) {
+    PitFace *w = NULL;
+    for (PitFace *f = e->faces; f != NULL; f = f->next) {
+        if (f->state != PIT_WAITING)
+            continue;
+        if (w != NULL)
+            return;
+        w = f;
+    }
+    if (w == NULL || !w->reply || w->told)
+        return;
+    if (e->routed != PIT_FLOODED) {
+        e->routed = PIT_FLOODED;
+        if (pit_flood(e, w->face) > 0)
+            return;
+    }
+    w->told = 1;
+    NameView nv = pit_name(e);
+    send_name_message(session_at(w->face), MSG_NOOBJECT, &nv);
+}
+
+// Uma interface de saída fechou ou juntou-se um pedido à entrada
+void pit_progress(PitEntry *e, int exclude) {
+    if (pit_count(e, PIT_WAITING) == 0)
+        pit_exhausted(e, exclude);
+    else
+        pit_mutual(e);
+}
+
+// Interesse recebido pela interface face (PIT_FACE_LOCAL: comando retrieve).
+// nonce 0: o interesse veio sem nonce e recebe um novo neste nó.
+void handle_interest(const NameView *nv, int face, uint32_t nonce) {
+    const char *name = nv->name;
+    int nlen = (int)nv->len;
+    if (store_contains(&store, nv)) {
+        if (face == PIT_FACE_LOCAL) {
+            printf("Objeto %.*s existe neste nó\n", nlen, name);
+        } else {
+            printf("Interesse em %.*s respondido com objeto local\n", nlen, name);
+            send_name_message(session_at(face), MSG_OBJECT, nv);
+        }
+        return;
+    }
+    if (cs_lookup(&cs, nv)) {
+        if (face == PIT_FACE_LOCAL) {
+            printf("Objeto %.*s encontrado na cache\n", nlen, name);
+        } else {
+            printf("Interesse em %.*s respondido pela cache\n", nlen, name);
+            send_name_message(session_at(face), MSG_OBJECT, nv);
+        }
+        return;
+    }
+    // Pedido repetido de um nome que falhou há pouco: não percorre a árvore
+    if (negcache_lookup(&negcache, nv, face == PIT_FACE_LOCAL ? NEG_SCOPE_ALL : face, now_ms())) {
+        if (face == PIT_FACE_LOCAL) {
+            printf("Objeto %.*s não encontrado (cache negativa)\n", nlen, name);
+        } else {
+            printf("Interesse em %.*s respondido pela cache negativa\n", nlen, name);
+            send_name_message(session_at(face), MSG_NOOBJECT, nv);
+        }
+        return;
+    }
+    // Cópia de um interesse já reencaminhado por este nó: não volta a
+    // inundar a árvore e corta o ciclo respondendo NOOBJECT
+    if (nonce == 0)
+        nonce = new_nonce();
+    uint32_t key = suppress_key(nv->hash, nonce);
+    PitEntry *e = pit_find(&pit, nv);
+    if (face != PIT_FACE_LOCAL && suppress_seen(&suppress, key, now_ms())) {
+        if (e != NULL) {
+            suppress.stats.loop_drops++;
+            printf("Interesse em %.*s voltou por %s: ciclo cortado\n", nlen, name,
+                   face_name(face));
+        } else {
+            suppress.stats.dup_drops++;
+            printf("Interesse repetido em %.*s vindo de %s descartado\n", nlen, name,
+                   face_name(face));
+        }
+        send_name_message(session_at(face), MSG_NOOBJECT, nv);
+        return;
+    }
+    // Já há um interesse pendente (de outro pedido): junta-se a interface
+    // sem reencaminhar. Se o interesse também foi enviado por essa
+    // interface, ela continua de saída e passa a esperar a resposta.
+    if (e != NULL) {
+        if (pit_set_face(&pit, e, face, PIT_RESPONSE) == 0) {
+            pit.stats.aggregated++;
+            printf("Interesse em %.*s agregado ao pendente\n", nlen, name);
+            pit_progress(e, PIT_FACE_LOCAL);
+        }
+        return;
+    }
+    e = pit_insert(&pit, nv);
+    if (e == NULL || pit_set_face(&pit, e, face, PIT_RESPONSE) < 0) {
+        if (e != NULL)
+            pit_remove(&pit, e);
+        if (face != PIT_FACE_LOCAL)
+            send_name_message(session_at(face), MSG_NOOBJECT, nv);
+        return;
+    }
+    e->nonce = nonce;
+    e->epoch = topologyEpoch;
+    timer_init(&e->timer, pit_expired, e);
+    timer_arm_in(&reactor.timers, &e->timer, PIT_LIFETIME_MS);
+    // Com rota aprendida o interesse segue só por ela; senão vai para os
+    // vizinhos cujo resumo tem o nome e, se nenhum o tiver, inunda
+    int route = fib_lookup(&fib, nv, now_ms());
+    Session *rs = route != face ? session_at(route) : NULL;
+    if (rs != NULL && !forward_throttled(e, rs) &&
+        pit_set_face(&pit, e, route, PIT_WAITING) == 0) {
+        fib.stats.hits++;
+        e->routed = PIT_ROUTED_FIB;
+        FanOut fo = FANOUT_INIT;
+        pit.stats.sent++;
+        send_interest(rs, e, &fo);
+        fanout_done(&fo);
+    } else if (digest_forward(e, face) > 0) {
+        digestStats.directed++;
+        e->routed = PIT_ROUTED_DIGEST;
     } else {
+        pit_flood(e, face);
+    }
+    if (pit_count(e, PIT_WAITING) == 0)
+        pit_answer(e, MSG_NOOBJECT);
+    else
+        suppress_record(&suppress, key, now_ms());
+}
+
+void handle_object(const NameView *nv, int face) {
+    negcache_remove(&negcache, nv);
+    PitEntry *e = pit_find(&pit, nv);
+    if (e == NULL) {
+        // Não entra na cache nem no resumo: um vizinho não pode encher a
+        // cache de outro nó com nomes que ninguém pediu
+        printf("Objeto %.*s recebido de %s sem interesse pendente\n", (int)nv->len, nv->name,
+               face_name(face));
+        return;
+    }
+    cache_object(nv);
+    fib_learn(&fib, nv, face, now_ms());
+    // Quem deu o objeto já o tem, mesmo que também o tenha pedido
+    PitFace *f = pit_get_face(e, face);
+    if (f != NULL)
+        f->reply = 0;
+    pit_answer(e, MSG_OBJECT);
+}
+
+void handle_noobject(const NameView *nv, int face) {
+    PitEntry *e = pit_find(&pit, nv);
+    PitFace *f = e ? pit_get_face(e, face) : NULL;
+    if (f == NULL || f->state != PIT_WAITING)
+        return;
+    f->state = PIT_CLOSED;
+    // Só se desiste quando todas as interfaces de saída responderam NOOBJECT
+    pit_progress(e, PIT_FACE_LOCAL);
+}
+
+// Sessão a fechar: a interface deixa de participar nas entradas da PIT
+// e as rotas por ela são esquecidas
+void pit_face_closed(int face) {
+    fib_drop_face(&fib, face);
+    for (int b = 0; b < PIT_BUCKETS; b++) {
+        PitEntry *e = pit.buckets[b];
+        while (e != NULL) {
+            PitEntry *next = e->hnext;
+            int st = pit_drop_face(&pit, e, face);
+            if (st >= 0 && pit_replies(e) == 0)
+                pit_remove(&pit, e);
+            else if (st == PIT_WAITING)
+                pit_progress(e, face);
+            e = next;
+        }
+    }
+}
+
+// ENTRY de um novo vizinho interno
+void process_entry(Session *s, const ProtoMsg *m) {
+    if (m->node == NODEID_NONE) {
+        printf("Endereço inválido no ENTRY: %.*s\n", (int)m->ip.len, m->ip.p);
+        return;
+    }
+    // Outra sessão com o mesmo vizinho é uma ligação antiga que ele já
+    // abandonou (ainda sem EOF ou batimentos em falta deste lado)
+    Session *old = session_identify(s, m->node);
+    if (old != NULL) {
+        printf("Vizinho %s voltou a ligar, fechando a sessão anterior\n",
+               nodeid_text(m->node).s);
+        session_close(old);
+    }
+    add_internal_neighbor(s);
+    if (m->tlv && wireTlv) {
+        s->tlv_peer = 1;
+        tlv_negotiate(s);
+    }
+    // Nó sozinho na rede: o novo nó passa também a ser o seu externo
+    if (is_self(&externalNeighbor)) {
+        externalNeighbor = s->peer;
+        send_addr_message(s, MSG_ENTRY, myId);
+    }
+    send_addr_message(s, MSG_SAFE, externalNeighbor.id);
+    digest_send_full(s);
+    // Nó reencaminhado para aqui por uma reparação: pode ter a resposta
+    // aos interesses parados
+    if (timer_pending(&repair.window))
+        repair_reexpress();
+}
+
+// SAFE do vizinho externo: novo vizinho de salvaguarda
+void process_safe(Session *s, const ProtoMsg *m) {
+    if (m->node == NODEID_NONE) {
+        printf("Endereço inválido no SAFE: %.*s\n", (int)m->ip.len, m->ip.p);
+        return;
+    }
+    safeguardNeighbor.id = m->node;
+    printf("Atualizado vizinho de salvaguarda: %s\n", nodeid_text(safeguardNeighbor.id).s);
+    if (m->tlv && wireTlv) {
+        s->tlv_peer = 1;
+        tlv_negotiate(s);
+    }
+    if (join.session == s && join.state == JOIN_AWAITING_SAFE) {
+        join_set_state(JOIN_ESTABLISHED);
+        join.session = NULL;
+        snprintf(myNet, sizeof(myNet), "%s", join.net);
+        if (join.repair) {
+            repairStats.via_safeguard++;
+            repair_done("pelo vizinho de salvaguarda", 0);
+            return;
+        }
+        printf("Join concluído através de %s em %lld ms\n", nodeid_text(s->peer.id).s,
+               now_ms() - join.started);
+        if (join.registerOnSuccess)
+            perform_registration(join.net);
+    }
+}
+
+/* ---------- reparação da topologia ---------- */
+
+// O vizinho externo mudou: é a nova salvaguarda de todos os internos
+void send_safe_to_internals(void) {
+    for (int i = 0; i < sessions.count; i++) {
+        Session *s = sessions.list[i];
+        if (s->internal)
+            send_addr_message(s, MSG_SAFE, externalNeighbor.id);
+    }
+}
+
+// Perdido o vizinho externo: abre (ou reabre) a janela de reparação
+void repair_begin(void) {
+    repair.started = now_ms();
+    repairStats.losses++;
+    timer_arm_in(&reactor.timers, &repair.window, joinTimeoutMs);
+}
+
+// Perdido um interno: os internos dele vão ligar-se aqui
+void repair_wait(void) {
+    timer_arm_in(&reactor.timers, &repair.window, joinTimeoutMs);
+}
+
+// Reenvia o interesse pelas sessões que ainda não estão na entrada; devolve
+// quantas foram usadas. O nonce é novo: o antigo pode já ter passado pelos
+// nós que agora se alcançam por outro caminho, que o descartariam como cópia.
+int pit_reexpress(PitEntry *e) {
+    uint32_t old = e->nonce;
+    e->nonce = new_nonce();
+    int sent = pit_flood(e, PIT_FACE_LOCAL);
+    if (sent == 0) {
+        e->nonce = old;
+        return 0;
+    }
+    e->epoch = topologyEpoch;
+    e->parked = 0;
+    repairStats.reexpressed++;
+    suppress_record(&suppress, suppress_key(e->hash, e->nonce), now_ms());
+    printf("Interesse em %s reenviado pela topologia nova\n", e->name);
+    return sent;
+}
+
+// Reenvia os interesses parados pelas adjacências novas
+void repair_reexpress(void) {
+    for (int b = 0; b < PIT_BUCKETS; b++) {
+        PitEntry *e = pit.buckets[b];
+        while (e != NULL) {
+            PitEntry *next = e->hnext;
+            if (e->parked)
+                pit_reexpress(e);
+            e = next;
+        }
+    }
+}
+
+// Fim da janela: os interesses ainda parados já não têm por onde seguir
+void repair_window_closed(void *arg) {
+    (void)arg;
+    for (int b = 0; b < PIT_BUCKETS; b++) {
+        PitEntry *e = pit.buckets[b];
+        while (e != NULL) {
+            PitEntry *next = e->hnext;
+            if (e->parked) {
+                e->parked = 0;
+                if (pit_count(e, PIT_WAITING) == 0) {
+                    repairStats.lost++;
+                    pit_answer(e, MSG_NOOBJECT);
+                }
+            }
+            e = next;
+        }
+    }
+}
+
+// Novo vizinho externo definido: avisa os internos e reenvia os interesses
+// parados. Com wait (o nó é a sua salvaguarda) os internos da outra âncora
+// vão ligar-se aqui e a janela fica aberta mais joinTimeoutMs; ligado à
+// salvaguarda, ninguém mais vem e os que ficaram parados já não têm saída.
+void repair_done(const char *how, int wait) {
+    long long dt = now_ms() - repair.started;
+    repairStats.time_sum += dt;
+    if (dt > repairStats.time_max)
+        repairStats.time_max = dt;
+    printf("Topologia reparada em %lld ms (%s): vizinho externo %s\n", dt, how,
+           nodeid_text(externalNeighbor.id).s);
+    if (!is_self(&externalNeighbor))
+        send_safe_to_internals();
+    repair_reexpress();
+    if (wait) {
+        timer_arm_in(&reactor.timers, &repair.window, joinTimeoutMs);
+    } else {
+        timer_cancel(&repair.window);
+        repair_window_closed(NULL);
+    }
+}
+
+// Liga ao vizinho de salvaguarda, que passa a externo; se o nó for a sua
+// própria salvaguarda não há a quem ligar e um interno é promovido
+void repair_external(void) {
+    if (myNet[0] == '\0' || safeguardNeighbor.id == NODEID_NONE || is_self(&safeguardNeighbor)) {
+        repair_promote();
+        return;
+    }
+    printf("Reparação: a ligar ao vizinho de salvaguarda %s\n",
+           nodeid_text(safeguardNeighbor.id).s);
+    Neighbor sg = safeguardNeighbor;
+    sg.fd = -1;
+    if (join_start(myNet, &sg, 1, 0, 1) < 0)
+        repair_promote();
+}
+
+// Sem salvaguarda alcançável: o primeiro interno passa a externo e este nó
+// fica como a sua própria salvaguarda (o interno responde ao ENTRY com um
+// SAFE que o confirma). Sem internos o nó fica sozinho na rede.
+void repair_promote(void) {
+    safeguardNeighbor.id = myId;
+    safeguardNeighbor.fd = -1;
+    Session *s = NULL;
+    for (int i = 0; i < sessions.count && s == NULL; i++)
+        if (sessions.list[i]->internal)
+            s = sessions.list[i];
+    if (s == NULL) {
+        externalNeighbor.id = myId;
+        externalNeighbor.fd = -1;
+        repairStats.alone++;
+        repair_done("sem vizinhos, o nó fica sozinho na rede", 1);
+        return;
+    }
+    externalNeighbor = s->peer;
+    send_addr_message(s, MSG_ENTRY, myId);
+    repairStats.promotions++;
+    repair_done("interno promovido a externo", 1);
+}
+
+void repair_print_stats(void) {
+    unsigned long repaired = repairStats.via_safeguard + repairStats.promotions +
+                             repairStats.alone;
+    printf("Reparações: %lu perdas do vizinho externo, %lu pela salvaguarda, %lu por promoção, "
+           "%lu sozinho, tempo médio %.0f ms (máximo %lld ms); %lu interesses parados, "
+           "%lu reenviados, %lu perdidos\n", repairStats.losses, repairStats.via_safeguard,
+           repairStats.promotions, repairStats.alone,
+           repaired ? (double)repairStats.time_sum / repaired : 0.0, repairStats.time_max,
+           repairStats.parked, repairStats.reexpressed, repairStats.lost);
+}
+
+// Silêncio máximo tolerado ao vizinho da sessão
+long long heartbeat_limit(const Session *s) {
+    long long interval = hbIntervalMs;
+    if (s->hb_peer > interval)
+        interval = s->hb_peer;
+    return interval * hbMisses;
+}
+
+// Intervalo da sessão: envia HELLO se não tiver seguido mais nada por ela
+void session_heartbeat(void *arg) {
+    Session *s = arg;
+    if (!s->hb_sent) {
+        if (s->tlv_tx) {
+            uint8_t frame[TLV_HDR_MAX + 4];
+            session_write(s, frame, tlv_put_hello(frame, (uint32_t)hbIntervalMs));
+        } else {
+            char line[32];
+            session_write(s, line, (size_t)snprintf(line, sizeof(line), "HELLO %d\n", hbIntervalMs));
+        }
+        hbStats.sent++;
+    }
+    s->hb_sent = 0;
+    timer_arm_in(&reactor.timers, &s->hb_tx, hbIntervalMs);
+}
+
+// Prazo de receção da sessão. As leituras só atualizam last_rx; aqui vê-se
+// se o vizinho falou entretanto (o prazo passa para last_rx + limite) ou se
+// ficou calado o limite todo, e nesse caso a ligação é dada como perdida e
+// fechada como se o socket tivesse fechado.
+void session_silent(void *arg) {
+    Session *s = arg;
+    long long now = now_ms(), limit = heartbeat_limit(s), silent = now - s->last_rx;
+    if (silent < limit) {
+        timer_arm(&reactor.timers, &s->hb_rx, s->last_rx + limit);
+        return;
+    }
+    // Há bytes do vizinho por ler: quem esteve parado foi este nó
+    if (fd_pending_bytes(s->fd) > 0) {
+        timer_arm_in(&reactor.timers, &s->hb_rx, hbIntervalMs);
+        return;
+    }
+    printf("Vizinho %s sem sinal há %lld ms (%lld batimentos perdidos): ligação dada como perdida\n",
+           nodeid_text(s->peer.id).s, silent, silent / (limit / hbMisses));
+    hbStats.failures++;
+    hbStats.detect_sum += silent;
+    if (silent > hbStats.detect_max)
+        hbStats.detect_max = silent;
+    session_close(s);
+}
+
+// HELLO do vizinho: passa a ser vigiado com o intervalo que anunciou
+void process_hello(Session *s, const ProtoMsg *m) {
+    hbStats.received++;
+    if (hbIntervalMs == 0)
+        return;
+    s->hb_peer = m->interval;
+    if (s->hb_peer == 0)
+        timer_cancel(&s->hb_rx);
+    else if (!timer_pending(&s->hb_rx))
+        timer_arm(&reactor.timers, &s->hb_rx, s->last_rx + heartbeat_limit(s));
+}
+
+// Mensagem recebida em binário, no mesmo texto que teria no outro formato
+void print_binary_message(const ProtoMsg *m) {
+    const char *type = proto_type_name(m->type);
+    char ip[INET_ADDRSTRLEN];
+    if (m->type == MSG_INTEREST || m->type == MSG_OBJECT || m->type == MSG_NOOBJECT)
+        printf("Mensagem TCP recebida: %s %.*s (binário)\n", type, (int)m->name.len, m->name.p);
+    else if (m->type == MSG_ENTRY || m->type == MSG_SAFE || m->type == MSG_LEAVE)
+        printf("Mensagem TCP recebida: %s %s %d (binário)\n", type, nodeid_ip(m->node, ip),
+               m->port);
+    else
+        printf("Mensagem TCP recebida: trama do tipo %d (binário)\n", (int)m->type);
+}
+
+// Processa uma mensagem completa (linha sem o '\n' ou trama binária)
+// recebida numa sessão. É uma vista para os dados recebidos: os campos não
+// são copiados.
+void process_message(Session *s, const char *line, size_t len) {
+    ProtoMsg m;
+    int ret = s->tlv_rx ? proto_parse_tlv(line, len, &m) : proto_parse(line, len, &m);
+    if (m.type == MSG_DIGEST || m.type == MSG_DIGESTSET || m.type == MSG_DIGESTCLR) {
+        if (ret == PROTO_OK)
+            process_digest(s, &m);
+        else
+            printf("Resumo inválido de %s\n", nodeid_text(s->peer.id).s);
+        return;
+    }
+    // Os batimentos não vão para o ecrã: chegam a cada intervalo
+    if (m.type == MSG_HELLO) {
+        if (ret == PROTO_OK)
+            process_hello(s, &m);
+        return;
+    }
+    if (m.binary)
+        print_binary_message(&m);
+    else
+        printf("Mensagem TCP recebida: %.*s\n", (int)len, line);
+    if (ret != PROTO_OK) {
+        printf("Formato de mensagem TCP inválido.\n");
+        return;
+    }
+    NameView nv;
+    int face = session_face(s);
+    switch (m.type) {
+    case MSG_INTEREST:
+    case MSG_OBJECT:
+    case MSG_NOOBJECT:
+        // O hash do nome é calculado aqui, uma vez, e serve todas as tabelas;
+        // em binário vem já calculado por quem enviou
+        if (m.binary ? !name_view_parse_hashed(&nv, m.name.p, m.name.len, m.hash, m.hash2)
+                     : !name_view_parse(&nv, m.name.p, m.name.len))
+            printf("Nome de objeto inválido: %.*s\n", (int)m.name.len, m.name.p);
+        else if (m.type == MSG_INTEREST)
+            handle_interest(&nv, face, m.nonce);
+        else if (m.type == MSG_OBJECT)
+            handle_object(&nv, face);
+        else
+            handle_noobject(&nv, face);
+        break;
+    case MSG_ENTRY:
+        process_entry(s, &m);
+        break;
+    case MSG_SAFE:
+        process_safe(s, &m);
+        break;
+    case MSG_TLV:
+        // Daqui em diante o vizinho envia tramas binárias
+        if (s->tlv_offered && !m.binary) {
+            s->tlv_rx = 1;
+        } else {
+            printf("Formato binário não negociado, fechando a sessão.\n");
+            session_close(s);
+        }
+        break;
+    case MSG_LEAVE:
+        // O vizinho vai sair da rede: fecha já a sua sessão, sem esperar
+        // pelo EOF. Só a sessão por onde chegou o LEAVE, e só se o endereço
+        // for o do vizinho: um nó não pode fechar a sessão de outro.
+        if (s->peer.id != NODEID_NONE && !nodeid_eq(m.node, s->peer.id)) {
+            printf("LEAVE de %s com o endereço de %s, ignorado\n", nodeid_text(s->peer.id).s,
+                   nodeid_text(m.node).s);
+            break;
+        }
+        printf("Vizinho %s anunciou a saída\n", nodeid_text(m.node).s);
+        session_close(s);
+        break;
+    default:
+        printf("Comando TCP desconhecido: %.*s\n", m.ntok ? (int)m.tok[0].len : 0,
+               m.ntok ? m.tok[0].p : "");
+        break;
+    }
+}
+
+// Despacha as mensagens completas dos dados recebidos. As linhas inteiras
+// são analisadas onde estão; só a parte final sem '\n' é guardada no buffer
+// da sessão, e a leitura seguinte completa-a sem voltar a procurar nela.
+// Devolve -1 se a sessão tiver sido fechada.
+int session_feed(Session *s, const char *data, size_t len) {
+    ProtoBuf pb = {s->rbuf, sizeof(s->rbuf), s->rlen};
+    ProtoInput in = {data, len};
+    StrView msg;
+    int fd = s->fd, ret;
+    // O formato pode mudar a meio dos dados, depois da linha "TLV"
+    while ((ret = s->tlv_rx ? proto_next_frame(&pb, &in, &msg)
+                            : proto_next_line(&pb, &in, &msg)) == PROTO_LINE) {
+        process_message(s, msg.p, msg.len);
+        if (session_at(fd) != s)
+            return -1;
+    }
+    if (ret == PROTO_OVERFLOW) {
+        printf("Mensagem TCP demasiado longa, fechando a sessão.\n");
+        session_close(s);
+        return -1;
+    }
+    s->rlen = pb.len;
+    return 0;
+}
+
+// Dados recebidos numa sessão TCP (len == 0: conexão fechada, len < 0: erro)
+void handle_session(Reactor *r, int fd, const char *data, ssize_t len, void *arg) {
+    (void)r; (void)fd;
+    Session *s = arg;
+    if (len > 0) {
+        if (hbIntervalMs > 0)
+            s->last_rx = now_ms();
+        session_feed(s, data, (size_t)len);
+        return;
+    }
+    if (len < 0)
         perror("Erro na leitura do socket do cliente");
+    session_close(s);
+}
+
+// Abandona a tentativa atual de join (sem tocar no estado global do join)
+void join_abort_attempt(void) {
+    if (join.session != NULL) {
+        Session *js = join.session;
+        join.session = NULL;
+        if (externalNeighbor.fd == js->fd)
+            externalNeighbor.fd = -1;
+        session_close(js);
+    } else if (join.fd >= 0) {
+        reactor_del(&reactor, join.fd);
+        close(join.fd);
     }
-    close(client_sock);
+    join.fd = -1;
+    if (externalNeighbor.fd < 0 && !is_self(&externalNeighbor))
+        externalNeighbor.id = NODEID_NONE;
+}
+
+// connect() concluído (com ou sem sucesso) no socket da tentativa atual
+void handle_join_connect(Reactor *r, int fd, uint32_t events, void *arg) {
+    (void)events; (void)arg;
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+        err = errno;
+    if (err == EINPROGRESS)
+        return;
+    reactor_del(r, fd);
+    Neighbor *target = &join.candidates[join.next - 1];
+    if (err != 0) {
+        printf("Join: falha ao ligar a %s: %s\n", nodeid_text(target->id).s, strerror(err));
+        close(fd);
+        join.fd = -1;
+        join_try_next();
+        return;
+    }
+    // A ligação fica aberta: é a sessão com o vizinho externo
+    Session *s = session_open(fd);
+    if (s == NULL) {
+        printf("Join: sem recursos para a sessão com %s\n", nodeid_text(target->id).s);
+        close(fd);
+        join.fd = -1;
+        join_try_next();
+        return;
+    }
+    join.session = s;
+    // Uma sessão anterior com o mesmo nó sairia da tabela de ids e ficaria
+    // órfã: fecha-se, como no ENTRY
+    Session *old = session_identify(s, target->id);
+    if (old != NULL) {
+        printf("Join: já havia uma sessão com %s, fechando a anterior\n",
+               nodeid_text(target->id).s);
+        session_close(old);
+    }
+    // O externo fica definido desde já, para responder a um ENTRY do próprio vizinho
+    externalNeighbor = s->peer;
+    join_set_state(JOIN_ENTRY_SENT);
+    if (send_addr_message(s, MSG_ENTRY, myId) < 0) {
+        join_abort_attempt();
+        join_try_next();
+        return;
+    }
+    printf("Enviado ENTRY para %s\n", nodeid_text(target->id).s);
+    digest_send_full(s);
+    join_set_state(JOIN_AWAITING_SAFE);
+}
+
+// Inicia o connect() não bloqueante para o próximo candidato da lista
+void join_try_next(void) {
+    while (join.next < join.numCandidates) {
+        Neighbor *target = &join.candidates[join.next++];
+        struct sockaddr_in serv_addr;
+        int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        if (sockfd < 0) {
+            perror("Erro ao criar socket para direct join");
+            break;
+        }
+        set_nonblocking(sockfd);
+        memset(&serv_addr, 0, sizeof(serv_addr));
+        serv_addr.sin_family = AF_INET;
+        serv_addr.sin_port = htons(nodeid_port(target->id));
+        serv_addr.sin_addr.s_addr = htonl(nodeid_addr(target->id));
+        printf("Join: tentando %s\n", nodeid_text(target->id).s);
+        timer_arm_in(&reactor.timers, &join.timer, joinTimeoutMs);
+        join.fd = sockfd;
+        join_set_state(JOIN_CONNECTING);
+        if (connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0 &&
+            errno != EINPROGRESS) {
+            perror("Erro ao conectar para direct join");
+            close(sockfd);
+            join.fd = -1;
+            continue;
+        }
+        // Conclusão (imediata ou não) é sinalizada como socket pronto para escrita
+        if (reactor_add(&reactor, sockfd, REACTOR_WRITE, handle_join_connect, NULL) < 0) {
+            close(sockfd);
+            join.fd = -1;
+            continue;
+        }
+        return;
+    }
+    printf("Join na rede %s falhou: nenhum candidato respondeu.\n", join.net);
+    timer_cancel(&join.timer);
+    join.state = JOIN_IDLE;
+    join.fd = -1;
+    if (join.repair) {
+        join.repair = 0;
+        repair_promote();
+    }
+}
+
+// A tentativa atual não terminou a tempo: passa ao candidato seguinte
+void join_expired(void *arg) {
+    (void)arg;
+    if (join.state == JOIN_IDLE || join.state == JOIN_ESTABLISHED)
+        return;
+    Neighbor *target = &join.candidates[join.next - 1];
+    printf("Join: %s não respondeu em %d ms (estado %s)\n", nodeid_text(target->id).s,
+           joinTimeoutMs, join_state_name(join.state));
+    join_abort_attempt();
+    join_try_next();
+}
+
+// Inicia um join não bloqueante com a lista de candidatos dada (-1 se já houver outro).
+// repair: join de reparação, que termina em repair_done() ou repair_promote().
+int join_start(const char *net, const Neighbor *candidates, int n, int registerOnSuccess,
+               int repair) {
+    if (join.state != JOIN_IDLE && join.state != JOIN_ESTABLISHED) {
+        printf("Já existe um join em curso.\n");
+        return -1;
+    }
+    timer_cancel(&join.timer);
+    memset(&join, 0, sizeof(join));
+    join.fd = -1;
+    timer_init(&join.timer, join_expired, NULL);
+    snprintf(join.net, sizeof(join.net), "%s", net);
+    join.registerOnSuccess = registerOnSuccess;
+    join.repair = repair;
+    join.started = now_ms();
+    for (int i = 0; i < n && i < MAX_CANDIDATES; i++)
+        join.candidates[join.numCandidates++] = candidates[i];
+    join_try_next();
+    return 0;
 }
 
 // Função para realizar o direct join (comando "dj" ou "j")
-// Se connectIP for "0.0.0.0", cria a rede com apenas este nó
-void direct_join(const char *net, const char *connectIP, int connectPort) {
+// Se connectIP for "0.0.0.0", cria a rede com apenas este nó.
+// Caso contrário o join decorre em segundo plano, sem bloquear o nó.
+void direct_join(const char *net, const char *connectIP, int connectPort, int registerOnSuccess) {
     // Se connectIP for "0.0.0.0", cria rede com o nó próprio
     if (strcmp(connectIP, "0.0.0.0") == 0) {
         printf("Criando rede com este nó (primeiro nó).\n");
-        strcpy(externalNeighbor.ip, myIP);
-        externalNeighbor.port = myPort;
-        strcpy(safeguardNeighbor.ip, myIP);
-        safeguardNeighbor.port = myPort;
+        externalNeighbor.id = myId;
+        externalNeighbor.fd = -1;
+        safeguardNeighbor.id = myId;
+        snprintf(myNet, sizeof(myNet), "%s", net);
+        if (registerOnSuccess)
+            perform_registration(net);
         return;
     }
 
-    // Caso contrário, conecta-se ao nó indicado via TCP
-    int sockfd;
-    struct sockaddr_in serv_addr;
-    sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sockfd < 0) {
-        perror("Erro ao criar socket para direct join");
+    Neighbor target = {NODEID_NONE, -1};
+    if (nodeid_parse_str(connectIP, connectPort, &target.id) < 0) {
+        printf("Endereço inválido para o join: %s %d (IPv4 e porta)\n", connectIP, connectPort);
         return;
     }
-    memset(&serv_addr, 0, sizeof(serv_addr));
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(connectPort);
-    serv_addr.sin_addr.s_addr = inet_addr(connectIP);
-    if (connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-        perror("Erro ao conectar para direct join");
-        close(sockfd);
-        return;
-    }
-    char message[MAX_BUFFER];
-    snprintf(message, sizeof(message), "ENTRY %s %d\n", myIP, myPort);
-    write(sockfd, message, strlen(message));
-    printf("Enviado ENTRY para %s:%d\n", connectIP, connectPort);
-    // Atualiza o vizinho externo deste nó
-    strcpy(externalNeighbor.ip, connectIP);
-    externalNeighbor.port = connectPort;
-    close(sockfd);
+    join_start(net, &target, 1, registerOnSuccess, 0);
+}
+
+// Resposta (ou falta dela) a um REG
+void on_registration(RegClient *rc, const RegRequest *req, const char *reply, void *arg) {
+    (void)rc; (void)arg;
+    if (reply == NULL)
+        printf("Registo na rede %s falhou: servidor sem resposta.\n", req->net);
+    else
+        printf("Registo na rede %s confirmado.\n", req->net);
 }
 
-// Função para enviar mensagem de registro via UDP
+// Função para enviar mensagem de registro via UDP; a confirmação (OKREG)
+// chega mais tarde pelo reactor e o REG é repetido enquanto não chegar
 int perform_registration(const char *net) {
-    char reg_msg[MAX_BUFFER];
-    snprintf(reg_msg, sizeof(reg_msg), "REG %s %s %s", net, myIP, myTCP);
-    if(sendto(udp_sock, reg_msg, strlen(reg_msg), 0,
-              (struct sockaddr*)&server_addr, server_addr_len) < 0) {
-        perror("Erro no sendto REG");
+    if (regclient_send(&regclient, REG_OP_REG, net, myIP, myTCP, on_registration, NULL) < 0)
         return -1;
-    }
-    printf("Enviado REG via UDP: %s\n", reg_msg);
+    printf("Enviado REG via UDP: REG %s %s %s\n", net, myIP, myTCP);
     return 0;
 }
 
+// NODESLIST recebido: os nós listados passam a candidatos do join.
+// Se a lista estiver vazia este nó cria a rede.
+void on_nodeslist(RegClient *rc, const RegRequest *req, const char *reply, void *arg) {
+    (void)rc; (void)arg;
+    if (reply == NULL) {
+        printf("Join na rede %s falhou: servidor de registo sem resposta.\n", req->net);
+        return;
+    }
+    Neighbor candidates[MAX_CANDIDATES];
+    int n = 0;
+    ProtoLines it;
+    StrView line;
+    proto_lines_init(&it, reply, strlen(reply));
+    proto_lines_next(&it, &line);  // "NODESLIST net"
+    while (n < MAX_CANDIDATES && proto_lines_next(&it, &line)) {
+        Neighbor *c = &candidates[n];
+        if (proto_parse_node_id(line, &c->id) == 0 && !is_self(c)) {
+            c->fd = -1;
+            n++;
+        }
+    }
+    printf("NODESLIST %s: %d candidato(s)\n", req->net, n);
+    if (n == 0) {
+        direct_join(req->net, "0.0.0.0", 0, 1);
+        return;
+    }
+    if (join_start(req->net, candidates, n, 1, 0) == 0)
+        join.started = req->first_sent;  // a latência inclui o pedido NODES
+}
+
+// Resposta (ou falta dela) a um UNREG
+void on_unregistration(RegClient *rc, const RegRequest *req, const char *reply, void *arg) {
+    (void)rc; (void)arg;
+    if (reply == NULL)
+        printf("Saída da rede %s: servidor de registo sem resposta ao UNREG.\n", req->net);
+    else
+        printf("Registo na rede %s retirado.\n", req->net);
+}
+
+// Sai da rede (comando "l"): envia LEAVE a todos os vizinhos, fecha as
+// sessões e retira o registo. Os vizinhos fecham a sessão ao receber o
+// LEAVE e reparam a topologia do seu lado; este nó não repara nada, porque
+// o externo é esquecido antes de as sessões fecharem.
+void leave_network(void) {
+    if (myNet[0] == '\0' && join.state == JOIN_IDLE) {
+        printf("O nó não está em nenhuma rede.\n");
+        return;
+    }
+    if (join.state != JOIN_IDLE && join.state != JOIN_ESTABLISHED) {
+        join_abort_attempt();
+        timer_cancel(&join.timer);
+        join.state = JOIN_IDLE;
+    }
+    externalNeighbor.id = NODEID_NONE;
+    externalNeighbor.fd = -1;
+    safeguardNeighbor = externalNeighbor;
+    while (sessions.count > 0) {
+        Session *s = sessions.list[sessions.count - 1];
+        send_addr_message(s, MSG_LEAVE, myId);
+        session_close(s);
+    }
+    // Sem vizinhos os interesses parados já não têm por onde seguir
+    if (timer_pending(&repair.window)) {
+        timer_cancel(&repair.window);
+        repair_window_closed(NULL);
+    }
+    if (myNet[0] != '\0') {
+        if (regclient_send(&regclient, REG_OP_UNREG, myNet, myIP, myTCP, on_unregistration,
+                           NULL) == 0)
+            printf("Enviado UNREG via UDP: UNREG %s %s %s\n", myNet, myIP, myTCP);
+        printf("Saída da rede %s\n", myNet);
+    }
+    myNet[0] = '\0';
+}
+
 // Função para enviar comando de join via UDP
 int perform_join(const char *net) {
-    char msg[MAX_BUFFER];
-    snprintf(msg, sizeof(msg), "NODES %s", net);
-    if(sendto(udp_sock, msg, strlen(msg), 0,
-              (struct sockaddr*)&server_addr, server_addr_len) < 0) {
-        perror("Erro no sendto NODES");
+    if (regclient_send(&regclient, REG_OP_NODES, net, NULL, NULL, on_nodeslist, NULL) < 0)
         return -1;
-    }
-    printf("Enviado NODES via UDP: %s\n", msg);
+    printf("Enviado NODES via UDP: NODES %s\n", net);
     return 0;
 }
 
-int main(int argc, char *argv[]) {
-    // Uso: ./ndn cache IP TCP regIP regUDP
-    if (argc < 6) {
-        fprintf(stderr, "Uso: %s cache IP TCP regIP regUDP\n", argv[0]);
-        exit(EXIT_FAILURE);
+// Trata uma linha de comando introduzida pelo utilizador
+void process_command(Reactor *r, char *input) {
+    input[strcspn(input, "\n")] = 0;
+    // Comando direct join: dj net connectIP connectTCP
+    if (strncmp(input, "dj", 2) == 0) {
+        char cmd[10], net[16], connectIP[INET_ADDRSTRLEN];
+        int connectPort;
+        if (sscanf(input, "%9s %15s %15s %d", cmd, net, connectIP, &connectPort) == 4) {
+            // Após o direct join, regista via UDP
+            direct_join(net, connectIP, connectPort, 1);
+        } else {
+            printf("Formato inválido para dj. Uso: dj net connectIP connectTCP\n");
+        }
+    }
+    // Comando join: j net
+    else if (strncmp(input, "j", 1) == 0) {
+        char cmd[10], net[16];
+        if (sscanf(input, "%9s %15s", cmd, net) == 2) {
+            // Pede a lista de nós; o join continua em on_nodeslist e regista no fim
+            perform_join(net);
+        } else {
+            printf("Formato inválido para join. Uso: j net\n");
+        }
+    }
+    // Comando create: c name
+    else if (strncmp(input, "c ", 2) == 0) {
+        char name[NDN_NAME_MAX + 1];
+        NameView nv;
+        if (sscanf(input + 2, "%100s", name) == 1 && name_view_parse(&nv, name, strlen(name))) {
+            int ret = store_add(&store, &nv);
+            if (ret > 0) {
+                local_name_added(&nv);
+                negcache_remove(&negcache, &nv);
+                printf("Objeto %s criado\n", name);
+            } else if (ret == 0)
+                printf("Objeto %s já existe\n", name);
+            else
+                printf("Sem memória para criar o objeto %s\n", name);
+        } else {
+            printf("Formato inválido para create. Uso: c name (alfanumérico, até %d carateres)\n",
+                   NDN_NAME_MAX);
+        }
+    }
+    // Comando delete: dl name
+    else if (strncmp(input, "dl ", 3) == 0) {
+        char name[NDN_NAME_MAX + 1];
+        NameView nv;
+        if (sscanf(input + 3, "%100s", name) == 1) {
+            name_view(&nv, name);
+            if (store_remove(&store, &nv)) {
+                local_name_removed(&nv);
+                printf("Objeto %s apagado\n", name);
+            } else
+                printf("Objeto %s não existe\n", name);
+        } else {
+            printf("Formato inválido para delete. Uso: dl name\n");
+        }
+    }
+    // Comando show names: sn
+    else if (strncmp(input, "sn", 2) == 0) {
+        store_print(&store);
+    }
+    // Comando retrieve: r name
+    else if (strncmp(input, "r ", 2) == 0) {
+        char name[NDN_NAME_MAX + 1];
+        NameView nv;
+        if (sscanf(input + 2, "%100s", name) == 1 && name_view_parse(&nv, name, strlen(name))) {
+            handle_interest(&nv, PIT_FACE_LOCAL, 0);
+        } else {
+            printf("Formato inválido para retrieve. Uso: r name\n");
+        }
+    }
+    // Comando para mostrar a tabela de interesses pendentes: si
+    else if (strncmp(input, "si", 2) == 0) {
+        pit_print(&pit, face_name);
+        timer_print_stats(&reactor.timers);
+        session_table_print_stats();
+        heartbeat_print_stats();
+        repair_print_stats();
+        suppress_print_stats(&suppress);
+        digest_print_stats();
+        wire_print_stats();
+        msgbuf_print_stats(&msgbufs);
+        mem_print_stats();
+    }
+    // Comando para mostrar a topologia: st
+    else if (strncmp(input, "st", 2) == 0) {
+        show_topology();
+    }
+    // Comando leave: l
+    else if (strcmp(input, "l") == 0 || strcmp(input, "leave") == 0) {
+        leave_network();
+    }
+    // Comando para sair: x
+    else if (strncmp(input, "x", 1) == 0) {
+        printf("Saindo...\n");
+        reactor_stop(r);
+    }
+    else {
+        printf("Comando não reconhecido.\n");
+    }
+}
+
+// STDIN pronto: processa todas as linhas já disponíveis
+void handle_stdin(Reactor *r, int fd, uint32_t events, void *arg) {
+    (void)events; (void)arg;
+    // Um aviso de prontidão pode chegar depois de a linha já ter sido lida
+    // numa chamada anterior (io_uring entrega um por cada chegada de
+    // dados): sem nada por ler, o fgets bloquearia o reactor inteiro
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    if (poll(&pfd, 1, 0) == 0)
+        return;
+    do {
+        char input[MAX_BUFFER];
+        if (fgets(input, MAX_BUFFER, stdin) == NULL) {
+            reactor_stop(r);  // EOF no STDIN
+            return;
+        }
+        process_command(r, input);
+    } while (r->running && fd_pending_bytes(fd) > 0);
+}
+
+// Nova conexão aceite no socket do servidor TCP
+void handle_accept(Reactor *r, int lfd, int new_sock, void *arg) {
+    (void)r; (void)lfd; (void)arg;
+    if (session_open(new_sock) == NULL) {
+        printf("Sem recursos para uma nova sessão (descritor %d). Fechando nova conexão.\n",
+               new_sock);
+        close(new_sock);
+    }
+}
+
+// Processa mensagens UDP (ex: respostas do servidor de nós)
+void handle_udp(Reactor *r, int fd, uint32_t events, void *arg) {
+    (void)r; (void)events; (void)arg;
+    char udp_buffer[MAX_BUFFER * 4];  // NODESLIST pode trazer vários nós
+    ssize_t n;
+    while ((n = recvfrom(fd, udp_buffer, sizeof(udp_buffer) - 1, 0, NULL, NULL)) > 0) {
+        udp_buffer[n] = '\0';
+        if (!regclient_handle(&regclient, udp_buffer))
+            printf("Mensagem UDP sem pedido correspondente: %s\n", udp_buffer);
+    }
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Uso: %s cache IP TCP regIP regUDP [-t join_ms] [-b digest_bits] [-k digest_hashes] "
+            "[-n neg_ttl_ms] [-p lru|clock|s3fifo|arc] [-a] [-w text|tlv] [-h heartbeat_ms] "
+            "[-m misses] [-r route_ttl_ms]\n",
+            prog);
+    exit(EXIT_FAILURE);
+}
+
+// Opções após os argumentos posicionais
+void parse_options(int argc, char *argv[], const char *prog) {
+    int opt;
+    while ((opt = getopt(argc, argv, "t:b:k:n:p:aw:h:m:r:")) != -1) {
+        switch (opt) {
+        case 't':
+            joinTimeoutMs = atoi(optarg);
+            if (joinTimeoutMs <= 0)
+                usage(prog);
+            break;
+        case 'b':
+            digestBits = atoi(optarg);
+            if (digestBits != 0 && (digestBits < 64 || digestBits > (int)BLOOM_MAX_BITS))
+                usage(prog);
+            break;
+        case 'k':
+            digestK = atoi(optarg);
+            if (digestK < 1 || digestK > BLOOM_MAX_K)
+                usage(prog);
+            break;
+        case 'n':
+            negTtlMs = atoi(optarg);
+            if (negTtlMs < 0)
+                usage(prog);
+            break;
+        case 'p':
+            csPolicy = cs_policy_find(optarg);
+            if (csPolicy == NULL)
+                usage(prog);
+            break;
+        case 'a':
+            csTinyLfu = 1;
+            break;
+        case 'w':
+            if (strcmp(optarg, "tlv") == 0)
+                wireTlv = 1;
+            else if (strcmp(optarg, "text") == 0)
+                wireTlv = 0;
+            else
+                usage(prog);
+            break;
+        case 'h':
+            hbIntervalMs = atoi(optarg);
+            if (hbIntervalMs < 0)
+                usage(prog);
+            break;
+        case 'm':
+            // Com o HELLO suprimido pelo tráfego, o vizinho pode ficar até dois
+            // intervalos sem enviar nada
+            hbMisses = atoi(optarg);
+            if (hbMisses < 2)
+                usage(prog);
+            break;
+        case 'r':
+            routeTtlMs = atoi(optarg);
+            if (routeTtlMs < 0)
+                usage(prog);
+            break;
+        default:
+            usage(prog);
+        }
     }
+}
+
+int main(int argc, char *argv[]) {
+    // Uso: ./ndn cache IP TCP regIP regUDP [-t join_ms] [-b digest_bits] [-k digest_hashes]
+    //      [-n neg_ttl_ms] [-p lru|clock|s3fifo|arc] [-a] [-w text|tlv] [-h heartbeat_ms]
+    //      [-m misses] [-r route_ttl_ms]
+    if (argc < 6)
+        usage(argv[0]);
+    parse_options(argc - 5, argv + 5, argv[0]);
     int cache_size = atoi(argv[1]);
+    if (cache_size < 0)
+        usage(argv[0]);
     strcpy(myIP, argv[2]);
     strcpy(myTCP, argv[3]);          // armazena a porta TCP como string
     myPort = atoi(argv[3]);          // converte para inteiro para operações locais
+    if (nodeid_parse_str(myIP, myPort, &myId) < 0) {
+        fprintf(stderr, "Endereço do nó inválido: %s %s (IPv4 e porta TCP)\n", argv[2], argv[3]);
+        exit(EXIT_FAILURE);
+    }
     const char *regIP = argv[4];
     const char *regUDP = argv[5];
 
     printf("Iniciando nó NDN: %s:%d, cache=%d, reg server %s:%s\n",
            myIP, myPort, cache_size, regIP, regUDP);
 
+    // Cada vizinho é um descritor: um nó com milhares de internos precisa
+    // do limite máximo permitido, não do habitual 1024
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
     // Configuração do socket do servidor TCP
-    int server_sock;
     struct sockaddr_in serv_addr;
     server_sock = socket(AF_INET, SOCK_STREAM, 0);
     if (server_sock < 0) {
@@ -188,7 +2094,7 @@ int main(int argc, char *argv[]) {
         perror("Erro no bind TCP do servidor");
         exit(EXIT_FAILURE);
     }
-    if (listen(server_sock, 5) < 0) {
+    if (listen(server_sock, SOMAXCONN) < 0) {
         perror("Erro no listen TCP do servidor");
         exit(EXIT_FAILURE);
     }
@@ -214,147 +2120,81 @@ int main(int argc, char *argv[]) {
     freeaddrinfo(res);
     printf("Socket UDP configurado para o servidor %s:%s\n", regIP, regUDP);
 
-    // Array para armazenar sockets de clientes TCP conectados
-    int client_socks[MAX_CLIENTS];
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        client_socks[i] = -1;
-    }
-
-    // Loop principal: multiplexa STDIN, o socket do servidor TCP, os sockets dos clientes e o socket UDP
-    while (1) {
-        fd_set read_fds;
-        FD_ZERO(&read_fds);
-        // Adiciona STDIN
-        FD_SET(STDIN_FILENO, &read_fds);
-        int max_fd = STDIN_FILENO;
-        // Adiciona o socket do servidor TCP
-        FD_SET(server_sock, &read_fds);
-        if (server_sock > max_fd)
-            max_fd = server_sock;
-        // Adiciona os sockets dos clientes TCP
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            if (client_socks[i] != -1) {
-                FD_SET(client_socks[i], &read_fds);
-                if (client_socks[i] > max_fd)
-                    max_fd = client_socks[i];
-            }
-        }
-        // Adiciona o socket UDP
-        FD_SET(udp_sock, &read_fds);
-        if (udp_sock > max_fd)
-            max_fd = udp_sock;
-
-        int activity = select(max_fd + 1, &read_fds, NULL, NULL, NULL);
-        if (activity < 0) {
-            if (errno == EINTR)
-                continue;
-            perror("Erro no select");
-            break;
-        }
-
-        // Processa comandos do usuário via STDIN
-        if (FD_ISSET(STDIN_FILENO, &read_fds)) {
-            char input[MAX_BUFFER];
-            if (fgets(input, MAX_BUFFER, stdin) != NULL) {
-                input[strcspn(input, "\n")] = 0;
-                // Comando direct join: dj net connectIP connectTCP
-                if (strncmp(input, "dj", 2) == 0) {
-                    char cmd[10], net[16], connectIP[INET_ADDRSTRLEN];
-                    int connectPort;
-                    if (sscanf(input, "%s %s %s %d", cmd, net, connectIP, &connectPort) == 4) {
-                        direct_join(net, connectIP, connectPort);
-                        // Após direct join, regista via UDP
-                        perform_registration(net);
-                    } else {
-                        printf("Formato inválido para dj. Uso: dj net connectIP connectTCP\n");
-                    }
-                }
-                // Comando join: j net
-                else if (strncmp(input, "j", 1) == 0) {
-                    char cmd[10], net[16];
-                    if (sscanf(input, "%s %s", cmd, net) == 2) {
-                        // Simulação: solicita os dados de conexão via STDIN
-                        char connectIP[INET_ADDRSTRLEN];
-                        char portStr[10];
-                        int connectPort;
-                        printf("Informe connectIP (ou 0.0.0.0 para criar rede): ");
-                        if(fgets(connectIP, sizeof(connectIP), stdin)==NULL) continue;
-                        connectIP[strcspn(connectIP, "\n")] = 0;
-                        if(strcmp(connectIP, "0.0.0.0") != 0) {
-                            printf("Informe connectPort: ");
-                            if(fgets(portStr, sizeof(portStr), stdin)==NULL) continue;
-                            connectPort = atoi(portStr);
-                        } else {
-                            connectPort = 0;
-                        }
-                        direct_join(net, connectIP, connectPort);
-                        // Envia NODES via UDP para obter lista de nós e registrar
-                        perform_join(net);
-                        perform_registration(net);
-                    } else {
-                        printf("Formato inválido para join. Uso: j net\n");
-                    }
-                }
-                // Comando para mostrar a topologia: st
-                else if (strncmp(input, "st", 2) == 0) {
-                    show_topology();
-                }
-                // Comando para sair: x
-                else if (strncmp(input, "x", 1) == 0) {
-                    printf("Saindo...\n");
-                    break;
-                }
-                else {
-                    printf("Comando não reconhecido.\n");
-                }
-            }
-        }
-
-        // Processa novas conexões no socket do servidor TCP
-        if (FD_ISSET(server_sock, &read_fds)) {
-            struct sockaddr_in cli_addr;
-            socklen_t cli_len = sizeof(cli_addr);
-            int new_sock = accept(server_sock, (struct sockaddr *)&cli_addr, &cli_len);
-            if (new_sock < 0) {
-                perror("Erro no accept");
-            } else {
-                // Adiciona o novo socket ao array de clientes
-                int adicionado = 0;
-                for (int i = 0; i < MAX_CLIENTS; i++) {
-                    if (client_socks[i] == -1) {
-                        client_socks[i] = new_sock;
-                        adicionado = 1;
-                        break;
-                    }
-                }
-                if (!adicionado) {
-                    printf("Número máximo de conexões atingido. Fechando nova conexão.\n");
-                    close(new_sock);
-                }
-            }
-        }
+    if (cs_init(&cs, cache_size, csPolicy) < 0 || (csTinyLfu && cs_enable_tinylfu(&cs) < 0))
+        exit(EXIT_FAILURE);
+    negcache_init(&negcache, negTtlMs);
+    arena_init(&arena);
+    pit_init(&pit, &arena);
+    msgbuf_pool_init(&msgbufs, &arena);
+    session_table_init(&sessions, &arena);
+    suppress_init(&suppress, SUPPRESS_PERIOD);
+    srandom((unsigned)(time(NULL) ^ getpid()));
+    fib_init(&fib, routeTtlMs, &arena);
+    if (pool_reserve(&pit.entries.pool, MEM_PREWARM) < 0 ||
+        pool_reserve(&pit.faces.pool, MEM_PREWARM) < 0 ||
+        pool_reserve(&fib.entries.pool, MEM_PREWARM) < 0 ||
+        pool_reserve(&msgbufs.pool, MEM_PREWARM) < 0)
+        exit(EXIT_FAILURE);
+    if (store_init(&store) < 0)
+        exit(EXIT_FAILURE);
+    // -b 0: o nó não anuncia resumo, mas usa os que recebe
+    if (digestBits > 0 && (bloom_counter_init(&localDigest, digestBits, digestK) < 0 ||
+                           bloom_init(&digestDirty, digestBits, 1) < 0)) {
+        perror("Erro ao reservar o resumo de nomes");
+        exit(EXIT_FAILURE);
+    }
 
-        // Processa mensagens UDP (ex: respostas do servidor de nós)
-        if (FD_ISSET(udp_sock, &read_fds)) {
-            char udp_buffer[MAX_BUFFER];
-            ssize_t n = recvfrom(udp_sock, udp_buffer, MAX_BUFFER - 1, 0, NULL, NULL);
-            if (n > 0) {
-                udp_buffer[n] = '\0';
-                printf("Mensagem UDP recebida: %s\n", udp_buffer);
-                // Aqui você pode implementar o tratamento de OKREG, NODESLIST, etc.
-            }
-        }
+    // Regista cada descritor uma única vez no reactor
+    if (reactor_init(&reactor) < 0)
+        exit(EXIT_FAILURE);
+    set_nonblocking(udp_sock);
+    regclient_init(&regclient, udp_sock, (struct sockaddr *)&server_addr, server_addr_len,
+                   &reactor.timers);
+    timer_init(&repair.window, repair_window_closed, NULL);
+    setvbuf(stdin, NULL, _IONBF, 0);
+    if (reactor_add(&reactor, STDIN_FILENO, REACTOR_READ, handle_stdin, NULL) < 0 ||
+        reactor_add_listener(&reactor, server_sock, handle_accept, NULL) < 0 ||
+        reactor_add(&reactor, udp_sock, REACTOR_READ | REACTOR_ET, handle_udp, NULL) < 0) {
+        exit(EXIT_FAILURE);
+    }
 
-        // Processa dados dos sockets de clientes TCP
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            if (client_socks[i] != -1 && FD_ISSET(client_socks[i], &read_fds)) {
-                process_client_message(client_socks[i]);
-                client_socks[i] = -1; // marca o socket como fechado
-            }
-        }
+    // Loop principal: cada iteração só toca nos descritores prontos; os
+    // prazos (join, retransmissões UDP, entradas da PIT, batimentos) são
+    // temporizadores da roda do reactor, que acorda a tempo de os disparar
+    reactor.running = 1;
+    while (reactor.running) {
+        if (reactor_run_once(&reactor, -1) < 0)
+            break;
+        digest_flush();
     }
 
+    reactor_print_stats(&reactor);
+    timer_print_stats(&reactor.timers);
+    session_table_print_stats();
+    heartbeat_print_stats();
+    repair_print_stats();
+    regclient_print_stats(&regclient);
+    cs_print_stats(&cs);
+    negcache_print_stats(&negcache);
+    pit_print_stats(&pit);
+    store_print_stats(&store);
+    suppress_print_stats(&suppress);
+    fib_print_stats(&fib);
+    digest_print_stats();
+    wire_print_stats();
+    msgbuf_print_stats(&msgbufs);
+    mem_print_stats();
+    cs_destroy(&cs);
+    pit_destroy(&pit);
+    store_destroy(&store);
+    fib_destroy(&fib);
+    bloom_counter_free(&localDigest);
+    bloom_free(&digestDirty);
+    reactor_destroy(&reactor);
+    msgbuf_pool_destroy(&msgbufs);
+    session_table_destroy(&sessions);
+    arena_destroy(&arena);
     close(server_sock);
     close(udp_sock);
     return 0;
-}
+}
\ No newline at end of file
@@ -0,0 +1,313 @@
+// ndn6_alloc_test.c
+//
+// Verifica que o caminho de encaminhamento do ndn6 não reserva memória
+// depois de aquecido. malloc, calloc, realloc e free são embrulhados pelo
+// linker e contados dentro de cada nó:
+//
+//   gcc -O2 -o ndn6_alloc_test ndn6_alloc_test.c
+//       -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free
+//   ./ndn6_alloc_test [nós] [porta base]
+//
+// (com -DREACTOR_SELECT ou -DREACTOR_IO_URING para os outros backends)
+//
+// O programa lança um servidor de registo e os nós (processos filhos com o
+// main do ndn6, ligados em árvore por dj), cria objetos em todos, faz duas
+// rondas de retrieves para aquecer pools, cache e sessões, começa a contar
+// e faz mais seis rondas, com objetos que existem, objetos da cache e nomes
+// que não existem. Termina com 1 se algum nó chamou o alocador durante as
+// rondas contadas (ou não respondeu), 0 caso contrário.
+
+#define main ndn6_main
+#include "ndn6.c"
+#undef main
+
+#include <stdarg.h>
+#include <sys/wait.h>
+
+#define AT_MAX_NODES   64
+#define AT_NAMES       20    // objetos criados por nó
+#define AT_WARMUP      2     // rondas antes de contar
+#define AT_ROUNDS      8     // rondas no total
+#define AT_CACHE       "8"   // cache pequena: há substituições durante o teste
+
+// Contadores do nó (cada filho tem os seus)
+static volatile sig_atomic_t atCounting;
+static unsigned long atCalls[4];   // malloc, calloc, realloc, free
+static int atReportFd = -1, atNode;
+
+void *__real_malloc(size_t n);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t n);
+void __real_free(void *p);
+
+void *__wrap_malloc(size_t n) {
+    if (atCounting)
+        atCalls[0]++;
+    return __real_malloc(n);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    if (atCounting)
+        atCalls[1]++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t n) {
+    if (atCounting)
+        atCalls[2]++;
+    return __real_realloc(p, n);
+}
+
+void __wrap_free(void *p) {
+    if (atCounting && p != NULL)
+        atCalls[3]++;
+    __real_free(p);
+}
+
+typedef struct {
+    int node;
+    unsigned long calls[4];
+} AtReport;
+
+// SIGUSR1: começa a contar; SIGUSR2: envia os contadores ao pai
+static void at_signal(int sig) {
+    if (sig == SIGUSR1) {
+        memset(atCalls, 0, sizeof(atCalls));
+        atCounting = 1;
+        return;
+    }
+    atCounting = 0;
+    AtReport r = {atNode, {atCalls[0], atCalls[1], atCalls[2], atCalls[3]}};
+    if (write(atReportFd, &r, sizeof(r)) < 0)
+        _exit(EXIT_FAILURE);
+}
+
+// Servidor de registo mínimo (REG, UNREG e NODES) para os nós do teste
+typedef struct {
+    char net[8], ip[INET_ADDRSTRLEN], port[8];
+} AtRegEntry;
+
+static void at_registry(int port) {
+    static AtRegEntry reg[AT_MAX_NODES];
+    int nreg = 0;
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)port);
+    if (sock < 0 || bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("servidor de registo");
+        _exit(EXIT_FAILURE);
+    }
+    for (;;) {
+        char buf[512], out[4096], cmd[16];
+        AtRegEntry e;
+        struct sockaddr_in from;
+        socklen_t fromlen = sizeof(from);
+        ssize_t n = recvfrom(sock, buf, sizeof(buf) - 1, 0, (struct sockaddr *)&from, &fromlen);
+        if (n <= 0)
+            continue;
+        buf[n] = '\0';
+        int k = sscanf(buf, "%15s %7s %15s %7s", cmd, e.net, e.ip, e.port);
+        int len = 0;
+        if (k == 4 && strcmp(cmd, "REG") == 0) {
+            if (nreg < AT_MAX_NODES)
+                reg[nreg++] = e;
+            len = snprintf(out, sizeof(out), "OKREG");
+        } else if (k == 4 && strcmp(cmd, "UNREG") == 0) {
+            for (int i = 0; i < nreg; i++)
+                if (strcmp(reg[i].ip, e.ip) == 0 && strcmp(reg[i].port, e.port) == 0)
+                    reg[i--] = reg[--nreg];
+            len = snprintf(out, sizeof(out), "OKUNREG");
+        } else if (k == 2 && strcmp(cmd, "NODES") == 0) {
+            len = snprintf(out, sizeof(out), "NODESLIST %s\n", e.net);
+            for (int i = 0; i < nreg && len < (int)sizeof(out) - 32; i++)
+                if (strcmp(reg[i].net, e.net) == 0)
+                    len += snprintf(out + len, sizeof(out) - (size_t)len, "%s %s\n", reg[i].ip,
+                                    reg[i].port);
+        } else {
+            continue;
+        }
+        sendto(sock, out, (size_t)len, 0, (struct sockaddr *)&from, fromlen);
+    }
+}
+
+typedef struct {
+    pid_t pid;
+    int in;       // stdin do nó
+    FILE *log;    // stdout do nó
+} AtNode;
+
+static AtNode atNodes[AT_MAX_NODES];
+
+static void at_cmd(int i, const char *fmt, ...) {
+    char buf[128];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf) - 1, fmt, ap);
+    va_end(ap);
+    buf[n++] = '\n';
+    if (write(atNodes[i].in, buf, (size_t)n) != n)
+        perror("comando para o nó");
+}
+
+static void at_sleep_ms(long ms) {
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+        ;
+}
+
+static void at_spawn(int i, int port, int regport, int report) {
+    int fds[2];
+    FILE *log = tmpfile();
+    if (log == NULL || pipe(fds) < 0) {
+        perror("nó");
+        exit(EXIT_FAILURE);
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        char tcp[12], udp[12];
+        snprintf(tcp, sizeof(tcp), "%d", port);
+        snprintf(udp, sizeof(udp), "%d", regport);
+        char *argv[] = {"ndn6", AT_CACHE, "127.0.0.1", tcp, "127.0.0.1", udp, NULL};
+        dup2(fds[0], STDIN_FILENO);
+        dup2(fileno(log), STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        atNode = i;
+        atReportFd = report;
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = at_signal;   // sem SA_RESTART: o reactor vê o EINTR
+        sigaction(SIGUSR1, &sa, NULL);
+        sigaction(SIGUSR2, &sa, NULL);
+        exit(ndn6_main(6, argv));
+    }
+    close(fds[0]);
+    atNodes[i].pid = pid;
+    atNodes[i].in = fds[1];
+    atNodes[i].log = log;
+}
+
+// Cada nó pede 6 objetos de outros nós (que mudam de ronda para ronda) e
+// um nome que não existe
+static void at_round(int n, int r) {
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < 6; k++)
+            at_cmd(i, "r n%dx%d", (i * 7 + k * 3 + r) % n, (k + r * 5) % AT_NAMES);
+        at_cmd(i, "r missing%d", r * 100 + i);
+        at_sleep_ms(40);
+    }
+    at_sleep_ms(600);
+}
+
+// Linhas "Objeto ... encontrado" no stdout do nó (respostas da rede e da cache)
+static int at_found(FILE *log) {
+    char line[512];
+    int found = 0;
+    rewind(log);
+    while (fgets(line, sizeof(line), log) != NULL)
+        found += strncmp(line, "Objeto ", 7) == 0 && strstr(line, " encontrado") != NULL &&
+                 strstr(line, "não encontrado") == NULL;
+    return found;
+}
+
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 15;
+    int base = argc > 2 ? atoi(argv[2]) : 47000;
+    if (n < 2 || n > AT_MAX_NODES || base <= 0 || base + n > 65535) {
+        fprintf(stderr, "Uso: %s [nós (2..%d)] [porta base]\n", argv[0], AT_MAX_NODES);
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    fflush(stdout);
+    int report[2];
+    if (pipe(report) < 0) {
+        perror("pipe");
+        return 2;
+    }
+    pid_t registry = fork();
+    if (registry == 0)
+        at_registry(base);
+    at_sleep_ms(200);
+    for (int i = 0; i < n; i++)
+        at_spawn(i, base + 1 + i, base, report[1]);
+    at_sleep_ms(300);
+    // Um nó que não arrancou (porta ocupada, por exemplo) invalida o teste
+    if (waitpid(-1, NULL, WNOHANG) > 0) {
+        fprintf(stderr, "Um dos processos terminou ao arrancar; experimente outra porta base\n");
+        for (int i = 0; i < n; i++)
+            kill(atNodes[i].pid, SIGKILL);
+        kill(registry, SIGKILL);
+        return 2;
+    }
+
+    // Árvore binária: o nó i liga-se ao (i - 1) / 2
+    at_cmd(0, "dj 010 0.0.0.0 0");
+    for (int i = 1; i < n; i++) {
+        at_sleep_ms(50);
+        at_cmd(i, "dj 010 127.0.0.1 %d", base + 1 + (i - 1) / 2);
+    }
+    at_sleep_ms(1000);
+    for (int i = 0; i < n; i++)
+        for (int k = 0; k < AT_NAMES; k++)
+            at_cmd(i, "c n%dx%d", i, k);
+    at_sleep_ms(500);
+
+    for (int r = 0; r < AT_WARMUP; r++)
+        at_round(n, r);
+    for (int i = 0; i < n; i++)
+        kill(atNodes[i].pid, SIGUSR1);
+    at_sleep_ms(300);
+    for (int r = AT_WARMUP; r < AT_ROUNDS; r++)
+        at_round(n, r);
+    for (int i = 0; i < n; i++)
+        kill(atNodes[i].pid, SIGUSR2);
+
+    // Um relatório por nó
+    unsigned long total[4] = {0};
+    int reports = 0, failed = 0;
+    struct pollfd pfd = {.fd = report[0], .events = POLLIN};
+    while (reports < n && poll(&pfd, 1, 2000) > 0) {
+        AtReport r;
+        if (read(report[0], &r, sizeof(r)) != (ssize_t)sizeof(r))
+            break;
+        reports++;
+        for (int k = 0; k < 4; k++)
+            total[k] += r.calls[k];
+        if (r.calls[0] || r.calls[1] || r.calls[2] || r.calls[3]) {
+            printf("nó %d: malloc %lu, calloc %lu, realloc %lu, free %lu\n", r.node, r.calls[0],
+                   r.calls[1], r.calls[2], r.calls[3]);
+            failed = 1;
+        }
+    }
+
+    for (int i = 0; i < n; i++)
+        at_cmd(i, "x");
+    int found = 0;
+    for (int i = 0; i < n; i++) {
+        int status;
+        waitpid(atNodes[i].pid, &status, 0);
+        found += at_found(atNodes[i].log);
+    }
+    kill(registry, SIGTERM);
+    waitpid(registry, NULL, 0);
+
+    printf("%d nós, %d rondas contadas: %d objetos encontrados no total\n", n,
+           AT_ROUNDS - AT_WARMUP, found);
+    printf("Depois do aquecimento: malloc %lu, calloc %lu, realloc %lu, free %lu\n", total[0],
+           total[1], total[2], total[3]);
+    if (reports < n) {
+        printf("Só %d de %d nós enviaram os contadores\n", reports, n);
+        return 1;
+    }
+    if (found == 0) {
+        printf("Nenhum objeto encontrado: o encaminhamento não correu\n");
+        return 1;
+    }
+    return failed;
+}
@@ -0,0 +1,139 @@
+#ifndef NODEID_H
+#define NODEID_H
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Identificador de um nó: endereço IPv4 e porta TCP empacotados em 48 bits
+ * (endereço nos bits 16 a 47, porta nos 16 de baixo) de um inteiro de 64.
+ * Compará-los é uma só instrução, cabem numa chave de dispersão e ocupam
+ * 8 bytes em vez de um texto "ip:porta". NODEID_NONE (0.0.0.0:0) é o
+ * vizinho por definir.
+ *
+ * O texto só aparece nas pontas: nodeid_parse() lê "a.b.c.d" de uma
+ * mensagem sem cópia nem inet_pton(), nodeid_put_addr() escreve "a.b.c.d
+ * porta" numa mensagem sem snprintf() e nodeid_text() dá o "a.b.c.d:porta"
+ * para mostrar.
+ */
+
+typedef uint64_t NodeId;
+
+#define NODEID_NONE     ((NodeId)0)
+#define NODEID_TEXT_MAX 22    // "255.255.255.255:65535" e o '\0'
+#define NODEID_ADDR_MAX 21    // "255.255.255.255 65535", sem '\0'
+
+// addr em ordem do host
+static inline NodeId nodeid_make(uint32_t addr, uint16_t port) {
+    return ((NodeId)addr << 16) | port;
+}
+
+static inline uint32_t nodeid_addr(NodeId id) {
+    return (uint32_t)(id >> 16);
+}
+
+static inline uint16_t nodeid_port(NodeId id) {
+    return (uint16_t)id;
+}
+
+static inline int nodeid_eq(NodeId a, NodeId b) {
+    return a == b;
+}
+
+// Dispersão multiplicativa: os bits de cima do produto misturam os 48
+static inline uint32_t nodeid_hash(NodeId id) {
+    return (uint32_t)((id * 0x9e3779b97f4a7c15ull) >> 32);
+}
+
+// Endereço "a.b.c.d" com len bytes (sem '\0') em ordem do host; -1 se
+// não for um IPv4 em notação decimal
+static inline int nodeid_parse_addr(const char *p, size_t len, uint32_t *addr) {
+    const char *end = p + len;
+    uint32_t a = 0;
+    for (int i = 0; i < 4; i++) {
+        if (i > 0 && (p == end || *p++ != '.'))
+            return -1;
+        unsigned v = 0;
+        int digits = 0;
+        while (p < end && *p >= '0' && *p <= '9' && digits < 3) {
+            v = v * 10 + (unsigned)(*p++ - '0');
+            digits++;
+        }
+        if (digits == 0 || v > 255)
+            return -1;
+        a = a << 8 | v;
+    }
+    if (p != end)
+        return -1;
+    *addr = a;
+    return 0;
+}
+
+// Nó "a.b.c.d" (len bytes) na porta dada; -1 se o endereço for inválido
+static inline int nodeid_parse(const char *ip, size_t len, int port, NodeId *id) {
+    uint32_t addr;
+    if (port < 0 || port > 65535 || nodeid_parse_addr(ip, len, &addr) < 0)
+        return -1;
+    *id = nodeid_make(addr, (uint16_t)port);
+    return 0;
+}
+
+static inline int nodeid_parse_str(const char *ip, int port, NodeId *id) {
+    return nodeid_parse(ip, strlen(ip), port, id);
+}
+
+static inline size_t nodeid_put_uint(char *out, unsigned v) {
+    char tmp[10];
+    size_t n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+    for (size_t i = 0; i < n; i++)
+        out[i] = tmp[n - 1 - i];
+    return n;
+}
+
+// Escreve "a.b.c.d" em out (pelo menos 15 bytes, sem '\0'); devolve o comprimento
+static inline size_t nodeid_put_ip(char *out, NodeId id) {
+    uint32_t a = nodeid_addr(id);
+    size_t n = 0;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        n += nodeid_put_uint(out + n, (a >> shift) & 0xff);
+        if (shift > 0)
+            out[n++] = '.';
+    }
+    return n;
+}
+
+// Escreve "a.b.c.d<sep>porta" em out (NODEID_ADDR_MAX bytes, sem '\0')
+static inline size_t nodeid_put(char *out, NodeId id, char sep) {
+    size_t n = nodeid_put_ip(out, id);
+    out[n++] = sep;
+    return n + nodeid_put_uint(out + n, nodeid_port(id));
+}
+
+// Campos "a.b.c.d porta" de ENTRY, SAFE e LEAVE
+static inline size_t nodeid_put_addr(char *out, NodeId id) {
+    return nodeid_put(out, id, ' ');
+}
+
+typedef struct {
+    char s[NODEID_TEXT_MAX];
+} NodeIdText;
+
+// "a.b.c.d:porta" para mostrar; o texto vive até ao fim da expressão,
+// por isso pode haver vários no mesmo printf
+static inline NodeIdText nodeid_text(NodeId id) {
+    NodeIdText t;
+    t.s[nodeid_put(t.s, id, ':')] = '\0';
+    return t;
+}
+
+// Só o endereço, em texto terminado em '\0' (buf com pelo menos 16 bytes)
+static inline const char *nodeid_ip(NodeId id, char *buf) {
+    buf[nodeid_put_ip(buf, id)] = '\0';
+    return buf;
+}
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef PIT_H
+#define PIT_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "name.h"
+#include "pool.h"
+#include "timer.h"
+
+/*
+ * Tabela de interesses pendentes (PIT).
+ *
+ * Uma entrada por nome com interesse em curso, indexada pelo hash do nome.
+ * Cada entrada guarda as interfaces (faces) envolvidas e o estado de cada:
+ *
+ *   PIT_RESPONSE  interface de entrada: espera que lhe seja enviada a resposta
+ *   PIT_WAITING   interface de saída: o interesse foi enviado, sem resposta
+ *   PIT_CLOSED    interface de saída que respondeu NOOBJECT
+ *
+ * Uma interface de saída que também envia o interesse (dois vizinhos que o
+ * reencaminharam um ao outro) guarda o estado de saída e fica com reply:
+ * continua a contar como saída e recebe a resposta no fim.
+ *
+ * Um interesse repetido para um nome com entrada ativa só acrescenta a
+ * interface de entrada (agregação); não volta a ser reencaminhado.
+ * Entradas e interfaces vêm de pools, sem malloc por interesse.
+ * As interfaces são identificadas por um inteiro do programa; PIT_FACE_LOCAL
+ * representa o próprio nó (comando retrieve).
+ *
+ * Cada entrada tem um temporizador que o programa arma com o tempo de vida
+ * do interesse (PIT_LIFETIME_MS); pit_remove() cancela-o.
+ */
+
+#define PIT_BUCKETS 1024  // potência de 2
+#define PIT_FACE_LOCAL (-1)
+#define PIT_LIFETIME_MS 4000  // tempo de vida de uma entrada sem resposta
+
+typedef enum { PIT_RESPONSE, PIT_WAITING, PIT_CLOSED } PitFaceState;
+
+// Como o interesse foi reencaminhado
+#define PIT_FLOODED        0   // para todas as interfaces
+#define PIT_ROUTED_FIB     1   // só pela rota aprendida
+#define PIT_ROUTED_DIGEST  2   // só para os vizinhos cujo resumo tem o nome
+
+typedef struct PitFace {
+    int face;
+    PitFaceState state;
+    int reply;                // espera a resposta (todas as de entrada)
+    int told;                 // já recebeu o NOOBJECT do lado deste nó
+    struct PitFace *next;
+} PitFace;
+
+typedef struct PitEntry {
+    char name[NDN_NAME_MAX + 1];
+    uint32_t len;
+    uint32_t hash, hash2;     // os do NameView do nome
+    PitFace *faces;
+    uint32_t nonce;           // nonce do interesse reencaminhado
+    int routed;               // PIT_FLOODED, PIT_ROUTED_FIB ou PIT_ROUTED_DIGEST
+    int throttled;            // alguma interface de saída foi saltada por congestionamento
+    int expired;              // terminada pelo temporizador, sem todas as respostas
+    int parked;               // sem interfaces de saída, à espera da topologia reparada
+    unsigned epoch;           // topologyEpoch do último envio do interesse
+    Timer timer;
+    struct PitEntry *hnext;
+} PitEntry;
+
+typedef struct {
+    unsigned long interests;    // interesses que criaram uma entrada
+    unsigned long aggregated;   // interesses juntos a uma entrada existente
+    unsigned long satisfied;    // entradas respondidas com OBJECT
+    unsigned long failed;       // entradas terminadas com NOOBJECT
+    unsigned long sent;         // mensagens INTEREST enviadas a vizinhos
+    unsigned long expired;      // entradas terminadas pelo tempo de vida
+} PitStats;
+
+POOL_TYPED(PitEntryPool, pit_entry_pool, PitEntry)
+POOL_TYPED(PitFacePool, pit_face_pool, PitFace)
+
+typedef struct {
+    PitEntry *buckets[PIT_BUCKETS];
+    int count;
+    PitEntryPool entries;
+    PitFacePool faces;
+    PitStats stats;
+} Pit;
+
+static inline void pit_remove(Pit *pit, PitEntry *e);
+
+// arena: origem dos lotes dos pools (NULL para malloc)
+static inline void pit_init(Pit *pit, Arena *arena) {
+    memset(pit, 0, sizeof(*pit));
+    pit_entry_pool_init(&pit->entries, "PIT", arena);
+    pit_face_pool_init(&pit->faces, "interfaces da PIT", arena);
+}
+
+static inline void pit_destroy(Pit *pit) {
+    // Devolve as entradas que restam, para os pools só acusarem fugas reais
+    for (int b = 0; b < PIT_BUCKETS; b++)
+        while (pit->buckets[b] != NULL)
+            pit_remove(pit, pit->buckets[b]);
+    pit_entry_pool_destroy(&pit->entries);
+    pit_face_pool_destroy(&pit->faces);
+}
+
+static inline const char *pit_state_name(PitFaceState st) {
+    switch (st) {
+    case PIT_RESPONSE: return "resposta";
+    case PIT_WAITING: return "espera";
+    default: return "fechado";
+    }
+}
+
+static inline PitEntry *pit_find(Pit *pit, const NameView *nv) {
+    for (PitEntry *e = pit->buckets[nv->hash & (PIT_BUCKETS - 1)]; e != NULL; e = e->hnext)
+        if (e->hash == nv->hash && e->len == nv->len && memcmp(e->name, nv->name, nv->len) == 0)
+            return e;
+    return NULL;
+}
+
+// NameView do nome da entrada (sem recalcular os hashes)
+static inline NameView pit_name(const PitEntry *e) {
+    NameView nv = {e->name, e->len, e->hash, e->hash2};
+    return nv;
+}
+
+// Nova entrada (o nome não pode ter já uma entrada)
+static inline PitEntry *pit_insert(Pit *pit, const NameView *nv) {
+    PitEntry *e = pit_entry_pool_alloc(&pit->entries);
+    if (e == NULL)
+        return NULL;
+    name_view_copy(e->name, nv);
+    e->len = nv->len;
+    e->hash = nv->hash;
+    e->hash2 = nv->hash2;
+    PitEntry **b = &pit->buckets[e->hash & (PIT_BUCKETS - 1)];
+    e->hnext = *b;
+    *b = e;
+    pit->count++;
+    pit->stats.interests++;
+    return e;
+}
+
+static inline void pit_remove(Pit *pit, PitEntry *e) {
+    PitEntry **l = &pit->buckets[e->hash & (PIT_BUCKETS - 1)];
+    while (*l != e)
+        l = &(*l)->hnext;
+    *l = e->hnext;
+    timer_cancel(&e->timer);
+    while (e->faces != NULL) {
+        PitFace *f = e->faces;
+        e->faces = f->next;
+        pit_face_pool_free(&pit->faces, f);
+    }
+    pit_entry_pool_free(&pit->entries, e);
+    pit->count--;
+}
+
+static inline PitFace *pit_get_face(PitEntry *e, int face) {
+    for (PitFace *f = e->faces; f != NULL; f = f->next)
+        if (f->face == face)
+            return f;
+    return NULL;
+}
+
+// Acrescenta a interface à entrada ou muda o seu estado; -1 sem memória.
+// PIT_RESPONSE numa interface de saída só lhe junta o pedido da resposta.
+static inline int pit_set_face(Pit *pit, PitEntry *e, int face, PitFaceState state) {
+    PitFace *f = pit_get_face(e, face);
+    if (f == NULL) {
+        f = pit_face_pool_alloc(&pit->faces);
+        if (f == NULL)
+            return -1;
+        f->face = face;
+        f->state = state;
+        f->reply = 0;
+        f->told = 0;
+        f->next = e->faces;
+        e->faces = f;
+    }
+    if (state == PIT_RESPONSE)
+        f->reply = 1;
+    else
+        f->state = state;
+    return 0;
+}
+
+// Retira a interface da entrada; devolve o estado que tinha (-1 se não estava)
+static inline int pit_drop_face(Pit *pit, PitEntry *e, int face) {
+    for (PitFace **l = &e->faces; *l != NULL; l = &(*l)->next) {
+        PitFace *f = *l;
+        if (f->face == face) {
+            int st = f->state;
+            *l = f->next;
+            pit_face_pool_free(&pit->faces, f);
+            return st;
+        }
+    }
+    return -1;
+}
+
+static inline int pit_count(const PitEntry *e, PitFaceState state) {
+    int n = 0;
+    for (const PitFace *f = e->faces; f != NULL; f = f->next)
+        n += f->state == state;
+    return n;
+}
+
+// Interfaces que esperam a resposta
+static inline int pit_replies(const PitEntry *e) {
+    int n = 0;
+    for (const PitFace *f = e->faces; f != NULL; f = f->next)
+        n += f->reply;
+    return n;
+}
+
+// face_name converte o identificador de uma interface em texto
+static inline void pit_print(const Pit *pit, const char *(*face_name)(int face)) {
+    printf("----- Tabela de Interesses Pendentes (%d) -----\n", pit->count);
+    for (int b = 0; b < PIT_BUCKETS; b++) {
+        for (const PitEntry *e = pit->buckets[b]; e != NULL; e = e->hnext) {
+            printf("%s:", e->name);
+            for (const PitFace *f = e->faces; f != NULL; f = f->next)
+                printf(" %s(%s%s)", face_name(f->face), pit_state_name(f->state),
+                       f->reply && f->state != PIT_RESPONSE ? "+resposta" : "");
+            printf("\n");
+        }
+    }
+    printf("-----------------------------------------------\n");
+}
+
+static inline void pit_print_stats(const Pit *pit) {
+    printf("PIT: %d entradas, %lu interesses, %lu agregados, %lu respondidos, %lu sem objeto, "
+           "%lu expirados, %lu INTEREST enviados, %lu entradas e %lu interfaces reservadas\n",
+           pit->count, pit->stats.interests, pit->stats.aggregated, pit->stats.satisfied,
+           pit->stats.failed, pit->stats.expired, pit->stats.sent, pit->entries.pool.capacity,
+           pit->faces.pool.capacity);
+}
+
+#endif
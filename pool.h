@@ -0,0 +1,181 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+/*
+ * Pool de blocos de tamanho fixo.
+ *
+ * Os blocos são reservados em lotes (chunks) de POOL_CHUNK objetos e nunca
+ * mudam de endereço; os blocos libertados ficam numa lista livre e são
+ * reutilizados antes de se reservar um novo lote. Um pool só é devolvido
+ * ao sistema em pool_destroy(); com uma arena os lotes vêm dela e só
+ * voltam ao sistema com a arena.
+ *
+ * Cada pool conta os objetos em uso, o máximo atingido e os lotes
+ * reservados. Com -DPOOL_DEBUG os blocos libertados são preenchidos com
+ * 0xdd, uma dupla libertação aborta e pool_destroy() avisa dos objetos
+ * que ficaram por libertar.
+ *
+ * POOL_TYPED(Nome, prefixo, Tipo) define um pool só de objetos Tipo, com
+ * prefixo_init/alloc/free/destroy a receber e devolver Tipo *.
+ */
+
+#define POOL_CHUNK 64
+#define POOL_FREED 0xf7ee0b1ec7f7ee0bull  // marca de bloco livre (POOL_DEBUG)
+
+typedef struct PoolChunk {
+    struct PoolChunk *next;
+} PoolChunk;
+
+typedef struct {
+    size_t obj_size;
+    void *free;            // lista livre (o próprio bloco guarda o próximo)
+    PoolChunk *chunks;     // lotes reservados com malloc (sem arena)
+    Arena *arena;          // origem dos lotes, ou NULL
+    const char *name;
+    unsigned long in_use;
+    unsigned long capacity;
+    unsigned long peak;    // máximo de objetos em uso
+    unsigned long allocs;
+} Pool;
+
+static inline void pool_init_arena(Pool *p, const char *name, size_t obj_size, Arena *arena) {
+    memset(p, 0, sizeof(*p));
+#ifdef POOL_DEBUG
+    // Espaço para a marca de bloco livre a seguir ao ponteiro da lista
+    if (obj_size < 2 * sizeof(uint64_t))
+        obj_size = 2 * sizeof(uint64_t);
+#endif
+    if (obj_size < sizeof(void *))
+        obj_size = sizeof(void *);
+    // Mantém os blocos alinhados como um ponteiro
+    p->obj_size = (obj_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    p->arena = arena;
+    p->name = name;
+}
+
+static inline void pool_init(Pool *p, size_t obj_size) {
+    pool_init_arena(p, "pool", obj_size, NULL);
+}
+
+static inline int pool_grow(Pool *p) {
+    size_t header = (sizeof(PoolChunk) + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    char *base;
+    if (p->arena != NULL) {
+        base = arena_alloc(p->arena, POOL_CHUNK * p->obj_size);
+        if (base == NULL)
+            return -1;
+    } else {
+        PoolChunk *c = malloc(header + POOL_CHUNK * p->obj_size);
+        if (c == NULL)
+            return -1;
+        c->next = p->chunks;
+        p->chunks = c;
+        base = (char *)c + header;
+    }
+    for (int i = POOL_CHUNK - 1; i >= 0; i--) {
+        void *obj = base + (size_t)i * p->obj_size;
+        *(void **)obj = p->free;
+#ifdef POOL_DEBUG
+        memcpy((char *)obj + sizeof(uint64_t), &(uint64_t){POOL_FREED}, sizeof(uint64_t));
+#endif
+        p->free = obj;
+    }
+    p->capacity += POOL_CHUNK;
+    return 0;
+}
+
+// Garante que há pelo menos n objetos reservados (aquecimento no arranque)
+static inline int pool_reserve(Pool *p, unsigned long n) {
+    while (p->capacity < n)
+        if (pool_grow(p) < 0)
+            return -1;
+    return 0;
+}
+
+// Bloco por inicializar, ou NULL sem memória
+static inline void *pool_alloc_raw(Pool *p) {
+    if (p->free == NULL && pool_grow(p) < 0) {
+        perror("pool_alloc");
+        return NULL;
+    }
+    void *obj = p->free;
+    p->free = *(void **)obj;
+#ifdef POOL_DEBUG
+    memset((char *)obj + sizeof(uint64_t), 0, sizeof(uint64_t));
+#endif
+    p->allocs++;
+    if (++p->in_use > p->peak)
+        p->peak = p->in_use;
+    return obj;
+}
+
+// Bloco zerado, ou NULL sem memória
+static inline void *pool_alloc(Pool *p) {
+    void *obj = pool_alloc_raw(p);
+    if (obj != NULL)
+        memset(obj, 0, p->obj_size);
+    return obj;
+}
+
+static inline void pool_free(Pool *p, void *obj) {
+    if (obj == NULL)
+        return;
+#ifdef POOL_DEBUG
+    uint64_t mark;
+    memcpy(&mark, (char *)obj + sizeof(uint64_t), sizeof(mark));
+    if (mark == POOL_FREED) {
+        fprintf(stderr, "pool %s: bloco %p libertado duas vezes\n", p->name, obj);
+        abort();
+    }
+    memset(obj, 0xdd, p->obj_size);
+    memcpy((char *)obj + sizeof(uint64_t), &(uint64_t){POOL_FREED}, sizeof(uint64_t));
+#endif
+    *(void **)obj = p->free;
+    p->free = obj;
+    p->in_use--;
+}
+
+static inline void pool_destroy(Pool *p) {
+#ifdef POOL_DEBUG
+    if (p->in_use > 0)
+        fprintf(stderr, "pool %s: %lu objetos por libertar\n", p->name, p->in_use);
+#endif
+    while (p->chunks != NULL) {
+        PoolChunk *c = p->chunks;
+        p->chunks = c->next;
+        free(c);
+    }
+    p->free = NULL;
+    p->in_use = p->capacity = 0;
+}
+
+static inline void pool_print_stats(const Pool *p) {
+    printf("Pool %s: %lu em uso, máximo %lu, %lu reservados (%zu bytes cada), %lu pedidos\n",
+           p->name, p->in_use, p->peak, p->capacity, p->obj_size, p->allocs);
+}
+
+#define POOL_TYPED(Name, prefix, Type)                                              \
+    typedef struct {                                                                \
+        Pool pool;                                                                  \
+    } Name;                                                                         \
+    static inline void prefix##_init(Name *p, const char *name, Arena *arena) {     \
+        pool_init_arena(&p->pool, name, sizeof(Type), arena);                       \
+    }                                                                               \
+    static inline Type *prefix##_alloc(Name *p) {                                   \
+        return (Type *)pool_alloc(&p->pool);                                        \
+    }                                                                               \
+    static inline void prefix##_free(Name *p, Type *obj) {                          \
+        pool_free(&p->pool, obj);                                                   \
+    }                                                                               \
+    static inline void prefix##_destroy(Name *p) {                                  \
+        pool_destroy(&p->pool);                                                     \
+    }
+
+#endif
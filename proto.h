@@ -0,0 +1,605 @@
+#ifndef PROTO_H
+#define PROTO_H
+
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "nodeid.h"
+
+/*
+ * Analisador das mensagens de texto do protocolo (TCP entre nós e UDP do
+ * servidor de registo), sem cópias.
+ *
+ * Uma linha é dividida em tokens separados por espaços; cada token é uma
+ * vista (StrView: ponteiro + comprimento) para o próprio buffer de receção,
+ * que não é alterado nem precisa de terminar em '\0'. proto_parse() diz o
+ * tipo da mensagem e valida e converte os campos que ela leva:
+ *
+ *   ENTRY ip port / SAFE ip port / LEAVE ip port     ip, port, node
+ *   INTEREST name [nonce]                            name, nonce (hex, 0 = sem nonce)
+ *   OBJECT name / NOOBJECT name                      name
+ *   OKREG / OKUNREG
+ *   NODESLIST net (seguido de linhas "ip port")      net
+ *   DIGEST bits k / DIGESTSET p... / DIGESTCLR p...  bits, k / rest
+ *   HELLO interval_ms                                interval
+ *
+ * O enquadramento das linhas num fluxo TCP fica com ProtoBuf: os dados de
+ * uma leitura são analisados onde estão e só o fim sem '\n' é guardado; a
+ * leitura seguinte só procura o '\n' nos bytes novos.
+ *
+ * Formato binário (TLV), negociado entre dois nós: cada um acrescenta
+ * "TLV" ao ENTRY ou SAFE que envia; quando um lado já ofereceu e recebeu a
+ * oferta, envia a linha "TLV" e daí em diante só tramas
+ *
+ *   T (1 byte, o MsgType)  L (varint, até 3 bytes)  V (L bytes)
+ *
+ * com V, em ordem de rede:
+ *
+ *   ENTRY, SAFE, LEAVE       IPv4 (4) porto (2)
+ *   INTEREST                 hash (4) hash2 (4) nonce (4) nome
+ *   OBJECT, NOOBJECT         hash (4) hash2 (4) nome
+ *   DIGEST                   bits (4) k (1)
+ *   DIGESTSET, DIGESTCLR     posições em varint
+ *   HELLO                    intervalo em ms (4)
+ *
+ * Os hashes são os do NameView de quem envia, para o recetor não voltar a
+ * percorrer o nome. Cada sentido muda de formato por si, na linha "TLV";
+ * um vizinho que não ofereça o formato continua a receber texto.
+ */
+
+#define PROTO_MAX_TOKENS 4
+
+typedef struct {
+    const char *p;
+    uint32_t len;
+} StrView;
+
+// Os valores são também o T das tramas binárias: acrescentar só no fim
+typedef enum {
+    MSG_UNKNOWN,
+    MSG_ENTRY,
+    MSG_SAFE,
+    MSG_LEAVE,
+    MSG_INTEREST,
+    MSG_OBJECT,
+    MSG_NOOBJECT,
+    MSG_OKREG,
+    MSG_OKUNREG,
+    MSG_NODESLIST,
+    MSG_DIGEST,
+    MSG_DIGESTSET,
+    MSG_DIGESTCLR,
+    MSG_TLV,              // linha "TLV": o resto do fluxo vem em tramas binárias
+    MSG_HELLO             // batimento de uma sessão sem outro tráfego
+} MsgType;
+
+typedef struct {
+    MsgType type;
+    StrView tok[PROTO_MAX_TOKENS];   // tok[0] é o comando
+    int ntok;
+    StrView rest;         // o que vem depois do comando
+    StrView ip;           // ENTRY, SAFE, LEAVE (só em texto)
+    int port;
+    NodeId node;          // ip e port empacotados (NODEID_NONE se o ip não for IPv4)
+    StrView name;         // INTEREST, OBJECT, NOOBJECT
+    uint32_t nonce;
+    StrView net;          // NODESLIST
+    uint32_t bits;        // DIGEST
+    int k;
+    uint32_t interval;    // HELLO: intervalo entre batimentos de quem envia
+    int tlv;              // ENTRY ou SAFE em texto com a oferta "TLV"
+    int binary;           // veio numa trama: hash e hash2 válidos, rest em varint
+    uint32_t hash, hash2;
+} ProtoMsg;
+
+#define PROTO_OK   0
+#define PROTO_BAD  (-1)   // comando conhecido com campos em falta ou inválidos
+
+static inline int sv_eq(StrView v, const char *s) {
+    size_t n = strlen(s);
+    return v.len == n && memcmp(v.p, s, n) == 0;
+}
+
+// Copia a vista para dst terminada em '\0'; -1 se não couber
+static inline int sv_copy(char *dst, size_t cap, StrView v) {
+    if (v.len >= cap)
+        return -1;
+    memcpy(dst, v.p, v.len);
+    dst[v.len] = '\0';
+    return 0;
+}
+
+// Número decimal sem sinal; -1 se a vista tiver outros carateres ou passar max
+static inline long sv_to_uint(StrView v, long max) {
+    if (v.len == 0 || v.len > 10)
+        return -1;
+    long n = 0;
+    for (uint32_t i = 0; i < v.len; i++) {
+        unsigned d = (unsigned char)v.p[i] - '0';
+        if (d > 9)
+            return -1;
+        n = n * 10 + d;
+    }
+    return n <= max ? n : -1;
+}
+
+// Número hexadecimal de até 8 dígitos; -1 se for inválido
+static inline int sv_to_hex32(StrView v, uint32_t *out) {
+    if (v.len == 0 || v.len > 8)
+        return -1;
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < v.len; i++) {
+        unsigned char c = (unsigned char)v.p[i];
+        unsigned d;
+        if (c >= '0' && c <= '9') d = c - '0';
+        else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') d = (c | 0x20) - 'a' + 10;
+        else return -1;
+        n = n << 4 | d;
+    }
+    *out = n;
+    return 0;
+}
+
+static inline int proto_is_space(char c) {
+    return c == ' ' || c == '\t';
+}
+
+// Próximo token de [*p, end); devolve 0 se não houver mais
+static inline int proto_token(const char **p, const char *end, StrView *tok) {
+    const char *s = *p;
+    while (s < end && proto_is_space(*s))
+        s++;
+    if (s == end) {
+        *p = s;
+        return 0;
+    }
+    const char *t = s;
+    while (s < end && !proto_is_space(*s))
+        s++;
+    tok->p = t;
+    tok->len = (uint32_t)(s - t);
+    *p = s;
+    return 1;
+}
+
+static inline MsgType proto_command(StrView c) {
+    switch (c.len) {
+    case 3:
+        if (sv_eq(c, "TLV")) return MSG_TLV;
+        break;
+    case 4:
+        if (sv_eq(c, "SAFE")) return MSG_SAFE;
+        break;
+    case 5:
+        if (sv_eq(c, "ENTRY")) return MSG_ENTRY;
+        if (sv_eq(c, "LEAVE")) return MSG_LEAVE;
+        if (sv_eq(c, "OKREG")) return MSG_OKREG;
+        if (sv_eq(c, "HELLO")) return MSG_HELLO;
+        break;
+    case 6:
+        if (sv_eq(c, "OBJECT")) return MSG_OBJECT;
+        if (sv_eq(c, "DIGEST")) return MSG_DIGEST;
+        break;
+    case 7:
+        if (sv_eq(c, "OKUNREG")) return MSG_OKUNREG;
+        break;
+    case 8:
+        if (sv_eq(c, "INTEREST")) return MSG_INTEREST;
+        if (sv_eq(c, "NOOBJECT")) return MSG_NOOBJECT;
+        break;
+    case 9:
+        if (sv_eq(c, "NODESLIST")) return MSG_NODESLIST;
+        if (sv_eq(c, "DIGESTSET")) return MSG_DIGESTSET;
+        if (sv_eq(c, "DIGESTCLR")) return MSG_DIGESTCLR;
+        break;
+    }
+    return MSG_UNKNOWN;
+}
+
+static inline const char *proto_type_name(MsgType t) {
+    static const char *const names[] = {
+        "?", "ENTRY", "SAFE", "LEAVE", "INTEREST", "OBJECT", "NOOBJECT", "OKREG", "OKUNREG",
+        "NODESLIST", "DIGEST", "DIGESTSET", "DIGESTCLR", "TLV", "HELLO"
+    };
+    return (unsigned)t < sizeof(names) / sizeof(names[0]) ? names[t] : "?";
+}
+
+/*
+ * Analisa uma linha (sem o '\n'; um '\r' final é ignorado). Devolve
+ * PROTO_OK, ou PROTO_BAD se o comando for conhecido mas os campos não
+ * baterem certo. Uma linha vazia ou um comando desconhecido dão
+ * PROTO_OK com type MSG_UNKNOWN.
+ */
+static inline int proto_parse(const char *line, size_t len, ProtoMsg *m) {
+    const char *p = line, *end = line + len;
+    if (end > p && end[-1] == '\r')
+        end--;
+    m->type = MSG_UNKNOWN;
+    m->ntok = 0;
+    m->nonce = 0;
+    m->tlv = 0;
+    m->binary = 0;
+    m->rest.p = end;
+    m->rest.len = 0;
+    while (m->ntok < PROTO_MAX_TOKENS && proto_token(&p, end, &m->tok[m->ntok])) {
+        if (m->ntok++ == 0) {
+            const char *r = p;
+            while (r < end && proto_is_space(*r))
+                r++;
+            m->rest.p = r;
+            m->rest.len = (uint32_t)(end - r);
+        }
+    }
+    if (m->ntok == 0)
+        return PROTO_OK;
+    m->type = proto_command(m->tok[0]);
+    long n, k;
+    switch (m->type) {
+    case MSG_ENTRY:
+    case MSG_SAFE:
+    case MSG_LEAVE:
+        if (m->ntok < 3 || (n = sv_to_uint(m->tok[2], 65535)) < 0)
+            return PROTO_BAD;
+        m->ip = m->tok[1];
+        m->port = (int)n;
+        if (nodeid_parse(m->ip.p, m->ip.len, m->port, &m->node) < 0)
+            m->node = NODEID_NONE;
+        m->tlv = m->ntok > 3 && sv_eq(m->tok[3], "TLV");
+        return PROTO_OK;
+    case MSG_INTEREST:
+        if (m->ntok >= 3 && sv_to_hex32(m->tok[2], &m->nonce) < 0)
+            return PROTO_BAD;
+        /* fallthrough */
+    case MSG_OBJECT:
+    case MSG_NOOBJECT:
+        if (m->ntok < 2)
+            return PROTO_BAD;
+        m->name = m->tok[1];
+        return PROTO_OK;
+    case MSG_NODESLIST:
+        if (m->ntok < 2)
+            return PROTO_BAD;
+        m->net = m->tok[1];
+        return PROTO_OK;
+    case MSG_DIGEST:
+        if (m->ntok < 3 || (n = sv_to_uint(m->tok[1], 0x7fffffffL)) < 0 ||
+            (k = sv_to_uint(m->tok[2], 255)) < 0)
+            return PROTO_BAD;
+        m->bits = (uint32_t)n;
+        m->k = (int)k;
+        return PROTO_OK;
+    case MSG_HELLO:
+        if (m->ntok < 2 || (n = sv_to_uint(m->tok[1], 0x7fffffffL)) < 0)
+            return PROTO_BAD;
+        m->interval = (uint32_t)n;
+        return PROTO_OK;
+    default:
+        return PROTO_OK;
+    }
+}
+
+/* ---------- linhas de um datagrama (NODESLIST) ---------- */
+
+typedef struct {
+    const char *p, *end;
+} ProtoLines;
+
+static inline void proto_lines_init(ProtoLines *it, const char *p, size_t len) {
+    it->p = p;
+    it->end = p + len;
+}
+
+// Próxima linha (sem '\n'); devolve 0 no fim
+static inline int proto_lines_next(ProtoLines *it, StrView *line) {
+    if (it->p >= it->end)
+        return 0;
+    const char *nl = memchr(it->p, '\n', (size_t)(it->end - it->p));
+    const char *e = nl ? nl : it->end;
+    line->p = it->p;
+    line->len = (uint32_t)(e - it->p);
+    it->p = nl ? nl + 1 : it->end;
+    return 1;
+}
+
+// Linha "ip port" da NODESLIST; -1 se estiver mal formada
+static inline int proto_parse_node(StrView line, StrView *ip, int *port) {
+    const char *p = line.p, *end = line.p + line.len;
+    if (end > p && end[-1] == '\r')
+        end--;
+    StrView t;
+    long n;
+    if (!proto_token(&p, end, ip) || !proto_token(&p, end, &t) || (n = sv_to_uint(t, 65535)) < 0)
+        return -1;
+    *port = (int)n;
+    return 0;
+}
+
+// Como proto_parse_node(), mas com o nó empacotado; -1 também se o ip não for IPv4
+static inline int proto_parse_node_id(StrView line, NodeId *id) {
+    StrView ip;
+    int port;
+    if (proto_parse_node(line, &ip, &port) < 0)
+        return -1;
+    return nodeid_parse(ip.p, ip.len, port, id);
+}
+
+/* ---------- enquadramento de um fluxo TCP ---------- */
+
+typedef struct {
+    char *buf;            // linha parcial de leituras anteriores
+    size_t cap;
+    size_t len;
+} ProtoBuf;
+
+#define PROTO_LINE     1     // *line tem uma linha (ou trama) completa
+#define PROTO_PARTIAL  0     // os dados acabaram a meio de uma linha (guardada)
+#define PROTO_OVERFLOW (-1)  // linha maior do que o buffer
+
+typedef struct {
+    const char *data;     // dados da leitura atual ainda por consumir
+    size_t len;
+} ProtoInput;
+
+/*
+ * Próxima linha completa (sem o '\n' nem um '\r' antes dele) de pb + in. Se não houver parte
+ * guardada a linha é uma vista direta para os dados recebidos; só quando
+ * uma linha atravessa duas leituras é que os bytes vão para pb->buf.
+ */
+static inline int proto_next_line(ProtoBuf *pb, ProtoInput *in, StrView *line) {
+    const char *nl = in->len ? memchr(in->data, '\n', in->len) : NULL;
+    if (nl == NULL) {
+        if (in->len == 0)
+            return PROTO_PARTIAL;
+        if (pb->len + in->len > pb->cap)
+            return PROTO_OVERFLOW;
+        memcpy(pb->buf + pb->len, in->data, in->len);
+        pb->len += in->len;
+        in->data += in->len;
+        in->len = 0;
+        return PROTO_PARTIAL;
+    }
+    size_t n = (size_t)(nl - in->data);
+    if (pb->len == 0) {
+        line->p = in->data;
+        line->len = (uint32_t)n;
+    } else {
+        if (pb->len + n > pb->cap)
+            return PROTO_OVERFLOW;
+        memcpy(pb->buf + pb->len, in->data, n);
+        line->p = pb->buf;
+        line->len = (uint32_t)(pb->len + n);
+        pb->len = 0;   // a vista continua válida até à próxima chamada
+    }
+    if (line->len > 0 && line->p[line->len - 1] == '\r')
+        line->len--;
+    in->data = nl + 1;
+    in->len -= n + 1;
+    return PROTO_LINE;
+}
+
+/* ---------- formato binário ---------- */
+
+#define TLV_HDR_MAX 4                     // T + L em até 3 bytes
+#define TLV_LEN_MAX ((1u << 21) - 1)
+#define TLV_BAD ((size_t)-1)
+
+static inline size_t tlv_put_varint(uint8_t *out, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+// Lê um varint de até max bytes; devolve os bytes usados, 0 se faltarem
+// bytes ou TLV_BAD se for mais longo do que max
+static inline size_t tlv_get_varint(const uint8_t *p, size_t len, size_t max, uint32_t *v) {
+    uint32_t r = 0;
+    for (size_t i = 0; i < max; i++) {
+        if (i == len)
+            return 0;
+        r |= (uint32_t)(p[i] & 0x7f) << (7 * i);
+        if (!(p[i] & 0x80)) {
+            *v = r;
+            return i + 1;
+        }
+    }
+    return TLV_BAD;
+}
+
+static inline void tlv_put32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static inline uint32_t tlv_get32(const uint8_t *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static inline size_t tlv_put_header(uint8_t *out, MsgType type, uint32_t vlen) {
+    out[0] = (uint8_t)type;
+    return 1 + tlv_put_varint(out + 1, vlen);
+}
+
+// Tamanho total da trama que começa em p; 0 se o cabeçalho ainda não chegou
+static inline size_t tlv_frame_size(const uint8_t *p, size_t len) {
+    uint32_t vlen;
+    if (len < 2)
+        return 0;
+    size_t h = tlv_get_varint(p + 1, len - 1, TLV_HDR_MAX - 1, &vlen);
+    if (h == 0 || h == TLV_BAD)
+        return h;
+    return 1 + h + vlen;
+}
+
+// ENTRY, SAFE ou LEAVE; out com pelo menos TLV_HDR_MAX + 6 bytes
+static inline size_t tlv_put_addr(uint8_t *out, MsgType type, NodeId id) {
+    size_t n = tlv_put_header(out, type, 6);
+    tlv_put32(out + n, nodeid_addr(id));
+    out[n + 4] = (uint8_t)(nodeid_port(id) >> 8);
+    out[n + 5] = (uint8_t)nodeid_port(id);
+    return n + 6;
+}
+
+// INTEREST (com nonce), OBJECT ou NOOBJECT; out com TLV_HDR_MAX + 12 + len bytes
+static inline size_t tlv_put_name(uint8_t *out, MsgType type, const char *name, uint32_t len,
+                                  uint32_t hash, uint32_t hash2, uint32_t nonce) {
+    uint32_t fixed = type == MSG_INTEREST ? 12 : 8;
+    size_t n = tlv_put_header(out, type, fixed + len);
+    tlv_put32(out + n, hash);
+    tlv_put32(out + n + 4, hash2);
+    if (type == MSG_INTEREST)
+        tlv_put32(out + n + 8, nonce);
+    memcpy(out + n + fixed, name, len);
+    return n + fixed + len;
+}
+
+static inline size_t tlv_put_digest(uint8_t *out, uint32_t bits, int k) {
+    size_t n = tlv_put_header(out, MSG_DIGEST, 5);
+    tlv_put32(out + n, bits);
+    out[n + 4] = (uint8_t)k;
+    return n + 5;
+}
+
+static inline size_t tlv_put_hello(uint8_t *out, uint32_t interval) {
+    size_t n = tlv_put_header(out, MSG_HELLO, 4);
+    tlv_put32(out + n, interval);
+    return n + 4;
+}
+
+/*
+ * Analisa uma trama completa (vinda de proto_next_frame). Os campos ficam
+ * em m como os de uma linha de texto, exceto o ip, que só vem em node; o
+ * nome aponta para a trama.
+ */
+static inline int proto_parse_tlv(const char *frame, size_t len, ProtoMsg *m) {
+    const uint8_t *p = (const uint8_t *)frame;
+    uint32_t vlen;
+    size_t h = len < 2 ? 0 : tlv_get_varint(p + 1, len - 1, TLV_HDR_MAX - 1, &vlen);
+    m->type = MSG_UNKNOWN;
+    m->ntok = 0;
+    m->nonce = 0;
+    m->tlv = 0;
+    m->binary = 1;
+    if (h == 0 || h == TLV_BAD || 1 + h + vlen != len)
+        return PROTO_BAD;
+    const uint8_t *v = p + 1 + h;
+    m->rest.p = (const char *)v;
+    m->rest.len = vlen;
+    uint32_t fixed;
+    switch (p[0]) {
+    case MSG_ENTRY:
+    case MSG_SAFE:
+    case MSG_LEAVE:
+        m->type = (MsgType)p[0];
+        if (vlen != 6)
+            return PROTO_BAD;
+        m->ip.p = NULL;
+        m->ip.len = 0;
+        m->port = v[4] << 8 | v[5];
+        m->node = nodeid_make(tlv_get32(v), (uint16_t)m->port);
+        return PROTO_OK;
+    case MSG_INTEREST:
+    case MSG_OBJECT:
+    case MSG_NOOBJECT:
+        m->type = (MsgType)p[0];
+        fixed = m->type == MSG_INTEREST ? 12 : 8;
+        if (vlen <= fixed)
+            return PROTO_BAD;
+        m->hash = tlv_get32(v);
+        m->hash2 = tlv_get32(v + 4);
+        if (m->type == MSG_INTEREST)
+            m->nonce = tlv_get32(v + 8);
+        m->name.p = (const char *)v + fixed;
+        m->name.len = vlen - fixed;
+        return PROTO_OK;
+    case MSG_DIGEST:
+        m->type = MSG_DIGEST;
+        if (vlen != 5)
+            return PROTO_BAD;
+        m->bits = tlv_get32(v);
+        m->k = v[4];
+        return PROTO_OK;
+    case MSG_DIGESTSET:
+    case MSG_DIGESTCLR:
+        m->type = (MsgType)p[0];
+        return PROTO_OK;
+    case MSG_HELLO:
+        m->type = MSG_HELLO;
+        if (vlen != 4)
+            return PROTO_BAD;
+        m->interval = tlv_get32(v);
+        return PROTO_OK;
+    default:
+        return PROTO_OK;   // tipo desconhecido: ignorado
+    }
+}
+
+// Próxima posição de um DIGESTSET ou DIGESTCLR, em texto ou binário;
+// *cur começa em m->rest.p. Devolve 0 no fim ou num valor inválido.
+static inline int proto_next_position(const ProtoMsg *m, const char **cur, uint32_t *pos) {
+    const char *end = m->rest.p + m->rest.len;
+    if (m->binary) {
+        size_t n = tlv_get_varint((const uint8_t *)*cur, (size_t)(end - *cur), 5, pos);
+        if (n == 0 || n == TLV_BAD)
+            return 0;
+        *cur += n;
+        return 1;
+    }
+    StrView t;
+    long v;
+    if (!proto_token(cur, end, &t) || (v = sv_to_uint(t, 0x7fffffffL)) < 0)
+        return 0;
+    *pos = (uint32_t)v;
+    return 1;
+}
+
+/*
+ * Próxima trama completa de pb + in, como proto_next_line: vista direta
+ * para os dados recebidos se a trama estiver toda lá, senão os bytes vão
+ * sendo juntados em pb->buf (o cabeçalho byte a byte, para não apanhar o
+ * início da trama seguinte).
+ */
+static inline int proto_next_frame(ProtoBuf *pb, ProtoInput *in, StrView *frame) {
+    if (pb->len == 0) {
+        size_t n = tlv_frame_size((const uint8_t *)in->data, in->len);
+        if (n == TLV_BAD)
+            return PROTO_OVERFLOW;
+        if (n != 0 && n <= in->len) {
+            frame->p = in->data;
+            frame->len = (uint32_t)n;
+            in->data += n;
+            in->len -= n;
+            return PROTO_LINE;
+        }
+    }
+    for (;;) {
+        size_t need = tlv_frame_size((const uint8_t *)pb->buf, pb->len);
+        if (need == TLV_BAD || need > pb->cap)
+            return PROTO_OVERFLOW;
+        if (need != 0 && pb->len == need) {
+            frame->p = pb->buf;
+            frame->len = (uint32_t)need;
+            pb->len = 0;
+            return PROTO_LINE;
+        }
+        if (in->len == 0)
+            return PROTO_PARTIAL;
+        size_t take = need != 0 ? need - pb->len : 1;
+        if (take > in->len)
+            take = in->len;
+        if (pb->len + take > pb->cap)
+            return PROTO_OVERFLOW;
+        memcpy(pb->buf + pb->len, in->data, take);
+        pb->len += take;
+        in->data += take;
+        in->len -= take;
+    }
+}
+
+#endif
@@ -0,0 +1,463 @@
+// proto_bench.c
+//
+// Débito do analisador do protocolo, em mensagens por segundo:
+//
+//   gcc -O2 -o proto_bench proto_bench.c
+//   ./proto_bench [mensagens] [repetições]
+//   ./proto_bench nomes [iterações]
+//   ./proto_bench formatos [iterações]
+//
+// O mesmo fluxo de mensagens (INTEREST com nonce, OBJECT, NOOBJECT e SAFE,
+// na proporção 2:1:1:1) é entregue em leituras de 1460 bytes e analisado
+// de três maneiras:
+//
+//   sscanf  o caminho antigo: cópia para o buffer da sessão, '\0' no fim
+//           da linha e sscanf do comando, do nome e do nonce
+//   texto   proto_next_line() + proto_parse(), sem cópias
+//   TLV     as mesmas mensagens em tramas: proto_next_frame() +
+//           proto_parse_tlv(), com os hashes de quem enviou
+//
+// Em todos o nome é validado e fica num NameView. A soma de controlo
+// (hash ^ nonce dos nomes, porta dos SAFE) tem de ser igual nos três.
+//
+// Com "nomes", o custo por INTEREST com nomes de 8, 32 e 100 carateres,
+// em nanossegundos, 2M iterações (por omissão) sobre 1024 nomes:
+//
+//   fnv         um FNV-1a de 32 bits, o hash de cada tabela antes do NameView
+//   hash        name_hash64(), o hash do NameView
+//   antigo      sscanf + strcmp do comando + name_valid + seis FNV (PIT, CS,
+//               cache negativa, armazém, FIB e resumo)
+//   sscanf      o mesmo sscanf e strcmp + um name_view_parse
+//   tokens      proto_parse() + name_view_parse(), o caminho atual
+//
+// As somas de controlo (hash ^ nonce) de sscanf e tokens têm de ser iguais.
+//
+// Com "formatos", texto contra TLV com nomes de 3, 12 e 40 carateres:
+// INTEREST, OBJECT e NOOBJECT alternados, cada um codificado a partir do
+// NameView de quem envia (snprintf ou tlv_put_name), analisado
+// (proto_parse ou proto_parse_tlv) e com o NameView de quem recebe feito
+// (name_view_parse ou name_view_parse_hashed). Mostra os bytes por
+// mensagem e os nanossegundos por mensagem, do envio ao NameView; as somas
+// de controlo dos dois formatos têm de ser iguais.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "name.h"
+#include "proto.h"
+
+#define PB_READ 1460    // bytes por leitura, um segmento TCP
+#define PB_NAMES 1024   // nomes diferentes por comprimento, em ciclo
+#define PB_LINE 128     // bytes reservados por linha
+
+static double pb_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+typedef struct {
+    char *data;
+    size_t len;
+} PbStream;
+
+// Mensagem i do fluxo, em texto e em TLV
+static void pb_build(PbStream *text, PbStream *tlv, int n) {
+    text->data = malloc((size_t)n * 64);
+    tlv->data = malloc((size_t)n * 64);
+    text->len = tlv->len = 0;
+    if (text->data == NULL || tlv->data == NULL) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < n; i++) {
+        char name[32];
+        NameView nv;
+        uint32_t nonce = (uint32_t)i * 2654435761u;
+        uint8_t *out = (uint8_t *)tlv->data + tlv->len;
+        switch (i % 5) {
+        case 0:
+        case 1:
+            snprintf(name, sizeof(name), "object%06d", i);
+            name_view(&nv, name);
+            text->len += (size_t)sprintf(text->data + text->len, "INTEREST %s %08x\n", name, nonce);
+            tlv->len += tlv_put_name(out, MSG_INTEREST, name, nv.len, nv.hash, nv.hash2, nonce);
+            break;
+        case 2:
+        case 3:
+            snprintf(name, sizeof(name), i % 5 == 2 ? "object%06d" : "obj%d", i);
+            name_view(&nv, name);
+            text->len += (size_t)sprintf(text->data + text->len, "%s %s\n",
+                                         i % 5 == 2 ? "OBJECT" : "NOOBJECT", name);
+            tlv->len += tlv_put_name(out, i % 5 == 2 ? MSG_OBJECT : MSG_NOOBJECT, name, nv.len,
+                                     nv.hash, nv.hash2, 0);
+            break;
+        default: {
+            int port = 50000 + i % 1000;
+            text->len += (size_t)sprintf(text->data + text->len, "SAFE 127.0.0.%d %d\n", i % 250,
+                                         port);
+            tlv->len += tlv_put_addr(out, MSG_SAFE, nodeid_make(0x7f000000u | (uint32_t)(i % 250),
+                                                                 (uint16_t)port));
+            break;
+        }
+        }
+    }
+}
+
+// Como process_message() antes do proto.h
+static unsigned long pb_sscanf(const PbStream *s) {
+    static char rbuf[1024];
+    size_t rl = 0;
+    unsigned long acc = 0;
+    for (size_t off = 0; off < s->len; off += PB_READ) {
+        size_t n = s->len - off < PB_READ ? s->len - off : PB_READ;
+        memcpy(rbuf + rl, s->data + off, n);
+        rl += n;
+        size_t st = 0;
+        char *nl;
+        while ((nl = memchr(rbuf + st, '\n', rl - st)) != NULL) {
+            *nl = '\0';
+            const char *line = rbuf + st;
+            char command[16], ip[16], name[NDN_NAME_MAX + 1];
+            int port;
+            unsigned nonce = 0;
+            NameView nv;
+            if (sscanf(line, "%15s %100s %8x", command, name, &nonce) >= 2 &&
+                strcmp(command, "ENTRY") != 0 && strcmp(command, "SAFE") != 0) {
+                if (name_view_parse(&nv, name, strlen(name)))
+                    acc += nv.hash ^ nonce;
+            } else if (sscanf(line, "%15s %15s %d", command, ip, &port) == 3) {
+                acc += (unsigned long)port;
+            }
+            st = (size_t)(nl - rbuf) + 1;
+        }
+        memmove(rbuf, rbuf + st, rl - st);
+        rl -= st;
+    }
+    return acc;
+}
+
+static unsigned long pb_text(const PbStream *s) {
+    static char rbuf[1024];
+    ProtoBuf pb = {rbuf, sizeof(rbuf), 0};
+    unsigned long acc = 0;
+    for (size_t off = 0; off < s->len; off += PB_READ) {
+        ProtoInput in = {s->data + off, s->len - off < PB_READ ? s->len - off : PB_READ};
+        StrView line;
+        ProtoMsg m;
+        NameView nv;
+        while (proto_next_line(&pb, &in, &line) == PROTO_LINE) {
+            if (proto_parse(line.p, line.len, &m) != PROTO_OK)
+                continue;
+            if (m.type == MSG_INTEREST || m.type == MSG_OBJECT || m.type == MSG_NOOBJECT) {
+                if (name_view_parse(&nv, m.name.p, m.name.len))
+                    acc += nv.hash ^ m.nonce;
+            } else if (m.type == MSG_SAFE) {
+                acc += (unsigned long)m.port;
+            }
+        }
+    }
+    return acc;
+}
+
+static unsigned long pb_tlv(const PbStream *s) {
+    static char rbuf[1024];
+    ProtoBuf pb = {rbuf, sizeof(rbuf), 0};
+    unsigned long acc = 0;
+    for (size_t off = 0; off < s->len; off += PB_READ) {
+        ProtoInput in = {s->data + off, s->len - off < PB_READ ? s->len - off : PB_READ};
+        StrView frame;
+        ProtoMsg m;
+        NameView nv;
+        while (proto_next_frame(&pb, &in, &frame) == PROTO_LINE) {
+            if (proto_parse_tlv(frame.p, frame.len, &m) != PROTO_OK)
+                continue;
+            if (m.type == MSG_INTEREST || m.type == MSG_OBJECT || m.type == MSG_NOOBJECT) {
+                if (name_view_parse_hashed(&nv, m.name.p, m.name.len, m.hash, m.hash2))
+                    acc += nv.hash ^ (m.type == MSG_INTEREST ? m.nonce : 0);
+            } else if (m.type == MSG_SAFE) {
+                acc += (unsigned long)m.port;
+            }
+        }
+    }
+    return acc;
+}
+
+// FNV-1a de 32 bits, como o name_hash() antes do NameView
+static uint32_t pb_fnv(const char *name, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Chamado por um ponteiro volátil, para o compilador não juntar os seis
+// hashes do mesmo nome num só
+static uint32_t (*volatile pbTableHash)(const char *, size_t) = pb_fnv;
+
+// Nome alfanumérico aleatório de len carateres
+static void pb_random_name(char *name, int len, uint64_t *x) {
+    static const char alnum[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+    for (int j = 0; j < len; j++) {
+        *x ^= *x << 13;
+        *x ^= *x >> 7;
+        *x ^= *x << 17;
+        name[j] = alnum[*x % 36];
+    }
+    name[len] = '\0';
+}
+
+// Linhas "INTEREST nome nonce", terminadas em '\0' (o sscanf precisa), com
+// nomes de len carateres; devolve o comprimento de cada uma em lens
+static char *pb_lines(int len, size_t *lens) {
+    char *pool = malloc((size_t)PB_NAMES * PB_LINE);
+    if (pool == NULL) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    uint64_t x = 88172645463325252ull;
+    for (int i = 0; i < PB_NAMES; i++) {
+        char name[NDN_NAME_MAX + 1];
+        pb_random_name(name, len, &x);
+        lens[i] = (size_t)snprintf(pool + (size_t)i * PB_LINE, PB_LINE, "INTEREST %s %08x", name,
+                                   (uint32_t)x);
+    }
+    return pool;
+}
+
+// Comprimento do nome de uma linha "INTEREST nome nonce"
+static size_t pb_name_len(const char *line, size_t len) {
+    return (size_t)((const char *)memchr(line + 9, ' ', len - 9) - (line + 9));
+}
+
+static unsigned long pb_name_fnv(const char *line, size_t len) {
+    return pb_fnv(line + 9, pb_name_len(line, len));
+}
+
+static unsigned long pb_name_hash(const char *line, size_t len) {
+    return name_hash64(line + 9, pb_name_len(line, len));
+}
+
+// process_message() antes do NameView
+static unsigned long pb_name_old(const char *line, size_t len) {
+    char command[16], name[NDN_NAME_MAX + 1];
+    unsigned nonce = 0;
+    (void)len;
+    if (sscanf(line, "%15s %100s %8x", command, name, &nonce) < 2 ||
+        strcmp(command, "ENTRY") == 0 || strcmp(command, "SAFE") == 0 || !name_valid(name) ||
+        strcmp(command, "INTEREST") != 0)
+        return 0;
+    unsigned long acc = nonce;
+    size_t n = strlen(name);
+    for (int t = 0; t < 6; t++)
+        acc += pbTableHash(name, n);
+    return acc;
+}
+
+static unsigned long pb_name_sscanf(const char *line, size_t len) {
+    char command[16], name[NDN_NAME_MAX + 1];
+    unsigned nonce = 0;
+    NameView nv;
+    (void)len;
+    if (sscanf(line, "%15s %100s %8x", command, name, &nonce) < 2 ||
+        strcmp(command, "ENTRY") == 0 || strcmp(command, "SAFE") == 0 ||
+        strcmp(command, "INTEREST") != 0 || !name_view_parse(&nv, name, strlen(name)))
+        return 0;
+    return nv.hash ^ nonce;
+}
+
+static unsigned long pb_name_tokens(const char *line, size_t len) {
+    ProtoMsg m = {0};
+    NameView nv;
+    if (proto_parse(line, len, &m) != PROTO_OK || m.type != MSG_INTEREST ||
+        !name_view_parse(&nv, m.name.p, m.name.len))
+        return 0;
+    return nv.hash ^ m.nonce;
+}
+
+typedef struct {
+    const char *name;
+    unsigned long (*fn)(const char *line, size_t len);
+} PbNameCase;
+
+static const PbNameCase pbNameCases[] = {
+    {"fnv", pb_name_fnv},
+    {"hash", pb_name_hash},
+    {"antigo", pb_name_old},
+    {"sscanf", pb_name_sscanf},
+    {"tokens", pb_name_tokens},
+};
+
+// Tabela do modo "nomes"; devolve 1 se sscanf e tokens não derem o mesmo
+static int pb_names(long iters) {
+    static const int lengths[] = {8, 32, 100};
+    int ncases = (int)(sizeof(pbNameCases) / sizeof(pbNameCases[0]));
+    int failed = 0;
+    printf("%ld INTEREST por caso, ns por mensagem\n", iters);
+    printf("nome ");
+    for (int c = 0; c < ncases; c++)
+        printf("%9s", pbNameCases[c].name);
+    printf("\n");
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        size_t lens[PB_NAMES];
+        char *lines = pb_lines(lengths[l], lens);
+        unsigned long acc[sizeof(pbNameCases) / sizeof(pbNameCases[0])];
+        printf("%4d ", lengths[l]);
+        for (int c = 0; c < ncases; c++) {
+            acc[c] = 0;
+            double t0 = pb_now();
+            for (long i = 0; i < iters; i++) {
+                int k = (int)(i % PB_NAMES);
+                acc[c] += pbNameCases[c].fn(lines + (size_t)k * PB_LINE, lens[k]);
+            }
+            printf("%9.1f", (pb_now() - t0) * 1e9 / (double)iters);
+        }
+        printf("\n");
+        if (acc[3] != acc[4] || acc[4] == 0)
+            failed = 1;
+        free(lines);
+    }
+    if (failed)
+        printf("As somas de controlo de sscanf e tokens diferem\n");
+    return failed;
+}
+
+// Um nome de cada formato: codifica, analisa e faz o NameView de quem recebe
+static unsigned long pb_format_text(const NameView *nv, MsgType type, uint32_t nonce,
+                                    size_t *bytes) {
+    char buf[PB_LINE];
+    ProtoMsg m = {0};
+    NameView rx;
+    int n;
+    if (type == MSG_INTEREST)
+        n = snprintf(buf, sizeof(buf), "INTEREST %s %08x\n", nv->name, nonce);
+    else
+        n = snprintf(buf, sizeof(buf), "%s %.*s\n", proto_type_name(type), (int)nv->len,
+                     nv->name);
+    *bytes += (size_t)n;
+    if (proto_parse(buf, (size_t)n - 1, &m) != PROTO_OK ||
+        !name_view_parse(&rx, m.name.p, m.name.len))
+        return 0;
+    return rx.hash ^ m.nonce ^ m.type;
+}
+
+static unsigned long pb_format_tlv(const NameView *nv, MsgType type, uint32_t nonce,
+                                   size_t *bytes) {
+    uint8_t buf[PB_LINE];
+    ProtoMsg m = {0};
+    NameView rx;
+    size_t n = tlv_put_name(buf, type, nv->name, nv->len, nv->hash, nv->hash2, nonce);
+    *bytes += n;
+    if (proto_parse_tlv((const char *)buf, n, &m) != PROTO_OK ||
+        !name_view_parse_hashed(&rx, m.name.p, m.name.len, m.hash, m.hash2))
+        return 0;
+    return rx.hash ^ (type == MSG_INTEREST ? m.nonce : 0) ^ m.type;
+}
+
+// Tabela do modo "formatos"; devolve 1 se os dois formatos não derem o mesmo
+static int pb_formats(long iters) {
+    static const int lengths[] = {3, 12, 40};
+    static const MsgType types[] = {MSG_INTEREST, MSG_OBJECT, MSG_NOOBJECT};
+    unsigned long (*const fns[])(const NameView *, MsgType, uint32_t, size_t *) = {
+        pb_format_text, pb_format_tlv};
+    int failed = 0;
+    printf("%ld mensagens por caso (INTEREST, OBJECT e NOOBJECT alternados)\n", iters);
+    printf("nome      texto              TLV\n");
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        char *pool = malloc((size_t)PB_NAMES * (NDN_NAME_MAX + 1));
+        NameView *names = malloc(PB_NAMES * sizeof(*names));
+        if (pool == NULL || names == NULL) {
+            perror("malloc");
+            exit(EXIT_FAILURE);
+        }
+        uint64_t x = 88172645463325252ull;
+        for (int i = 0; i < PB_NAMES; i++) {
+            char *name = pool + (size_t)i * (NDN_NAME_MAX + 1);
+            pb_random_name(name, lengths[l], &x);
+            name_view(&names[i], name);
+        }
+        unsigned long acc[2];
+        printf("%4d ", lengths[l]);
+        for (int f = 0; f < 2; f++) {
+            size_t bytes = 0;
+            acc[f] = 0;
+            double t0 = pb_now();
+            for (long i = 0; i < iters; i++)
+                acc[f] += fns[f](&names[i % PB_NAMES], types[i % 3],
+                                 (uint32_t)i * 2654435761u, &bytes);
+            double ns = (pb_now() - t0) * 1e9 / (double)iters;
+            printf("  %6.1f ns %5.1f B", ns, (double)bytes / (double)iters);
+        }
+        printf("\n");
+        if (acc[0] != acc[1])
+            failed = 1;
+        free(pool);
+        free(names);
+    }
+    if (failed)
+        printf("As somas de controlo de texto e TLV diferem\n");
+    return failed;
+}
+
+// Melhor de reps passagens, em milhões de mensagens por segundo
+static double pb_run(unsigned long (*fn)(const PbStream *), const PbStream *s, int n, int reps,
+                     unsigned long *acc) {
+    double best = 0;
+    for (int r = 0; r < reps; r++) {
+        double t0 = pb_now();
+        *acc = fn(s);
+        double rate = n / (pb_now() - t0) / 1e6;
+        if (rate > best)
+            best = rate;
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "nomes") == 0) {
+        long iters = argc > 2 ? atol(argv[2]) : 2000000;
+        if (iters <= 0) {
+            fprintf(stderr, "Uso: %s nomes [iterações]\n", argv[0]);
+            return 2;
+        }
+        return pb_names(iters);
+    }
+    if (argc > 1 && strcmp(argv[1], "formatos") == 0) {
+        long iters = argc > 2 ? atol(argv[2]) : 2000000;
+        if (iters <= 0) {
+            fprintf(stderr, "Uso: %s formatos [iterações]\n", argv[0]);
+            return 2;
+        }
+        return pb_formats(iters);
+    }
+    int n = argc > 1 ? atoi(argv[1]) : 200000;
+    int reps = argc > 2 ? atoi(argv[2]) : 20;
+    if (n <= 0 || reps <= 0) {
+        fprintf(stderr, "Uso: %s [mensagens] [repetições] | nomes|formatos [iterações]\n",
+                argv[0]);
+        return 2;
+    }
+    PbStream text, tlv;
+    pb_build(&text, &tlv, n);
+    printf("%d mensagens, %zu bytes em texto, %zu em TLV, leituras de %d bytes\n", n, text.len,
+           tlv.len, PB_READ);
+
+    unsigned long a, b, c;
+    double ra = pb_run(pb_sscanf, &text, n, reps, &a);
+    double rb = pb_run(pb_text, &text, n, reps, &b);
+    double rc = pb_run(pb_tlv, &tlv, n, reps, &c);
+    printf("sscanf: %6.2f M msg/s  (controlo %lu)\n", ra, a);
+    printf("texto:  %6.2f M msg/s  (controlo %lu)\n", rb, b);
+    printf("TLV:    %6.2f M msg/s  (controlo %lu)\n", rc, c);
+    free(text.data);
+    free(tlv.data);
+    if (a != b || b != c) {
+        printf("As somas de controlo diferem\n");
+        return 1;
+    }
+    return 0;
+}
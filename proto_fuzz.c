@@ -0,0 +1,258 @@
+// proto_fuzz.c
+//
+// Alvo de fuzzing do enquadramento e da análise das mensagens (texto e TLV).
+// O primeiro byte da entrada escolhe o formato (bit 0) e é a semente dos
+// tamanhos das leituras; o resto é o fluxo recebido. O fluxo é enquadrado
+// de uma só vez e também em pedaços de tamanho aleatório, como chega de um
+// socket, e as linhas ou tramas têm de ser iguais byte a byte. Cada uma é
+// depois analisada (proto_parse / proto_parse_tlv, NameView, posições de um
+// DIGESTSET, linhas de uma NODESLIST) e as vistas têm de ficar dentro dela.
+//
+// Com libFuzzer:
+//
+//   clang -g -O1 -fsanitize=fuzzer,address,undefined -DPROTO_FUZZ_LIBFUZZER
+//         -o proto_fuzz proto_fuzz.c
+//   ./proto_fuzz
+//
+// Sem clang, o main deste ficheiro muta um conjunto de sementes:
+//
+//   gcc -g -O1 -fsanitize=address,undefined -o proto_fuzz proto_fuzz.c
+//   ./proto_fuzz [iterações] [semente]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "name.h"
+#include "proto.h"
+
+#define PF_BUF 256   // buffer de linha parcial, como o de uma sessão pequena
+
+#define PF_CHECK(cond)                                                             \
+    do {                                                                           \
+        if (!(cond)) {                                                             \
+            fprintf(stderr, "%s:%d: falhou %s\n", __FILE__, __LINE__, #cond);      \
+            abort();                                                               \
+        }                                                                          \
+    } while (0)
+
+// A vista v está dentro de [p, p + len)
+static int pf_inside(StrView v, const char *p, size_t len) {
+    return v.len == 0 || (v.p >= p && v.p + v.len <= p + len);
+}
+
+static void pf_check_text(StrView line) {
+    ProtoMsg m = {0};
+    NameView nv;
+    if (proto_parse(line.p, line.len, &m) != PROTO_OK)
+        return;
+    for (int i = 0; i < m.ntok; i++)
+        PF_CHECK(pf_inside(m.tok[i], line.p, line.len));
+    PF_CHECK(pf_inside(m.rest, line.p, line.len));
+    if (m.type == MSG_INTEREST || m.type == MSG_OBJECT || m.type == MSG_NOOBJECT) {
+        PF_CHECK(pf_inside(m.name, line.p, line.len));
+        if (name_view_parse(&nv, m.name.p, m.name.len))
+            PF_CHECK(nv.len <= NDN_NAME_MAX);
+    }
+    if (m.type == MSG_ENTRY || m.type == MSG_SAFE || m.type == MSG_LEAVE) {
+        PF_CHECK(m.port >= 0 && m.port <= 65535);
+        PF_CHECK(m.node == NODEID_NONE || nodeid_port(m.node) == m.port);
+    }
+    if (m.type == MSG_DIGESTSET || m.type == MSG_DIGESTCLR) {
+        const char *cur = m.rest.p;
+        uint32_t pos;
+        while (proto_next_position(&m, &cur, &pos))
+            PF_CHECK(cur <= m.rest.p + m.rest.len);
+    }
+}
+
+static void pf_check_frame(StrView frame) {
+    ProtoMsg m = {0};
+    NameView nv;
+    if (proto_parse_tlv(frame.p, frame.len, &m) != PROTO_OK)
+        return;
+    if (m.type == MSG_INTEREST || m.type == MSG_OBJECT || m.type == MSG_NOOBJECT) {
+        PF_CHECK(pf_inside(m.name, frame.p, frame.len));
+        name_view_parse_hashed(&nv, m.name.p, m.name.len, m.hash, m.hash2);
+    }
+    if (m.type == MSG_DIGESTSET || m.type == MSG_DIGESTCLR) {
+        PF_CHECK(pf_inside(m.rest, frame.p, frame.len));
+        const char *cur = m.rest.p;
+        uint32_t pos;
+        while (proto_next_position(&m, &cur, &pos))
+            PF_CHECK(cur <= m.rest.p + m.rest.len);
+    }
+}
+
+typedef int (*PfNext)(ProtoBuf *pb, ProtoInput *in, StrView *out);
+
+// Enquadra data de uma vez e em pedaços de 1 a maxpiece bytes e compara
+static void pf_compare(PfNext next, const uint8_t *data, size_t size, unsigned seed,
+                       size_t maxpiece, void (*check)(StrView)) {
+    char a[PF_BUF], b[PF_BUF];
+    ProtoBuf pa = {a, sizeof(a), 0}, pb = {b, sizeof(b), 0};
+    ProtoInput whole = {(const char *)data, size}, in = {(const char *)data, 0};
+    StrView va, vb;
+    size_t off = 0;
+    for (;;) {
+        int ra = next(&pa, &whole, &va);
+        int rb;
+        while ((rb = next(&pb, &in, &vb)) == PROTO_PARTIAL && off < size) {
+            seed = seed * 1103515245u + 12345u;
+            size_t n = 1 + (seed >> 16) % maxpiece;
+            if (n > size - off)
+                n = size - off;
+            in.data = (const char *)data + off;
+            in.len = n;
+            off += n;
+        }
+        if (ra != PROTO_LINE) {
+            // Sem mais linhas inteiras de uma vez, os pedaços também não as dão
+            PF_CHECK(rb != PROTO_LINE);
+            break;
+        }
+        if (rb != PROTO_LINE) {
+            PF_CHECK(rb == PROTO_OVERFLOW);
+            break;
+        }
+        PF_CHECK(va.len == vb.len && memcmp(va.p, vb.p, va.len) == 0);
+        check(va);
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size < 1)
+        return 0;
+    unsigned mode = data[0];
+    data++;
+    size--;
+    if (mode & 1) {
+        pf_compare(proto_next_frame, data, size, mode, 9, pf_check_frame);
+        return 0;
+    }
+    pf_compare(proto_next_line, data, size, mode, 17, pf_check_text);
+    // O mesmo texto como datagrama de uma NODESLIST
+    ProtoLines it;
+    StrView line, ip;
+    int port = 0;
+    NodeId id;
+    proto_lines_init(&it, (const char *)data, size);
+    while (proto_lines_next(&it, &line)) {
+        if (proto_parse_node(line, &ip, &port) == 0)
+            PF_CHECK(port >= 0 && port <= 65535 && ip.len > 0 && pf_inside(ip, line.p, line.len));
+        if (proto_parse_node_id(line, &id) == 0)
+            PF_CHECK(nodeid_port(id) == port);
+    }
+    return 0;
+}
+
+#ifndef PROTO_FUZZ_LIBFUZZER
+
+static uint64_t pfState = 88172645463325252ull;
+
+static unsigned pf_random(void) {
+    pfState ^= pfState << 13;
+    pfState ^= pfState >> 7;
+    pfState ^= pfState << 17;
+    return (unsigned)pfState;
+}
+
+static const char *pfTextSeeds[] = {
+    "ENTRY 127.0.0.1 5000 TLV\nSAFE 10.0.0.1 1\n",
+    "INTEREST abc 0000beef\r\nOBJECT abc\nNOOBJECT z\n",
+    "NODESLIST 010\n1.2.3.4 5\n\n9.9.9.9 65535\n",
+    "DIGEST 8192 4\nDIGESTSET 1 2 3 4\nDIGESTCLR 99\n",
+    "LEAVE 1.1.1.1 1\nOKREG\nOKUNREG\nHELLO 1000\nTLV\n",
+};
+
+// Sementes binárias: uma trama de cada tipo
+static size_t pf_tlv_seed(uint8_t *out) {
+    size_t n = 0;
+    uint8_t v[64];
+    size_t l = 0;
+    NameView nv;
+    name_view(&nv, "abcdef");
+    n += tlv_put_addr(out + n, MSG_SAFE, nodeid_make(0x0a010203, 4242));
+    n += tlv_put_addr(out + n, MSG_ENTRY, nodeid_make(0x7f000001, 58001));
+    n += tlv_put_name(out + n, MSG_INTEREST, nv.name, nv.len, nv.hash, nv.hash2, 0xbeef);
+    n += tlv_put_name(out + n, MSG_OBJECT, nv.name, nv.len, nv.hash, nv.hash2, 0);
+    n += tlv_put_name(out + n, MSG_NOOBJECT, nv.name, nv.len, nv.hash, nv.hash2, 0);
+    n += tlv_put_digest(out + n, 8192, 4);
+    n += tlv_put_hello(out + n, 1000);
+    for (int i = 0; i < 10; i++)
+        l += tlv_put_varint(v + l, (uint32_t)i * 777);
+    n += tlv_put_header(out + n, MSG_DIGESTSET, (uint32_t)l);
+    memcpy(out + n, v, l);
+    return n + l;
+}
+
+// Muta buf (n bytes, até cap): trocas, inserções, remoções e repetições
+static size_t pf_mutate(uint8_t *buf, size_t n, size_t cap) {
+    static const char dict[] = "\n\r \t0123456789abcdefABCDEFxyz.-:";
+    int muts = 1 + (int)(pf_random() % 8);
+    for (int k = 0; k < muts && n > 1; k++) {
+        size_t pos = 1 + pf_random() % (n - 1);   // o byte 0 é o modo
+        uint8_t c = pf_random() % 2 ? (uint8_t)pf_random()
+                                    : (uint8_t)dict[pf_random() % (sizeof(dict) - 1)];
+        switch (pf_random() % 5) {
+        case 0:
+            buf[pos] = c;
+            break;
+        case 1:
+            if (n < cap) {
+                memmove(buf + pos + 1, buf + pos, n - pos);
+                buf[pos] = c;
+                n++;
+            }
+            break;
+        case 2:
+            memmove(buf + pos, buf + pos + 1, n - pos - 1);
+            n--;
+            break;
+        case 3: {
+            size_t l = pf_random() % 300;
+            if (n + l <= cap) {
+                memmove(buf + pos + l, buf + pos, n - pos);
+                memset(buf + pos, c, l);
+                n += l;
+            }
+            break;
+        }
+        default:
+            buf[pos] ^= (uint8_t)(1u << (pf_random() % 8));
+            break;
+        }
+    }
+    return n;
+}
+
+int main(int argc, char *argv[]) {
+    long iters = argc > 1 ? atol(argv[1]) : 1000000;
+    if (argc > 2)
+        pfState = strtoull(argv[2], NULL, 0) | 1;
+    uint8_t tlv[512], buf[1200];
+    size_t ntlv = pf_tlv_seed(tlv);
+    int nseeds = (int)(sizeof(pfTextSeeds) / sizeof(pfTextSeeds[0]));
+    for (long i = 0; i < iters; i++) {
+        size_t n;
+        int seed = (int)(i % (nseeds + 1));
+        if (seed == nseeds) {
+            buf[0] = (uint8_t)(pf_random() | 1);
+            memcpy(buf + 1, tlv, ntlv);
+            n = 1 + ntlv;
+        } else {
+            buf[0] = (uint8_t)(pf_random() & ~1u);
+            n = strlen(pfTextSeeds[seed]);
+            memcpy(buf + 1, pfTextSeeds[seed], n);
+            n++;
+        }
+        if (i % 16 != 0)
+            n = pf_mutate(buf, n, sizeof(buf));
+        LLVMFuzzerTestOneInput(buf, n);
+    }
+    printf("%ld entradas sem falhas\n", iters);
+    return 0;
+}
+
+#endif
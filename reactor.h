@@ -0,0 +1,1372 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+
+#include "timer.h"
+
+/*
+ * Reactor de eventos com três backends escolhidos em compilação:
+ *
+ *   (por omissão)        epoll, O(descritores prontos) por espera
+ *   -DREACTOR_SELECT     select(), fallback portátil limitado a FD_SETSIZE
+ *   -DREACTOR_IO_URING   io_uring (Linux >= 6.0), sem liburing: accept
+ *                        multishot, recv multishot com anel de buffers
+ *                        fornecidos e envios submetidos em lote
+ *
+ * Cada descritor é registado uma única vez com a sua função de callback.
+ * Há três tipos de registo:
+ *
+ *   reactor_add()          notificação de prontidão (STDIN, UDP, ...)
+ *   reactor_add_listener() socket de escuta; o callback recebe o novo fd
+ *   reactor_add_stream()   socket TCP; o callback recebe os dados lidos
+ *                          (len 0 = conexão fechada, len < 0 = erro)
+ *
+ * e reactor_write() envia dados por um socket. Num stream os dados ficam na
+ * fila de saída do descritor; no início de cada reactor_run_once() a fila
+ * de cada stream com dados novos é escrita de uma só vez (um writev, ou um
+ * envio no io_uring), juntando todas as mensagens produzidas na iteração
+ * anterior. Se o socket encher, o resto fica em fila e o stream passa a
+ * pedir REACTOR_WRITE até a fila esvaziar. reactor_pending() diz quantos
+ * bytes esperam, para o programa aplicar contrapressão.
+ * reactor_write_ref() põe na fila uma referência aos dados em vez de uma
+ * cópia: a mesma mensagem pode seguir por vários streams, e o callback de
+ * libertação é chamado quando sai da fila.
+ *
+ * O reactor tem uma roda de temporizadores (r->timers, ver timer.h): o
+ * tempo de espera de reactor_run_once() é encurtado até ao próximo prazo e
+ * os temporizadores que expiraram disparam, num lote, depois dos eventos.
+ *
+ * Com REACTOR_ET (edge-triggered) o callback tem de ler até obter EAGAIN,
+ * por isso o descritor deve estar em modo não bloqueante (set_nonblocking).
+ * O STDIN deve ser registado sem REACTOR_ET e sem buffer no stdio
+ * (setvbuf(stdin, NULL, _IONBF, 0)); o callback processa linhas enquanto
+ * fd_pending_bytes(STDIN_FILENO) > 0, senão linhas que cheguem juntas
+ * ficariam à espera de nova notificação.
+ */
+
+#define REACTOR_READ  0x1u
+#define REACTOR_WRITE 0x2u
+#define REACTOR_ET    0x4u
+#define REACTOR_HUP   0x8u   // só entregue ao callback, nunca pedido
+
+#define REACTOR_MAX_EVENTS 64
+#define REACTOR_READ_SIZE  4096  // tamanho de cada leitura de um stream
+#define REACTOR_OUT_BLOCK  4096  // bloco da fila de saída de um stream
+#define REACTOR_OUT_IOV    64    // segmentos por writev
+#define REACTOR_OUT_FLUSH  (64 * 1024)  // bytes em fila que são escritos já, sem esperar
+#ifndef REACTOR_OUT_REF_MIN
+// reactor_write_ref() copia dados mais curtos: até 256 bytes a cópia para o
+// bloco custa menos do que um segmento por mensagem (msgbuf_bench.c)
+#define REACTOR_OUT_REF_MIN 512
+#endif
+#define REACTOR_OUT_MAX    (1u << 20)  // bytes em fila por stream; acima, ENOBUFS
+
+typedef struct Reactor Reactor;
+
+// Callback chamado quando o descritor fica pronto; events é uma combinação
+// de REACTOR_READ / REACTOR_WRITE / REACTOR_HUP
+typedef void (*reactor_cb)(Reactor *r, int fd, uint32_t events, void *arg);
+// Nova conexão aceite no socket de escuta lfd (já em modo não bloqueante)
+typedef void (*reactor_accept_cb)(Reactor *r, int lfd, int newfd, void *arg);
+// Dados recebidos num stream; len 0 = EOF, len < 0 = erro (errno definido)
+typedef void (*reactor_data_cb)(Reactor *r, int fd, const char *data, ssize_t len, void *arg);
+
+enum { REACTOR_KIND_POLL, REACTOR_KIND_LISTENER, REACTOR_KIND_STREAM };
+
+// Os dados passados a reactor_write_ref() já não são precisos
+typedef void (*reactor_release_cb)(void *arg);
+
+// Segmento da fila de saída: um bloco com cópias dos dados ou uma
+// referência a dados de outro dono
+typedef struct ReactorOutSeg {
+    struct ReactorOutSeg *next;
+    const char *data;             // bytes por enviar: data[start, end)
+    uint32_t start, end;
+    reactor_release_cb release;   // referência (NULL: bloco)
+    void *arg;
+} ReactorOutSeg;
+
+typedef struct {
+    ReactorOutSeg seg;
+    char buf[REACTOR_OUT_BLOCK];
+} ReactorOutBlock;
+
+// Fila de saída de um stream
+typedef struct {
+    ReactorOutSeg *head, *tail;
+    size_t bytes;             // em fila
+    size_t inflight;          // io_uring: já submetidos, à espera do CQE
+    int dirty;                // na lista de streams a escrever
+} ReactorOut;
+
+typedef struct {
+    reactor_cb cb;
+    reactor_accept_cb accept_cb;
+    reactor_data_cb data_cb;
+    void *arg;
+    uint32_t events;
+    uint32_t gen;     // incrementado em cada registo/rearme, descarta eventos antigos
+    int kind;
+    int active;
+    ReactorOut out;
+} ReactorHandler;
+
+// Contadores para comparar os backends
+typedef struct {
+    unsigned long syscalls;   // chamadas ao sistema feitas pelo próprio reactor
+    unsigned long wakeups;    // esperas que devolveram eventos
+    unsigned long reads;      // blocos de dados entregues a streams
+    unsigned long accepts;
+    unsigned long writes;     // pedidos de reactor_write()
+    unsigned long flushes;    // writev (ou envios io_uring) das filas de saída
+    unsigned long blocked;    // filas que ficaram à espera de REACTOR_WRITE
+    unsigned long segments;   // blocos e segmentos de referência reservados
+} ReactorStats;
+
+#if defined(REACTOR_IO_URING)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <signal.h>
+#include <poll.h>
+#include <linux/io_uring.h>
+
+#ifndef POLLRDHUP
+#define POLLRDHUP 0x2000
+#endif
+
+#define REACTOR_BACKEND     "io_uring"
+#define REACTOR_URING_DEPTH 256
+#define REACTOR_URING_BUFS  256   // buffers no anel fornecido (potência de 2)
+#define REACTOR_URING_BGID  1
+
+// Envio em curso: os segmentos saíram da fila de saída e voltam às listas
+// livres quando o CQE chega. O kernel lê msg e iov depois da submissão,
+// por isso cada envio tem endereço fixo e é reutilizado, nunca movido.
+typedef struct {
+    struct msghdr msg;
+    struct iovec iov[REACTOR_OUT_IOV];
+    ReactorOutSeg *segs;
+    size_t len;
+    int fd;
+    uint32_t gen;             // geração do stream cuja fila foi enviada
+    int queued;               // conta em ReactorOut.inflight
+    int next_free;
+} ReactorSend;
+
+typedef struct {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_sz, cq_sz, sqes_sz;
+    unsigned sq_entries;
+    unsigned to_submit;
+    struct io_uring_buf_ring *br;  // anel de buffers fornecidos
+    char *bufs;
+    size_t br_sz;
+    ReactorSend **sends;      // indexado pelo slot guardado no user_data
+    int nsends, sends_cap;
+    int free_send;
+} ReactorUring;
+#elif defined(REACTOR_SELECT)
+#include <sys/select.h>
+
+#define REACTOR_BACKEND "select"
+#else
+#include <sys/epoll.h>
+
+#define REACTOR_BACKEND "epoll"
+#endif
+
+struct Reactor {
+#if defined(REACTOR_IO_URING)
+    ReactorUring ring;
+#elif defined(REACTOR_SELECT)
+    int max_fd;
+#else
+    int epfd;
+#endif
+    ReactorHandler *handlers;  // indexado pelo descritor
+    int capacity;
+    int count;                 // descritores registados
+    int running;
+    int *dirty;                // streams com dados novos na fila de saída
+    int ndirty, dirty_cap;
+    ReactorOutSeg *spare;      // blocos livres
+    ReactorOutSeg *spare_refs; // segmentos de referência livres
+    size_t out_ref_min;        // REACTOR_OUT_REF_MIN; 0 referencia tudo
+    TimerWheel timers;
+    ReactorStats stats;
+};
+
+// Coloca o descritor em modo não bloqueante
+static inline int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0)
+        return -1;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// Número de bytes por ler no descritor (0 se não houver ou em erro)
+static inline int fd_pending_bytes(int fd) {
+    int n = 0;
+    if (ioctl(fd, FIONREAD, &n) < 0)
+        return 0;
+    return n;
+}
+
+// Garante que a tabela de handlers tem espaço para o descritor fd
+static inline int reactor_reserve(Reactor *r, int fd) {
+    if (fd < r->capacity)
+        return 0;
+    int cap = r->capacity ? r->capacity : 64;
+    while (cap <= fd)
+        cap *= 2;
+    ReactorHandler *h = realloc(r->handlers, (size_t)cap * sizeof(*h));
+    if (h == NULL)
+        return -1;
+    memset(h + r->capacity, 0, (size_t)(cap - r->capacity) * sizeof(*h));
+    r->handlers = h;
+    r->capacity = cap;
+    return 0;
+}
+
+// Devolve o handler ativo de fd, ou NULL
+static inline ReactorHandler *reactor_handler(Reactor *r, int fd) {
+    if (fd < 0 || fd >= r->capacity || !r->handlers[fd].active)
+        return NULL;
+    return &r->handlers[fd];
+}
+
+static inline int reactor_backend_init(Reactor *r);
+static inline void reactor_out_flush_fd(Reactor *r, int fd, ReactorHandler *h, int final);
+static inline ssize_t reactor_send_now(Reactor *r, int fd, const char *data, size_t len);
+static inline int reactor_backend_arm(Reactor *r, int fd, ReactorHandler *h);
+static inline void reactor_backend_disarm(Reactor *r, int fd, ReactorHandler *h, int removing);
+static inline int reactor_backend_wait(Reactor *r, int timeout_ms);
+static inline void reactor_backend_destroy(Reactor *r);
+
+static inline int reactor_init(Reactor *r) {
+    memset(r, 0, sizeof(*r));
+    r->out_ref_min = REACTOR_OUT_REF_MIN;
+    timer_wheel_init(&r->timers);
+    return reactor_backend_init(r);
+}
+
+/* ------------------------ Filas de saída dos streams ------------------------ */
+
+// Os segmentos que saem da fila voltam às listas livres e só são
+// libertados em reactor_destroy(): depois de as filas atingirem o seu
+// tamanho máximo, escrever não reserva memória
+static inline void reactor_out_release(Reactor *r, ReactorOutSeg *g) {
+    if (g->release != NULL) {
+        g->release(g->arg);
+        g->next = r->spare_refs;
+        r->spare_refs = g;
+    } else {
+        g->next = r->spare;
+        r->spare = g;
+    }
+}
+
+// Descarta tudo o que está em fila
+static inline void reactor_out_clear(Reactor *r, ReactorOut *o) {
+    while (o->head != NULL) {
+        ReactorOutSeg *g = o->head;
+        o->head = g->next;
+        reactor_out_release(r, g);
+    }
+    o->tail = NULL;
+    o->bytes = 0;
+}
+
+// Retira da frente da fila os n bytes já enviados
+static inline void reactor_out_consume(Reactor *r, ReactorOut *o, size_t n) {
+    o->bytes -= n;
+    while (n > 0) {
+        ReactorOutSeg *g = o->head;
+        size_t avail = g->end - g->start;
+        if (n < avail) {
+            g->start += (uint32_t)n;
+            return;
+        }
+        n -= avail;
+        o->head = g->next;
+        reactor_out_release(r, g);
+    }
+    if (o->head == NULL)
+        o->tail = NULL;
+}
+
+// Marca o stream para a próxima escrita
+static inline int reactor_out_mark(Reactor *r, int fd, ReactorOut *o) {
+    if (o->dirty)
+        return 0;
+    if (r->ndirty == r->dirty_cap) {
+        int cap = r->dirty_cap ? r->dirty_cap * 2 : 16;
+        int *d = realloc(r->dirty, (size_t)cap * sizeof(*d));
+        if (d == NULL)
+            return -1;
+        r->dirty = d;
+        r->dirty_cap = cap;
+    }
+    r->dirty[r->ndirty++] = fd;
+    o->dirty = 1;
+    return 0;
+}
+
+static inline void reactor_out_push(ReactorOut *o, ReactorOutSeg *g) {
+    g->next = NULL;
+    if (o->tail != NULL)
+        o->tail->next = g;
+    else
+        o->head = g;
+    o->tail = g;
+}
+
+// Copia os dados para o fim da fila. Os blocos que faltam são reservados
+// antes de copiar: se um falhar, a fila fica como estava e nunca leva só o
+// princípio de uma mensagem.
+static inline int reactor_out_append(Reactor *r, ReactorOut *o, const char *data, size_t len) {
+    ReactorOutSeg *g = o->tail;
+    size_t room = g != NULL && g->release == NULL ? REACTOR_OUT_BLOCK - g->end : 0;
+    ReactorOutSeg *fresh = NULL, **last = &fresh;
+    for (size_t need = len > room ? len - room : 0; need > 0;
+         need -= need < REACTOR_OUT_BLOCK ? need : REACTOR_OUT_BLOCK) {
+        ReactorOutSeg *f = r->spare;
+        if (f != NULL) {
+            r->spare = f->next;
+        } else {
+            ReactorOutBlock *b = malloc(sizeof(*b));
+            if (b == NULL) {
+                *last = r->spare;
+                r->spare = fresh;
+                return -1;
+            }
+            r->stats.segments++;
+            f = &b->seg;
+            f->data = b->buf;
+            f->release = NULL;
+            f->arg = NULL;
+        }
+        f->start = f->end = 0;
+        *last = f;
+        last = &f->next;
+    }
+    *last = NULL;
+    while (len > 0) {
+        if (g == NULL || g->release != NULL || g->end == REACTOR_OUT_BLOCK) {
+            g = fresh;
+            fresh = g->next;
+            reactor_out_push(o, g);
+        }
+        size_t n = REACTOR_OUT_BLOCK - g->end;
+        if (n > len)
+            n = len;
+        memcpy((char *)g->data + g->end, data, n);
+        g->end += (uint32_t)n;
+        o->bytes += n;
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Acrescenta ao fim da fila uma referência aos dados
+static inline int reactor_out_append_ref(Reactor *r, int fd, ReactorOut *o, const char *data,
+                                         size_t len, reactor_release_cb release, void *arg) {
+    if (reactor_out_mark(r, fd, o) < 0)
+        return -1;
+    ReactorOutSeg *g = r->spare_refs;
+    if (g != NULL) {
+        r->spare_refs = g->next;
+    } else if ((g = malloc(sizeof(*g))) == NULL) {
+        return -1;
+    } else {
+        r->stats.segments++;
+    }
+    g->data = data;
+    g->start = 0;
+    g->end = (uint32_t)len;
+    g->release = release;
+    g->arg = arg;
+    reactor_out_push(o, g);
+    o->bytes += len;
+    return 0;
+}
+
+// Escreve as filas dos streams que receberam dados desde a última chamada
+static inline void reactor_out_flush(Reactor *r) {
+    for (int i = 0; i < r->ndirty; i++) {
+        int fd = r->dirty[i];
+        ReactorHandler *h = reactor_handler(r, fd);
+        if (h == NULL || !h->out.dirty)
+            continue;
+        h->out.dirty = 0;
+        // À espera de REACTOR_WRITE: o socket está cheio, nem vale a pena tentar
+        if (!(h->events & REACTOR_WRITE))
+            reactor_out_flush_fd(r, fd, h, 0);
+    }
+    r->ndirty = 0;
+}
+
+// Envia len bytes pelo socket fd. Num stream os dados entram na fila de
+// saída e só são escritos na próxima iteração do reactor; devolve -1 com
+// errno ENOBUFS se a fila já tiver REACTOR_OUT_MAX bytes. Uma escrita que
+// falha não deixa nada na fila.
+static inline ssize_t reactor_write(Reactor *r, int fd, const char *data, size_t len) {
+    ReactorHandler *h = reactor_handler(r, fd);
+    r->stats.writes++;
+    if (h == NULL || h->kind != REACTOR_KIND_STREAM)
+        return reactor_send_now(r, fd, data, len);
+    if (h->out.bytes + h->out.inflight + len > REACTOR_OUT_MAX) {
+        errno = ENOBUFS;
+        return -1;
+    }
+    if (reactor_out_mark(r, fd, &h->out) < 0 || reactor_out_append(r, &h->out, data, len) < 0)
+        return -1;
+    // Já há muito para escrever: não vale a pena esperar pelo fim da iteração
+    if (h->out.bytes >= REACTOR_OUT_FLUSH && !(h->events & REACTOR_WRITE))
+        reactor_out_flush_fd(r, fd, h, 0);
+    return (ssize_t)len;
+}
+
+// Como reactor_write(), mas sem copiar: os dados têm de se manter até o
+// reactor chamar release(arg), o que acontece exatamente uma vez, também
+// quando o envio falha (e fora de um stream, logo após o envio)
+static inline ssize_t reactor_write_ref(Reactor *r, int fd, const char *data, size_t len,
+                                        reactor_release_cb release, void *arg) {
+    ReactorHandler *h = reactor_handler(r, fd);
+    r->stats.writes++;
+    ssize_t ret = (ssize_t)len;
+    if (h == NULL || h->kind != REACTOR_KIND_STREAM) {
+        ret = reactor_send_now(r, fd, data, len);
+    } else if (h->out.bytes + h->out.inflight + len > REACTOR_OUT_MAX) {
+        errno = ENOBUFS;
+        ret = -1;
+    } else if (len < r->out_ref_min) {
+        // Uma mensagem curta custa menos a copiar para o bloco do que a
+        // ocupar sozinha um segmento do writev
+        if (reactor_out_mark(r, fd, &h->out) < 0 || reactor_out_append(r, &h->out, data, len) < 0)
+            ret = -1;
+        else if (h->out.bytes >= REACTOR_OUT_FLUSH && !(h->events & REACTOR_WRITE))
+            reactor_out_flush_fd(r, fd, h, 0);
+    } else if (reactor_out_append_ref(r, fd, &h->out, data, len, release, arg) < 0) {
+        ret = -1;
+    } else {
+        if (h->out.bytes >= REACTOR_OUT_FLUSH && !(h->events & REACTOR_WRITE))
+            reactor_out_flush_fd(r, fd, h, 0);
+        return ret;
+    }
+    release(arg);
+    return ret;
+}
+
+// Bytes escritos com reactor_write() em fd que ainda não saíram do processo
+static inline size_t reactor_pending(Reactor *r, int fd) {
+    ReactorHandler *h = reactor_handler(r, fd);
+    return h == NULL ? 0 : h->out.bytes + h->out.inflight;
+}
+
+static inline int reactor_register(Reactor *r, int fd, int kind, uint32_t events,
+                                   reactor_cb cb, reactor_accept_cb acb,
+                                   reactor_data_cb dcb, void *arg) {
+    if (fd < 0 || reactor_reserve(r, fd) < 0)
+        return -1;
+    ReactorHandler *h = &r->handlers[fd];
+    if (h->active) {
+        errno = EEXIST;
+        return -1;
+    }
+    h->gen++;
+    h->kind = kind;
+    h->events = events;
+    h->cb = cb;
+    h->accept_cb = acb;
+    h->data_cb = dcb;
+    h->arg = arg;
+    if (reactor_backend_arm(r, fd, h) < 0)
+        return -1;
+    h->active = 1;
+    r->count++;
+    return 0;
+}
+
+static inline int reactor_add(Reactor *r, int fd, uint32_t events, reactor_cb cb, void *arg) {
+    return reactor_register(r, fd, REACTOR_KIND_POLL, events, cb, NULL, NULL, arg);
+}
+
+static inline int reactor_add_listener(Reactor *r, int fd, reactor_accept_cb cb, void *arg) {
+    if (set_nonblocking(fd) < 0)
+        return -1;
+    return reactor_register(r, fd, REACTOR_KIND_LISTENER, REACTOR_READ | REACTOR_ET,
+                            NULL, cb, NULL, arg);
+}
+
+static inline int reactor_add_stream(Reactor *r, int fd, reactor_data_cb cb, void *arg) {
+    if (set_nonblocking(fd) < 0)
+        return -1;
+    return reactor_register(r, fd, REACTOR_KIND_STREAM, REACTOR_READ | REACTOR_ET,
+                            NULL, NULL, cb, arg);
+}
+
+// Altera o conjunto de eventos pedidos (ex.: ativar REACTOR_WRITE)
+static inline int reactor_mod(Reactor *r, int fd, uint32_t events) {
+    ReactorHandler *h = reactor_handler(r, fd);
+    if (h == NULL || h->kind != REACTOR_KIND_POLL)
+        return -1;
+    if (h->events == events)
+        return 0;
+    reactor_backend_disarm(r, fd, h, 0);
+    h->events = events;
+    return reactor_backend_arm(r, fd, h);
+}
+
+// Remove o descritor do reactor; deve ser chamado antes de close(fd)
+static inline void reactor_del(Reactor *r, int fd) {
+    ReactorHandler *h = reactor_handler(r, fd);
+    if (h == NULL)
+        return;
+    // Última tentativa de enviar o que está em fila; o resto perde-se
+    if (h->out.bytes > 0)
+        reactor_out_flush_fd(r, fd, h, 1);
+    reactor_out_clear(r, &h->out);
+    h->out.inflight = 0;
+    h->out.dirty = 0;
+    reactor_backend_disarm(r, fd, h, 1);
+    h->active = 0;
+    h->cb = NULL;
+    h->accept_cb = NULL;
+    h->data_cb = NULL;
+    h->arg = NULL;
+    r->count--;
+}
+
+// Espera até timeout_ms (-1 = indefinidamente) ou até ao próximo prazo da
+// roda de temporizadores, despacha os eventos prontos e dispara os
+// temporizadores expirados. Devolve o número de eventos despachados, ou -1
+// em caso de erro.
+static inline int reactor_run_once(Reactor *r, int timeout_ms) {
+    reactor_out_flush(r);
+    int t = timer_timeout(&r->timers);
+    if (t >= 0 && (timeout_ms < 0 || t < timeout_ms))
+        timeout_ms = t;
+    int n = reactor_backend_wait(r, timeout_ms);
+    if (n < 0)
+        return n;
+    if (n > 0)
+        r->stats.wakeups++;
+    timer_run(&r->timers);
+    return n;
+}
+
+static inline void reactor_run(Reactor *r) {
+    r->running = 1;
+    while (r->running) {
+        if (reactor_run_once(r, -1) < 0)
+            break;
+    }
+}
+
+// Pede ao ciclo reactor_run() para terminar após a iteração atual
+static inline void reactor_stop(Reactor *r) {
+    r->running = 0;
+}
+
+static inline void reactor_destroy(Reactor *r) {
+    reactor_backend_destroy(r);
+    for (int fd = 0; fd < r->capacity; fd++)
+        reactor_out_clear(r, &r->handlers[fd].out);
+    while (r->spare != NULL) {
+        ReactorOutSeg *g = r->spare;
+        r->spare = g->next;
+        free(g);
+    }
+    while (r->spare_refs != NULL) {
+        ReactorOutSeg *g = r->spare_refs;
+        r->spare_refs = g->next;
+        free(g);
+    }
+    free(r->dirty);
+    r->dirty = NULL;
+    r->ndirty = r->dirty_cap = 0;
+    free(r->handlers);
+    r->handlers = NULL;
+    r->capacity = 0;
+    r->count = 0;
+}
+
+static inline void reactor_print_stats(const Reactor *r) {
+    printf("Reactor %s: %lu syscalls, %lu esperas com eventos, %lu leituras, "
+           "%lu accepts, %lu escritas em %lu envios, %lu filas à espera de espaço, "
+           "%lu segmentos de saída reservados\n",
+           REACTOR_BACKEND, r->stats.syscalls, r->stats.wakeups, r->stats.reads,
+           r->stats.accepts, r->stats.writes, r->stats.flushes, r->stats.blocked,
+           r->stats.segments);
+}
+
+#if !defined(REACTOR_IO_URING)
+/* ---------- Partes comuns aos backends de prontidão (epoll/select) ---------- */
+
+static inline ssize_t reactor_send_now(Reactor *r, int fd, const char *data, size_t len) {
+    r->stats.syscalls++;
+    return send(fd, data, len, MSG_NOSIGNAL);
+}
+
+// Escreve a fila do stream (sendmsg é o writev dos sockets, com
+// MSG_NOSIGNAL) até a esvaziar ou o socket encher; nesse caso o stream
+// passa a pedir REACTOR_WRITE. final: o fd vai ser fechado, não rearma.
+static inline void reactor_out_flush_fd(Reactor *r, int fd, ReactorHandler *h, int final) {
+    ReactorOut *o = &h->out;
+    while (o->bytes > 0) {
+        struct iovec iov[REACTOR_OUT_IOV];
+        struct msghdr msg;
+        size_t total = 0;
+        int n = 0;
+        for (ReactorOutSeg *g = o->head; g != NULL && n < REACTOR_OUT_IOV; g = g->next) {
+            iov[n].iov_base = (char *)g->data + g->start;
+            iov[n].iov_len = g->end - g->start;
+            total += iov[n++].iov_len;
+        }
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)n;
+        r->stats.syscalls++;
+        r->stats.flushes++;
+        ssize_t w = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            // Ligação com erro: o fecho chega ao callback pela leitura
+            reactor_out_clear(r, o);
+            break;
+        }
+        reactor_out_consume(r, o, (size_t)w);
+        // Escrita parcial: o buffer do socket está cheio
+        if ((size_t)w < total)
+            break;
+    }
+    if (final)
+        return;
+    uint32_t events = o->bytes > 0 ? h->events | REACTOR_WRITE : h->events & ~REACTOR_WRITE;
+    if (events != h->events) {
+        if (o->bytes > 0)
+            r->stats.blocked++;
+        h->events = events;
+        reactor_backend_arm(r, fd, h);
+    }
+}
+
+// Aceita todas as conexões pendentes no socket de escuta
+static inline void reactor_do_accept(Reactor *r, int fd, ReactorHandler *h) {
+    uint32_t gen = h->gen;
+    while (1) {
+        r->stats.syscalls++;
+        int newfd = accept(fd, NULL, NULL);
+        if (newfd < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("accept");
+            return;
+        }
+        r->stats.syscalls += 2;
+        if (set_nonblocking(newfd) < 0) {
+            close(newfd);
+            continue;
+        }
+        r->stats.accepts++;
+        h->accept_cb(r, fd, newfd, h->arg);
+        // O callback pode ter removido o socket de escuta
+        h = reactor_handler(r, fd);
+        if (h == NULL || h->gen != gen)
+            return;
+    }
+}
+
+// Lê o stream até EAGAIN, entregando cada bloco ao callback
+static inline void reactor_do_read(Reactor *r, int fd, ReactorHandler *h) {
+    char buf[REACTOR_READ_SIZE];
+    uint32_t gen = h->gen;
+    while (1) {
+        r->stats.syscalls++;
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (n > 0)
+            r->stats.reads++;
+        h->data_cb(r, fd, buf, n, h->arg);
+        if (n <= 0)
+            return;
+        h = reactor_handler(r, fd);
+        if (h == NULL || h->gen != gen)
+            return;
+    }
+}
+
+static inline void reactor_dispatch(Reactor *r, int fd, ReactorHandler *h, uint32_t ev) {
+    switch (h->kind) {
+    case REACTOR_KIND_LISTENER:
+        reactor_do_accept(r, fd, h);
+        break;
+    case REACTOR_KIND_STREAM:
+        if (ev & REACTOR_WRITE)
+            reactor_out_flush_fd(r, fd, h, 0);
+        if (ev & REACTOR_READ)
+            reactor_do_read(r, fd, h);
+        break;
+    default:
+        h->cb(r, fd, ev, h->arg);
+        break;
+    }
+}
+#endif
+
+#if defined(REACTOR_IO_URING)
+/* ------------------------------ io_uring ------------------------------ */
+
+// user_data: fd (24 bits) | tipo de operação (8 bits) | geração (32 bits)
+enum { URING_OP_POLL = 1, URING_OP_ACCEPT, URING_OP_RECV, URING_OP_SEND, URING_OP_CANCEL };
+
+#define URING_UDATA(fd, op, gen) \
+    (((uint64_t)(gen) << 32) | ((uint64_t)(op) << 24) | ((uint64_t)(fd) & 0xffffffu))
+
+static inline int uring_enter(Reactor *r, unsigned to_submit, unsigned min_complete,
+                              unsigned flags, void *arg, size_t argsz) {
+    r->stats.syscalls++;
+    return (int)syscall(__NR_io_uring_enter, r->ring.fd, to_submit, min_complete,
+                        flags, arg, argsz);
+}
+
+// Submete as SQEs pendentes sem esperar por conclusões
+static inline int reactor_flush(Reactor *r) {
+    ReactorUring *u = &r->ring;
+    while (u->to_submit > 0) {
+        int ret = uring_enter(r, u->to_submit, 0, 0, NULL, 0);
+        if (ret < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                continue;
+            perror("io_uring_enter");
+            return -1;
+        }
+        u->to_submit -= (unsigned)ret;
+    }
+    return 0;
+}
+
+static inline struct io_uring_sqe *uring_get_sqe(Reactor *r) {
+    ReactorUring *u = &r->ring;
+    unsigned tail = *u->sq_tail;
+    unsigned head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= u->sq_entries) {
+        // Fila cheia: submete o lote atual para libertar espaço
+        if (reactor_flush(r) < 0)
+            return NULL;
+        head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+    }
+    unsigned idx = tail & *u->sq_mask;
+    struct io_uring_sqe *sqe = &u->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    u->sq_array[idx] = idx;
+    __atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    u->to_submit++;
+    return sqe;
+}
+
+// Devolve um buffer ao anel de buffers fornecidos
+static inline void uring_recycle_buf(ReactorUring *u, unsigned short bid) {
+    unsigned short tail = u->br->tail;
+    struct io_uring_buf *b = &u->br->bufs[tail & (REACTOR_URING_BUFS - 1)];
+    b->addr = (uint64_t)(uintptr_t)(u->bufs + (size_t)bid * REACTOR_READ_SIZE);
+    b->len = REACTOR_READ_SIZE;
+    b->bid = bid;
+    __atomic_store_n(&u->br->tail, (unsigned short)(tail + 1), __ATOMIC_RELEASE);
+}
+
+static inline int reactor_backend_init(Reactor *r) {
+    ReactorUring *u = &r->ring;
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    u->fd = (int)syscall(__NR_io_uring_setup, REACTOR_URING_DEPTH, &p);
+    if (u->fd < 0) {
+        perror("io_uring_setup");
+        return -1;
+    }
+    if (!(p.features & IORING_FEAT_EXT_ARG)) {
+        fprintf(stderr, "io_uring: kernel sem IORING_FEAT_EXT_ARG\n");
+        close(u->fd);
+        return -1;
+    }
+    u->sq_entries = p.sq_entries;
+    u->sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->cq_sz > u->sq_sz)
+            u->sq_sz = u->cq_sz;
+        u->cq_sz = u->sq_sz;
+    }
+    u->sq_ptr = mmap(NULL, u->sq_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     u->fd, IORING_OFF_SQ_RING);
+    if (u->sq_ptr == MAP_FAILED) {
+        perror("mmap SQ");
+        return -1;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        u->cq_ptr = u->sq_ptr;
+    } else {
+        u->cq_ptr = mmap(NULL, u->cq_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         u->fd, IORING_OFF_CQ_RING);
+        if (u->cq_ptr == MAP_FAILED) {
+            perror("mmap CQ");
+            return -1;
+        }
+    }
+    u->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqes_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   u->fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) {
+        perror("mmap SQEs");
+        return -1;
+    }
+    char *sq = u->sq_ptr, *cq = u->cq_ptr;
+    u->sq_head = (unsigned *)(sq + p.sq_off.head);
+    u->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    u->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    u->sq_array = (unsigned *)(sq + p.sq_off.array);
+    u->cq_head = (unsigned *)(cq + p.cq_off.head);
+    u->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    u->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    // Anel de buffers fornecidos para as leituras dos vizinhos
+    u->br_sz = REACTOR_URING_BUFS * sizeof(struct io_uring_buf);
+    u->br = mmap(NULL, u->br_sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    u->bufs = malloc((size_t)REACTOR_URING_BUFS * REACTOR_READ_SIZE);
+    if (u->br == MAP_FAILED || u->bufs == NULL) {
+        perror("io_uring buffers");
+        return -1;
+    }
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)u->br;
+    reg.ring_entries = REACTOR_URING_BUFS;
+    reg.bgid = REACTOR_URING_BGID;
+    if (syscall(__NR_io_uring_register, u->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        perror("io_uring_register PBUF_RING");
+        return -1;
+    }
+    u->br->tail = 0;
+    for (unsigned short i = 0; i < REACTOR_URING_BUFS; i++)
+        uring_recycle_buf(u, i);
+    u->free_send = -1;
+    return 0;
+}
+
+static inline uint32_t uring_poll_mask(uint32_t events) {
+    uint32_t mask = 0;
+    if (events & REACTOR_READ)
+        mask |= POLLIN | POLLRDHUP;
+    if (events & REACTOR_WRITE)
+        mask |= POLLOUT;
+    return mask;
+}
+
+static inline int reactor_backend_arm(Reactor *r, int fd, ReactorHandler *h) {
+    struct io_uring_sqe *sqe = uring_get_sqe(r);
+    if (sqe == NULL)
+        return -1;
+    sqe->fd = fd;
+    switch (h->kind) {
+    case REACTOR_KIND_LISTENER:
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        sqe->user_data = URING_UDATA(fd, URING_OP_ACCEPT, h->gen);
+        break;
+    case REACTOR_KIND_STREAM:
+        sqe->opcode = IORING_OP_RECV;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = REACTOR_URING_BGID;
+        sqe->user_data = URING_UDATA(fd, URING_OP_RECV, h->gen);
+        break;
+    default:
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->poll32_events = uring_poll_mask(h->events);
+        sqe->user_data = URING_UDATA(fd, URING_OP_POLL, h->gen);
+        break;
+    }
+    return 0;
+}
+
+static inline void reactor_backend_disarm(Reactor *r, int fd, ReactorHandler *h, int removing) {
+    int op = h->kind == REACTOR_KIND_LISTENER ? URING_OP_ACCEPT
+           : h->kind == REACTOR_KIND_STREAM ? URING_OP_RECV : URING_OP_POLL;
+    struct io_uring_sqe *sqe = uring_get_sqe(r);
+    if (sqe != NULL) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = URING_UDATA(fd, op, h->gen);
+        sqe->user_data = URING_UDATA(0, URING_OP_CANCEL, 0);
+    }
+    // Num rearme (reactor_mod) a nova operação usa outra geração, para que
+    // o CQE de cancelamento da antiga seja descartado
+    if (!removing)
+        h->gen++;
+    // Os envios já em fila têm de ser submetidos antes de o fd ser fechado
+    if (removing)
+        reactor_flush(r);
+}
+
+// Passa até REACTOR_OUT_IOV segmentos da frente da fila o para um envio
+// (IORING_OP_SENDMSG com MSG_WAITALL: não há envios parciais a retomar),
+// submetido na próxima espera do reactor. queued: o é a fila de um stream
+// e os bytes contam em ReactorOut.inflight até ao CQE.
+static inline int uring_send_out(Reactor *r, int fd, ReactorOut *o, int queued) {
+    ReactorUring *u = &r->ring;
+    if (u->free_send < 0) {
+        if (u->nsends == u->sends_cap) {
+            int cap = u->sends_cap ? u->sends_cap * 2 : 16;
+            ReactorSend **t = realloc(u->sends, (size_t)cap * sizeof(*t));
+            if (t == NULL)
+                return -1;
+            u->sends = t;
+            u->sends_cap = cap;
+        }
+        ReactorSend *s = malloc(sizeof(*s));
+        if (s == NULL)
+            return -1;
+        s->segs = NULL;
+        s->next_free = -1;
+        u->sends[u->nsends] = s;
+        u->free_send = u->nsends++;
+    }
+    struct io_uring_sqe *sqe = uring_get_sqe(r);
+    if (sqe == NULL)
+        return -1;
+    int slot = u->free_send;
+    ReactorSend *s = u->sends[slot];
+    u->free_send = s->next_free;
+
+    ReactorOutSeg *g = o->head, *last = NULL;
+    size_t len = 0;
+    int n = 0;
+    for (; g != NULL && n < REACTOR_OUT_IOV; last = g, g = g->next) {
+        s->iov[n].iov_base = (char *)g->data + g->start;
+        s->iov[n].iov_len = g->end - g->start;
+        len += s->iov[n++].iov_len;
+    }
+    s->segs = o->head;
+    last->next = NULL;
+    o->head = g;
+    if (g == NULL)
+        o->tail = NULL;
+    o->bytes -= len;
+    if (queued)
+        o->inflight += len;
+
+    memset(&s->msg, 0, sizeof(s->msg));
+    s->msg.msg_iov = s->iov;
+    s->msg.msg_iovlen = (size_t)n;
+    s->len = len;
+    s->fd = fd;
+    s->queued = queued;
+    s->gen = queued ? r->handlers[fd].gen : 0;
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)&s->msg;
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    sqe->user_data = URING_UDATA(slot, URING_OP_SEND, 0);
+    return 0;
+}
+
+// Fora de um stream os dados são copiados para blocos de saída, que
+// voltam às listas livres no CQE
+static inline ssize_t reactor_send_now(Reactor *r, int fd, const char *data, size_t len) {
+    ReactorOut o;
+    memset(&o, 0, sizeof(o));
+    if (reactor_out_append(r, &o, data, len) < 0) {
+        reactor_out_clear(r, &o);
+        return -1;
+    }
+    while (o.bytes > 0) {
+        if (uring_send_out(r, fd, &o, 0) < 0) {
+            reactor_out_clear(r, &o);
+            return -1;
+        }
+    }
+    return (ssize_t)len;
+}
+
+// A frente da fila do stream segue num envio, sem cópia. Só há um envio
+// em curso por stream, para os dados não trocarem de ordem; o CQE volta a
+// marcar o stream se entretanto entraram mais. final: o fd vai ser
+// fechado, segue já tudo o que está em fila.
+static inline void reactor_out_flush_fd(Reactor *r, int fd, ReactorHandler *h, int final) {
+    ReactorOut *o = &h->out;
+    if (o->inflight > 0 && !final)
+        return;
+    while (o->bytes > 0) {
+        r->stats.flushes++;
+        if (uring_send_out(r, fd, o, 1) < 0) {
+            perror("io_uring send");
+            reactor_out_clear(r, o);
+            return;
+        }
+        if (!final)
+            return;
+    }
+}
+
+static inline void uring_complete_send(Reactor *r, unsigned slot, int res) {
+    ReactorUring *u = &r->ring;
+    if (slot >= (unsigned)u->nsends)
+        return;
+    ReactorSend *s = u->sends[slot];
+    if (res < 0)
+        fprintf(stderr, "io_uring send fd %d: %s\n", s->fd, strerror(-res));
+    ReactorHandler *h = reactor_handler(r, s->fd);
+    if (s->queued && h != NULL && h->gen == s->gen) {
+        h->out.inflight -= h->out.inflight >= s->len ? s->len : h->out.inflight;
+        if (h->out.bytes > 0)
+            reactor_out_mark(r, s->fd, &h->out);
+    }
+    while (s->segs != NULL) {
+        ReactorOutSeg *g = s->segs;
+        s->segs = g->next;
+        reactor_out_release(r, g);
+    }
+    s->next_free = u->free_send;
+    u->free_send = (int)slot;
+}
+
+static inline void uring_handle_cqe(Reactor *r, uint64_t udata, int res, unsigned flags) {
+    int fd = (int)(udata & 0xffffffu);
+    int op = (int)((udata >> 24) & 0xff);
+    uint32_t gen = (uint32_t)(udata >> 32);
+    int buffered = (flags & IORING_CQE_F_BUFFER) != 0;
+    unsigned short bid = (unsigned short)(flags >> IORING_CQE_BUFFER_SHIFT);
+
+    if (op == URING_OP_SEND) {
+        uring_complete_send(r, (unsigned)fd, res);
+        return;
+    }
+    if (op == URING_OP_CANCEL)
+        return;
+
+    ReactorHandler *h = reactor_handler(r, fd);
+    if (h == NULL || h->gen != gen) {
+        // Evento de um registo já removido
+        if (op == URING_OP_ACCEPT && res >= 0)
+            close(res);
+        if (buffered)
+            uring_recycle_buf(&r->ring, bid);
+        return;
+    }
+    int rearm = !(flags & IORING_CQE_F_MORE);
+
+    switch (op) {
+    case URING_OP_POLL:
+        if (res >= 0) {
+            uint32_t ev = 0;
+            if (res & POLLIN)
+                ev |= REACTOR_READ;
+            if (res & POLLOUT)
+                ev |= REACTOR_WRITE;
+            if (res & (POLLHUP | POLLERR | POLLRDHUP))
+                ev |= REACTOR_HUP | REACTOR_READ;
+            h->cb(r, fd, ev, h->arg);
+        }
+        break;
+    case URING_OP_ACCEPT:
+        if (res >= 0) {
+            r->stats.accepts++;
+            h->accept_cb(r, fd, res, h->arg);
+        } else if (res != -EAGAIN && res != -ECANCELED) {
+            fprintf(stderr, "io_uring accept: %s\n", strerror(-res));
+        }
+        break;
+    case URING_OP_RECV:
+        if (res > 0 && buffered) {
+            r->stats.reads++;
+            h->data_cb(r, fd, r->ring.bufs + (size_t)bid * REACTOR_READ_SIZE, res, h->arg);
+        } else if (res == 0) {
+            rearm = 0;
+            h->data_cb(r, fd, NULL, 0, h->arg);
+        } else if (res == -ENOBUFS) {
+            // Todos os buffers estavam em uso; basta voltar a armar
+        } else if (res < 0 && res != -ECANCELED) {
+            rearm = 0;
+            errno = -res;
+            h->data_cb(r, fd, NULL, -1, h->arg);
+        }
+        if (buffered)
+            uring_recycle_buf(&r->ring, bid);
+        break;
+    }
+
+    // Operação multishot terminada: volta a armar se o registo se mantém
+    if (rearm) {
+        h = reactor_handler(r, fd);
+        if (h != NULL && h->gen == gen)
+            reactor_backend_arm(r, fd, h);
+    }
+}
+
+static inline int reactor_backend_wait(Reactor *r, int timeout_ms) {
+    ReactorUring *u = &r->ring;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+    }
+    unsigned head = *u->cq_head;
+    if (head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE) || u->to_submit > 0) {
+        // Uma única chamada submete todo o lote pendente e espera por eventos
+        unsigned min = head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE) ? 1 : 0;
+        int ret = uring_enter(r, u->to_submit, min,
+                              IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                              &arg, sizeof(arg));
+        if (ret < 0) {
+            if (errno == ETIME || errno == EINTR)
+                return 0;
+            if (errno != EBUSY && errno != EAGAIN) {
+                perror("io_uring_enter");
+                return -1;
+            }
+        } else {
+            u->to_submit -= (unsigned)ret;
+        }
+    }
+    int n = 0;
+    head = *u->cq_head;
+    while (head != __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe cqe = u->cqes[head & *u->cq_mask];
+        head++;
+        __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+        uring_handle_cqe(r, cqe.user_data, cqe.res, cqe.flags);
+        n++;
+    }
+    return n;
+}
+
+static inline void reactor_backend_destroy(Reactor *r) {
+    ReactorUring *u = &r->ring;
+    for (int i = 0; i < u->nsends; i++) {
+        ReactorSend *s = u->sends[i];
+        while (s->segs != NULL) {
+            ReactorOutSeg *g = s->segs;
+            s->segs = g->next;
+            reactor_out_release(r, g);
+        }
+        free(s);
+    }
+    free(u->sends);
+    if (u->fd >= 0)
+        close(u->fd);
+    if (u->sqes != NULL && u->sqes != MAP_FAILED)
+        munmap(u->sqes, u->sqes_sz);
+    if (u->cq_ptr != NULL && u->cq_ptr != MAP_FAILED && u->cq_ptr != u->sq_ptr)
+        munmap(u->cq_ptr, u->cq_sz);
+    if (u->sq_ptr != NULL && u->sq_ptr != MAP_FAILED)
+        munmap(u->sq_ptr, u->sq_sz);
+    if (u->br != NULL && u->br != MAP_FAILED)
+        munmap(u->br, u->br_sz);
+    free(u->bufs);
+}
+
+#elif defined(REACTOR_SELECT)
+/* ------------------------------- select ------------------------------- */
+
+static inline int reactor_flush(Reactor *r) {
+    (void)r;
+    return 0;
+}
+
+static inline int reactor_backend_init(Reactor *r) {
+    r->max_fd = -1;
+    return 0;
+}
+
+static inline int reactor_backend_arm(Reactor *r, int fd, ReactorHandler *h) {
+    (void)h;
+    if (fd >= FD_SETSIZE) {
+        fprintf(stderr, "select: descritor %d excede FD_SETSIZE\n", fd);
+        errno = EMFILE;
+        return -1;
+    }
+    if (fd > r->max_fd)
+        r->max_fd = fd;
+    return 0;
+}
+
+static inline void reactor_backend_disarm(Reactor *r, int fd, ReactorHandler *h, int removing) {
+    (void)r; (void)fd; (void)h; (void)removing;
+}
+
+static inline int reactor_backend_wait(Reactor *r, int timeout_ms) {
+    fd_set rfds, wfds;
+    FD_ZERO(&rfds);
+    FD_ZERO(&wfds);
+    int max_fd = -1;
+    for (int fd = 0; fd <= r->max_fd; fd++) {
+        ReactorHandler *h = reactor_handler(r, fd);
+        if (h == NULL)
+            continue;
+        if (h->events & REACTOR_READ)
+            FD_SET(fd, &rfds);
+        if (h->events & REACTOR_WRITE)
+            FD_SET(fd, &wfds);
+        max_fd = fd;
+    }
+    r->max_fd = max_fd;
+    struct timeval tv, *tvp = NULL;
+    if (timeout_ms >= 0) {
+        tv.tv_sec = timeout_ms / 1000;
+        tv.tv_usec = (timeout_ms % 1000) * 1000;
+        tvp = &tv;
+    }
+    r->stats.syscalls++;
+    int n = select(max_fd + 1, &rfds, &wfds, NULL, tvp);
+    if (n < 0) {
+        if (errno == EINTR)
+            return 0;
+        perror("select");
+        return -1;
+    }
+    uint32_t gens[FD_SETSIZE];
+    for (int fd = 0; fd <= max_fd; fd++)
+        gens[fd] = r->handlers[fd].gen;
+    int dispatched = 0;
+    for (int fd = 0; fd <= max_fd && dispatched < n; fd++) {
+        uint32_t ev = 0;
+        if (FD_ISSET(fd, &rfds))
+            ev |= REACTOR_READ;
+        if (FD_ISSET(fd, &wfds))
+            ev |= REACTOR_WRITE;
+        if (ev == 0)
+            continue;
+        dispatched++;
+        ReactorHandler *h = reactor_handler(r, fd);
+        if (h == NULL || h->gen != gens[fd])
+            continue;
+        reactor_dispatch(r, fd, h, ev);
+    }
+    return n;
+}
+
+static inline void reactor_backend_destroy(Reactor *r) {
+    (void)r;
+}
+
+#else
+/* -------------------------------- epoll -------------------------------- */
+
+static inline int reactor_flush(Reactor *r) {
+    (void)r;
+    return 0;
+}
+
+static inline uint32_t reactor_to_epoll(uint32_t events) {
+    uint32_t ev = 0;
+    if (events & REACTOR_READ)
+        ev |= EPOLLIN | EPOLLRDHUP;
+    if (events & REACTOR_WRITE)
+        ev |= EPOLLOUT;
+    if (events & REACTOR_ET)
+        ev |= EPOLLET;
+    return ev;
+}
+
+static inline int reactor_backend_init(Reactor *r) {
+    r->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (r->epfd < 0) {
+        perror("epoll_create1");
+        return -1;
+    }
+    return 0;
+}
+
+static inline int reactor_backend_arm(Reactor *r, int fd, ReactorHandler *h) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = reactor_to_epoll(h->events);
+    ev.data.u64 = ((uint64_t)h->gen << 32) | (uint32_t)fd;
+    r->stats.syscalls++;
+    int op = h->active ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(r->epfd, op, fd, &ev) < 0) {
+        perror("epoll_ctl");
+        return -1;
+    }
+    return 0;
+}
+
+static inline void reactor_backend_disarm(Reactor *r, int fd, ReactorHandler *h, int removing) {
+    (void)h;
+    // Em reactor_mod o registo mantém-se e é modificado no rearme (EPOLL_CTL_MOD)
+    if (!removing)
+        return;
+    r->stats.syscalls++;
+    epoll_ctl(r->epfd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+static inline int reactor_backend_wait(Reactor *r, int timeout_ms) {
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    r->stats.syscalls++;
+    int n = epoll_wait(r->epfd, events, REACTOR_MAX_EVENTS, timeout_ms);
+    if (n < 0) {
+        if (errno == EINTR)
+            return 0;
+        perror("epoll_wait");
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        int fd = (int)(uint32_t)events[i].data.u64;
+        uint32_t gen = (uint32_t)(events[i].data.u64 >> 32);
+        // O handler pode ter sido removido (ou o fd reutilizado) por um
+        // callback anterior nesta mesma iteração
+        ReactorHandler *h = reactor_handler(r, fd);
+        if (h == NULL || h->gen != gen)
+            continue;
+        uint32_t ev = 0;
+        if (events[i].events & EPOLLIN)
+            ev |= REACTOR_READ;
+        if (events[i].events & EPOLLOUT)
+            ev |= REACTOR_WRITE;
+        if (events[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP))
+            ev |= REACTOR_HUP | REACTOR_READ;
+        reactor_dispatch(r, fd, h, ev);
+    }
+    return n;
+}
+
+static inline void reactor_backend_destroy(Reactor *r) {
+    if (r->epfd >= 0)
+        close(r->epfd);
+}
+#endif
+
+#endif
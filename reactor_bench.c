@@ -0,0 +1,321 @@
+// reactor_bench.c
+//
+// Chamadas ao sistema por mensagem encaminhada, para comparar os backends
+// do reactor. O backend é o do ndn6 com que o programa é compilado:
+//
+//   gcc -O2 -o reactor_bench reactor_bench.c                          (epoll)
+//   gcc -O2 -DREACTOR_SELECT -o reactor_bench_select reactor_bench.c
+//   gcc -O2 -DREACTOR_IO_URING -o reactor_bench_uring reactor_bench.c
+//   ./reactor_bench [mensagens] [porta]
+//
+// Um nó ndn6 (o main do ndn6.c, num processo filho) tem dois vizinhos
+// internos falsos, A e B, que este programa simula: A envia INTEREST com
+// nomes sempre novos, o nó reencaminha-os para B, B responde OBJECT e o nó
+// devolve-os a A. Cada pedido conta como duas mensagens encaminhadas.
+// A envia os pedidos em janelas de 1, 8 e 64 (a seguinte só depois de
+// todas as respostas), para ver o efeito de várias mensagens por leitura.
+//
+// As chamadas ao sistema do nó são contadas por fora, com ptrace (como o
+// strace -c, que pode não estar instalado), e só durante cada janela de
+// medida; contam também as que a libc faz por ele (o printf para
+// /dev/null, por exemplo).
+
+#define main ndn6_main
+#include "ndn6.c"
+#undef main
+
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#define RB_MAX_NR 512
+
+static const int rbWindows[] = {1, 8, 64};
+#define RB_NWINDOWS ((int)(sizeof(rbWindows) / sizeof(rbWindows[0])))
+
+// Marcas de início e fim de medida, enviadas pelo processo dos vizinhos
+static volatile sig_atomic_t rbStart, rbStop;
+
+static void rb_signal(int sig) {
+    if (sig == SIGUSR1)
+        rbStart = 1;
+    else
+        rbStop = 1;
+}
+
+static const struct {
+    long nr;
+    const char *name;
+} rbNames[] = {
+    {SYS_read, "read"},
+    {SYS_write, "write"},
+    {SYS_readv, "readv"},
+    {SYS_writev, "writev"},
+    {SYS_recvfrom, "recvfrom"},
+    {SYS_sendto, "sendto"},
+    {SYS_recvmsg, "recvmsg"},
+    {SYS_sendmsg, "sendmsg"},
+    {SYS_poll, "poll"},
+    {SYS_ppoll, "ppoll"},
+    {SYS_pselect6, "pselect6"},
+#ifdef SYS_select
+    {SYS_select, "select"},
+#endif
+#ifdef SYS_epoll_wait
+    {SYS_epoll_wait, "epoll_wait"},
+#endif
+    {SYS_epoll_pwait, "epoll_pwait"},
+    {SYS_epoll_ctl, "epoll_ctl"},
+    {SYS_io_uring_enter, "io_uring_enter"},
+    {SYS_accept4, "accept4"},
+    {SYS_clock_gettime, "clock_gettime"},
+    {SYS_brk, "brk"},
+    {SYS_mmap, "mmap"},
+};
+
+static const char *rb_name(long nr) {
+    for (size_t i = 0; i < sizeof(rbNames) / sizeof(rbNames[0]); i++)
+        if (rbNames[i].nr == nr)
+            return rbNames[i].name;
+    return NULL;
+}
+
+// Imprime a medida de uma janela (e gasta os contadores)
+static void rb_report(int window, int requests, unsigned long *count) {
+    unsigned long total = 0;
+    for (int i = 0; i < RB_MAX_NR; i++)
+        total += count[i];
+    int msgs = 2 * requests;
+    printf("%-8s janela %2d: %5d mensagens, %6lu syscalls, %5.2f por mensagem:", REACTOR_BACKEND,
+           window, msgs, total, (double)total / msgs);
+    // As mais frequentes primeiro
+    unsigned long shown = 0;
+    for (int k = 0; k < 4; k++) {
+        int best = -1;
+        for (int i = 0; i < RB_MAX_NR; i++)
+            if (count[i] > 0 && (best < 0 || count[i] > count[best]))
+                best = i;
+        if (best < 0)
+            break;
+        const char *name = rb_name(best);
+        if (name != NULL)
+            printf(" %s %.2f", name, (double)count[best] / msgs);
+        else
+            printf(" #%d %.2f", best, (double)count[best] / msgs);
+        shown += count[best];
+        count[best] = 0;
+    }
+    if (total > shown)
+        printf(" outras %.2f", (double)(total - shown) / msgs);
+    printf("\n");
+    fflush(stdout);
+}
+
+static unsigned long rbCount[RB_MAX_NR];
+static int rbCounting, rbWindow;
+
+// Trata as marcas que chegaram. Tem de ser logo, e não só na paragem
+// seguinte do nó: parado no epoll_wait, o nó só volta a parar com o tráfego
+// da janela seguinte.
+static void rb_marks(int requests) {
+    if (rbStop) {
+        rbStop = 0;
+        rbCounting = 0;
+        if (rbWindow < RB_NWINDOWS)
+            rb_report(rbWindows[rbWindow++], requests, rbCount);
+    }
+    if (rbStart) {
+        rbStart = 0;
+        memset(rbCount, 0, sizeof(rbCount));
+        rbCounting = 1;
+    }
+}
+
+// Segue o nó até ele terminar, contando as entradas em chamadas ao sistema
+// entre cada SIGUSR1 e SIGUSR2
+static int rb_trace(pid_t node, int requests) {
+    int status;
+    if (waitpid(node, &status, 0) < 0 || !WIFSTOPPED(status)) {
+        fprintf(stderr, "O nó não parou à espera do ptrace\n");
+        return -1;
+    }
+    ptrace(PTRACE_SETOPTIONS, node, 0, PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL);
+    int sig = 0;
+    for (;;) {
+        rb_marks(requests);
+        if (ptrace(PTRACE_SYSCALL, node, 0, sig) < 0) {
+            perror("ptrace");
+            return -1;
+        }
+        sig = 0;
+        while (waitpid(node, &status, 0) < 0) {
+            if (errno != EINTR)
+                return -1;
+            rb_marks(requests);
+        }
+        if (WIFEXITED(status) || WIFSIGNALED(status))
+            return rbWindow == RB_NWINDOWS ? 0 : -1;
+        if (!WIFSTOPPED(status))
+            continue;
+        if (WSTOPSIG(status) != (SIGTRAP | 0x80)) {
+            sig = WSTOPSIG(status);   // sinal para o nó: entrega-o
+            continue;
+        }
+        struct __ptrace_syscall_info info;
+        if (rbCounting &&
+            ptrace(PTRACE_GET_SYSCALL_INFO, node, sizeof(info), &info) > 0 &&
+            info.op == PTRACE_SYSCALL_INFO_ENTRY && info.entry.nr < RB_MAX_NR)
+            rbCount[info.entry.nr]++;
+    }
+}
+
+// Vizinho falso: uma ligação ao nó e as linhas recebidas
+typedef struct {
+    int fd;
+    char buf[8192];
+    size_t len;
+} RbPeer;
+
+static void rb_connect(RbPeer *p, int port, int myport) {
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)port);
+    for (int tries = 0;; tries++) {
+        p->fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(p->fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+            break;
+        close(p->fd);
+        if (tries == 200) {
+            perror("ligação ao nó");
+            exit(EXIT_FAILURE);
+        }
+        usleep(10000);
+    }
+    int one = 1;
+    setsockopt(p->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    p->len = 0;
+    char line[64];
+    int n = snprintf(line, sizeof(line), "ENTRY 127.0.0.1 %d\n", myport);
+    if (write(p->fd, line, (size_t)n) != n)
+        exit(EXIT_FAILURE);
+}
+
+// Lê até ter count linhas que começam por prefix; se reply, responde a
+// cada uma (B: INTEREST nome -> OBJECT nome) num só envio no fim
+static void rb_expect(RbPeer *p, const char *prefix, int count, int reply) {
+    static char out[64 * 1024];
+    size_t olen = 0, plen = strlen(prefix);
+    while (count > 0) {
+        char *nl;
+        while (count > 0 && (nl = memchr(p->buf, '\n', p->len)) != NULL) {
+            size_t l = (size_t)(nl - p->buf) + 1;
+            if (l > plen && memcmp(p->buf, prefix, plen) == 0) {
+                count--;
+                if (reply) {
+                    const char *name = p->buf + plen;
+                    const char *end = memchr(name, ' ', (size_t)(nl - name));
+                    if (end == NULL)
+                        end = nl;
+                    olen += (size_t)snprintf(out + olen, sizeof(out) - olen, "OBJECT %.*s\n",
+                                             (int)(end - name), name);
+                }
+            }
+            memmove(p->buf, p->buf + l, p->len - l);
+            p->len -= l;
+        }
+        if (count == 0)
+            break;
+        ssize_t n = read(p->fd, p->buf + p->len, sizeof(p->buf) - p->len);
+        if (n <= 0) {
+            fprintf(stderr, "O nó fechou a ligação\n");
+            exit(EXIT_FAILURE);
+        }
+        p->len += (size_t)n;
+    }
+    if (olen > 0 && write(p->fd, out, olen) != (ssize_t)olen)
+        exit(EXIT_FAILURE);
+}
+
+// Os dois vizinhos: aquecimento e depois uma medida por tamanho de janela
+static void rb_peers(int port, int requests, int nodeIn) {
+    static char out[64 * 1024];
+    RbPeer a, b;
+    rb_connect(&a, port, port + 1);
+    rb_connect(&b, port, port + 2);
+    usleep(200000);
+    unsigned seq = 0;
+    for (int w = -1; w < RB_NWINDOWS; w++) {
+        int window = w < 0 ? 8 : rbWindows[w];
+        int total = w < 0 ? 512 : requests;
+        if (w >= 0) {
+            kill(getppid(), SIGUSR1);
+            usleep(50000);
+        }
+        for (int done = 0; done < total; done += window) {
+            int k = window < total - done ? window : total - done;
+            size_t olen = 0;
+            for (int i = 0; i < k; i++, seq++)
+                olen += (size_t)snprintf(out + olen, sizeof(out) - olen, "INTEREST m%u %08x\n",
+                                         seq, seq * 2654435761u | 1);
+            if (write(a.fd, out, olen) != (ssize_t)olen)
+                exit(EXIT_FAILURE);
+            rb_expect(&b, "INTEREST ", k, 1);
+            rb_expect(&a, "OBJECT ", k, 0);
+        }
+        if (w >= 0) {
+            usleep(50000);
+            kill(getppid(), SIGUSR2);
+            usleep(50000);
+        }
+    }
+    if (write(nodeIn, "x\n", 2) != 2)
+        exit(EXIT_FAILURE);
+    exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char *argv[]) {
+    int requests = argc > 1 ? atoi(argv[1]) : 2000;
+    int port = argc > 2 ? atoi(argv[2]) : 46000;
+    if (requests <= 0 || port <= 0 || port > 65000) {
+        fprintf(stderr, "Uso: %s [pedidos] [porta]\n", argv[0]);
+        return 2;
+    }
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = rb_signal;
+    sigaction(SIGUSR1, &sa, NULL);
+    sigaction(SIGUSR2, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    fflush(stdout);
+
+    int in[2];
+    if (pipe(in) < 0) {
+        perror("pipe");
+        return 2;
+    }
+    pid_t node = fork();
+    if (node == 0) {
+        char tcp[12];
+        snprintf(tcp, sizeof(tcp), "%d", port);
+        char *args[] = {"ndn6", "0", "127.0.0.1", tcp, "127.0.0.1", "9", NULL};
+        int null = open("/dev/null", O_WRONLY);
+        dup2(in[0], STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        close(in[0]);
+        close(in[1]);
+        ptrace(PTRACE_TRACEME, 0, 0, 0);
+        raise(SIGSTOP);
+        exit(ndn6_main(6, args));
+    }
+    close(in[0]);
+    pid_t peers = fork();
+    if (peers == 0)
+        rb_peers(port, requests, in[1]);
+    int rc = rb_trace(node, requests);
+    int status;
+    waitpid(peers, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        rc = -1;
+    return rc < 0 ? 1 : 0;
+}
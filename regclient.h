@@ -0,0 +1,263 @@
+#ifndef REGCLIENT_H
+#define REGCLIENT_H
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include "proto.h"
+#include "timer.h"
+
+/*
+ * Cliente assíncrono do servidor de registo (UDP).
+ *
+ * Cada pedido REG / UNREG / NODES fica numa tabela de pedidos pendentes até
+ * chegar a resposta correspondente ou se esgotarem as tentativas. Um pedido
+ * sem resposta é retransmitido com recuo exponencial (rto inicial, dobrado a
+ * cada tentativa até rto_max). Vários pedidos podem estar em curso ao mesmo
+ * tempo; um pedido igual a outro ainda pendente (mesma operação e rede) não
+ * é enviado de novo, é associado ao existente.
+ *
+ * Nada bloqueia: o socket UDP é registado no reactor do programa e cada
+ * datagrama recebido é passado a regclient_handle(). Cada pedido tem um
+ * temporizador na roda dada a regclient_init() (a do reactor), que dispara
+ * a retransmissão ou a desistência.
+ *
+ * Correspondência das respostas:
+ *   OKREG            pedido REG pendente mais antigo
+ *   OKUNREG          pedido UNREG pendente mais antigo
+ *   NODESLIST net    pedido NODES da rede net
+ * (OKREG e OKUNREG não indicam a rede, por isso é usada a ordem de envio.)
+ */
+
+#define REGCLIENT_MAX       16    // pedidos em curso em simultâneo
+#define REGCLIENT_MSG       128
+#define REGCLIENT_RTO_MS    500   // primeiro tempo de retransmissão
+#define REGCLIENT_RTO_MAX   4000
+#define REGCLIENT_TRIES     5     // envios antes de desistir
+
+typedef enum { REG_OP_REG, REG_OP_UNREG, REG_OP_NODES } RegOp;
+
+typedef struct RegClient RegClient;
+typedef struct RegRequest RegRequest;
+
+// Resultado de um pedido: reply é o datagrama recebido (terminado em '\0'),
+// ou NULL se o servidor não respondeu após todas as tentativas
+typedef void (*regclient_cb)(RegClient *rc, const RegRequest *req, const char *reply, void *arg);
+
+struct RegRequest {
+    int in_use;
+    RegOp op;
+    char net[16];
+    char msg[REGCLIENT_MSG];
+    size_t len;
+    int tries;               // envios feitos
+    int rto;                 // tempo de espera atual (ms)
+    long long first_sent;    // instante do primeiro envio (latência)
+    Timer timer;             // próxima retransmissão
+    RegClient *owner;
+    unsigned long seq;       // ordem de envio, para OKREG/OKUNREG
+    regclient_cb cb;
+    void *arg;
+};
+
+// Contadores para medir a latência e as perdas
+typedef struct {
+    unsigned long requests;
+    unsigned long sends;          // inclui retransmissões
+    unsigned long retransmits;
+    unsigned long replies;
+    unsigned long failures;       // pedidos sem resposta
+    unsigned long stray;          // respostas sem pedido (duplicadas, atrasadas)
+    long long latency_total;      // soma das latências dos pedidos respondidos (ms)
+    long long latency_max;
+} RegClientStats;
+
+struct RegClient {
+    int fd;
+    TimerWheel *timers;
+    struct sockaddr_storage server;
+    socklen_t server_len;
+    RegRequest reqs[REGCLIENT_MAX];
+    unsigned long next_seq;
+    int rto_initial;
+    int rto_max;
+    int max_tries;
+    RegClientStats stats;
+};
+
+static inline long long regclient_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static inline const char *regclient_op_name(RegOp op) {
+    switch (op) {
+    case REG_OP_REG: return "REG";
+    case REG_OP_UNREG: return "UNREG";
+    default: return "NODES";
+    }
+}
+
+// fd deve ser um socket UDP não bloqueante; addr é o servidor de registo;
+// timers é a roda onde ficam os prazos de retransmissão
+static inline void regclient_init(RegClient *rc, int fd, const struct sockaddr *addr, socklen_t len,
+                                  TimerWheel *timers) {
+    memset(rc, 0, sizeof(*rc));
+    rc->fd = fd;
+    rc->timers = timers;
+    memcpy(&rc->server, addr, len);
+    rc->server_len = len;
+    rc->rto_initial = REGCLIENT_RTO_MS;
+    rc->rto_max = REGCLIENT_RTO_MAX;
+    rc->max_tries = REGCLIENT_TRIES;
+}
+
+// Envia (ou reenvia) o pedido e programa a próxima retransmissão.
+// Uma falha do sendto conta como perda: o temporizador trata de repetir.
+static inline void regclient_transmit(RegClient *rc, RegRequest *q) {
+    long long now = regclient_now_ms();
+    if (q->tries == 0) {
+        q->first_sent = now;
+        q->rto = rc->rto_initial;
+    } else {
+        rc->stats.retransmits++;
+        q->rto = q->rto * 2 > rc->rto_max ? rc->rto_max : q->rto * 2;
+    }
+    q->tries++;
+    timer_arm(rc->timers, &q->timer, now + q->rto);
+    rc->stats.sends++;
+    if (sendto(rc->fd, q->msg, q->len, 0, (struct sockaddr *)&rc->server, rc->server_len) < 0)
+        perror("regclient: sendto");
+}
+
+static inline void regclient_finish(RegClient *rc, RegRequest *q, const char *reply) {
+    timer_cancel(&q->timer);
+    RegRequest done = *q;
+    q->in_use = 0;  // libertado antes do callback, que pode fazer novos pedidos
+    if (done.cb)
+        done.cb(rc, &done, reply, done.arg);
+}
+
+// Prazo do pedido: retransmite, ou desiste se esgotou as tentativas
+static inline void regclient_expired(void *arg) {
+    RegRequest *q = arg;
+    RegClient *rc = q->owner;
+    if (q->tries >= rc->max_tries) {
+        rc->stats.failures++;
+        printf("%s %s: servidor de registo não respondeu após %d envios\n",
+               regclient_op_name(q->op), q->net, q->tries);
+        regclient_finish(rc, q, NULL);
+        return;
+    }
+    printf("%s %s: sem resposta em %d ms, a retransmitir\n",
+           regclient_op_name(q->op), q->net, q->rto);
+    regclient_transmit(rc, q);
+}
+
+/*
+ * Novo pedido. ip/tcp só são usados em REG e UNREG.
+ * Devolve 0, ou -1 se a tabela de pedidos estiver cheia.
+ */
+static inline int regclient_send(RegClient *rc, RegOp op, const char *net, const char *ip,
+                                 const char *tcp, regclient_cb cb, void *arg) {
+    RegRequest *q = NULL;
+    for (int i = 0; i < REGCLIENT_MAX; i++) {
+        RegRequest *p = &rc->reqs[i];
+        if (p->in_use && p->op == op && strcmp(p->net, net) == 0) {
+            // Pedido igual já em curso: fica com o novo callback
+            p->cb = cb;
+            p->arg = arg;
+            return 0;
+        }
+        if (!p->in_use && q == NULL)
+            q = p;
+    }
+    if (q == NULL) {
+        fprintf(stderr, "regclient: demasiados pedidos pendentes\n");
+        return -1;
+    }
+    memset(q, 0, sizeof(*q));
+    timer_init(&q->timer, regclient_expired, q);
+    q->owner = rc;
+    q->in_use = 1;
+    q->op = op;
+    snprintf(q->net, sizeof(q->net), "%s", net);
+    if (op == REG_OP_NODES)
+        snprintf(q->msg, sizeof(q->msg), "NODES %s", net);
+    else
+        snprintf(q->msg, sizeof(q->msg), "%s %s %s %s", regclient_op_name(op), net, ip, tcp);
+    q->len = strlen(q->msg);
+    q->seq = rc->next_seq++;
+    q->cb = cb;
+    q->arg = arg;
+    rc->stats.requests++;
+    regclient_transmit(rc, q);
+    return 0;
+}
+
+static inline int regclient_pending(const RegClient *rc) {
+    int n = 0;
+    for (int i = 0; i < REGCLIENT_MAX; i++)
+        n += rc->reqs[i].in_use;
+    return n;
+}
+
+// Pedido pendente mais antigo com a operação op (e rede net, se não for NULL)
+static inline RegRequest *regclient_match(RegClient *rc, RegOp op, const char *net) {
+    RegRequest *best = NULL;
+    for (int i = 0; i < REGCLIENT_MAX; i++) {
+        RegRequest *p = &rc->reqs[i];
+        if (!p->in_use || p->op != op || (net && strcmp(p->net, net) != 0))
+            continue;
+        if (best == NULL || p->seq < best->seq)
+            best = p;
+    }
+    return best;
+}
+
+/*
+ * Datagrama recebido do servidor (terminado em '\0').
+ * Devolve 1 se correspondeu a um pedido pendente, 0 caso contrário.
+ */
+static inline int regclient_handle(RegClient *rc, const char *msg) {
+    RegRequest *q = NULL;
+    ProtoMsg m;
+    const char *nl = strchr(msg, '\n');
+    char net[16];
+    if (proto_parse(msg, nl ? (size_t)(nl - msg) : strlen(msg), &m) == PROTO_OK) {
+        if (m.type == MSG_OKREG)
+            q = regclient_match(rc, REG_OP_REG, NULL);
+        else if (m.type == MSG_OKUNREG)
+            q = regclient_match(rc, REG_OP_UNREG, NULL);
+        else if (m.type == MSG_NODESLIST && sv_copy(net, sizeof(net), m.net) == 0)
+            q = regclient_match(rc, REG_OP_NODES, net);
+    }
+    if (q == NULL) {
+        rc->stats.stray++;
+        return 0;
+    }
+    long long latency = regclient_now_ms() - q->first_sent;
+    rc->stats.replies++;
+    rc->stats.latency_total += latency;
+    if (latency > rc->stats.latency_max)
+        rc->stats.latency_max = latency;
+    printf("%s %s respondido em %lld ms (%d envio%s)\n", regclient_op_name(q->op), q->net,
+           latency, q->tries, q->tries == 1 ? "" : "s");
+    regclient_finish(rc, q, msg);
+    return 1;
+}
+
+static inline void regclient_print_stats(const RegClient *rc) {
+    const RegClientStats *s = &rc->stats;
+    printf("Servidor de registo: %lu pedidos, %lu envios (%lu retransmissões), %lu respostas, "
+           "%lu falhas, %lu respostas descartadas, latência média %lld ms, máxima %lld ms\n",
+           s->requests, s->sends, s->retransmits, s->replies, s->failures, s->stray,
+           s->replies ? s->latency_total / (long long)s->replies : 0LL, s->latency_max);
+}
+
+#endif
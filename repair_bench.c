@@ -0,0 +1,129 @@
+// repair_bench.c
+//
+// Retrieves perdidos e tempo de reparação quando um nó da árvore falha:
+//
+//   gcc -O2 -o repair_bench repair_bench.c
+//   ./repair_bench [nós] [porta base]
+//
+// Uma árvore binária de 15 nós (por omissão), sem cache, com o objeto numa
+// folha (o último nó). Em cada rede nova, uma ronda de retrieves (todos os
+// nós exceto a vítima e o produtor, um de cada vez) aprende as rotas; depois
+// a vítima falha de uma de três maneiras:
+//
+//   kill    SIGKILL: os vizinhos veem o EOF
+//   stop    SIGSTOP com -h 100 -m 3: só os batimentos em falta a revelam
+//   leave   comando "l": LEAVE aos vizinhos e saída da rede
+//
+// e seguem duas rondas durante a falha e a reparação e, 2 s depois, uma
+// ronda com a árvore já reparada. As vítimas são um nó interior no caminho
+// para o objeto (o 2) e as duas âncoras (o 0 e o 1, externos um do outro).
+// Mostra os retrieves com e sem objeto em cada fase (durante a falha, o
+// segundo retrieve de um nó pode ser agregado ao primeiro, ainda pendente,
+// e os dois têm uma só resposta), o número de linhas "Topologia reparada
+// em N ms" e o maior N (da perda do externo ao novo externo). Termina com
+// 1 se algum retrieve depois da reparação não encontrou o objeto.
+
+#define main ndn6_main
+#include "ndn6.c"
+#undef main
+
+#include "simnet.h"
+
+#define RP_GAP_MS 10   // entre retrieves
+
+typedef struct {
+    const char *name;
+    char *opts[5];
+} RpMode;
+
+static RpMode rpModes[] = {
+    {"kill", {NULL}},
+    {"stop", {"-h", "100", "-m", "3", NULL}},
+    {"leave", {NULL}},
+};
+
+static const int rpVictims[] = {2, 0, 1};
+
+// Um retrieve em cada nó que não é a vítima nem o produtor
+static void rp_round(int n, int victim) {
+    for (int i = 0; i < n - 1; i++) {
+        if (i == victim)
+            continue;
+        sim_cmd(i, "r obj");
+        sim_sleep_ms(RP_GAP_MS);
+    }
+}
+
+// Maior N de "Topologia reparada em N ms"
+static void rp_repaired(const char *line, void *arg) {
+    long long *max = arg, ms;
+    const char *p = strstr(line, "reparada em ");
+    if (p != NULL && sscanf(p + strlen("reparada em "), "%lld", &ms) == 1 && ms > *max)
+        *max = ms;
+}
+
+// Corre uma falha; devolve o número de retrieves sem objeto depois da
+// reparação
+static int rp_run(const RpMode *mode, int victim, int n, int base) {
+    sim_registry(base);
+    for (int i = 0; i < n; i++)
+        sim_spawn(i, base + 1 + i, base, "0", mode->opts, NULL);
+    if (sim_started(n) < 0)
+        exit(2);
+    sim_tree(n, base);
+    sim_cmd(n - 1, "c obj");
+    sim_sleep_ms(300);
+    rp_round(n, victim);
+    sim_sleep_ms(300);
+
+    off_t m0[SIM_MAX_NODES], m1[SIM_MAX_NODES], m2[SIM_MAX_NODES];
+    int per = n - 2;   // retrieves por ronda
+    sim_mark_all(n, m0);
+    if (strcmp(mode->name, "kill") == 0)
+        sim_kill(victim, SIGKILL);
+    else if (strcmp(mode->name, "stop") == 0)
+        sim_kill(victim, SIGSTOP);
+    else
+        sim_cmd(victim, "l");
+    rp_round(n, victim);
+    rp_round(n, victim);
+    sim_sleep_ms(2000);
+    sim_mark_all(n, m1);
+    rp_round(n, victim);
+    sim_sleep_ms(1000);
+    sim_mark_all(n, m2);
+
+    int found1 = sim_count_all(n, m0, m1, "Objeto obj encontrado");
+    int miss1 = sim_count_all(n, m0, m1, "Objeto obj não encontrado");
+    int aggr1 = sim_count_all(n, m0, m1, "Interesse em obj agregado ao pendente");
+    int found2 = sim_count_all(n, m1, m2, "Objeto obj encontrado");
+    int miss2 = sim_count_all(n, m1, m2, "Objeto obj não encontrado");
+    long long worst = -1;
+    int repairs = 0;
+    for (int i = 0; i < n; i++)
+        repairs += sim_lines(i, m0[i], m2[i], "Topologia reparada em", rp_repaired, &worst);
+    printf("%6d  %5d %5d %5d  %5d %5d  %10d %7lld  %s\n", victim, found1, miss1, aggr1, found2,
+           miss2, repairs, worst, mode->name);
+    sim_stop(n);
+    return per - found2;
+}
+
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 15;
+    int base = argc > 2 ? atoi(argv[2]) : 49000;
+    int nmodes = (int)(sizeof(rpModes) / sizeof(rpModes[0]));
+    int nvictims = (int)(sizeof(rpVictims) / sizeof(rpVictims[0]));
+    if (n < 7 || n > SIM_MAX_NODES || base <= 0 || base + nmodes * nvictims * 100 > 65535) {
+        fprintf(stderr, "Uso: %s [nós (7..%d)] [porta base]\n", argv[0], SIM_MAX_NODES);
+        return 2;
+    }
+    printf("%d nós em árvore binária, cache 0, objeto no nó %d, %d retrieves por ronda\n", n,
+           n - 1, n - 2);
+    printf("        durante (%d)         depois (%d)\n", 2 * (n - 2), n - 2);
+    printf("vítima    com   sem  agreg    com   sem  reparações  máx ms  falha\n");
+    int missed = 0;
+    for (int m = 0; m < nmodes; m++)
+        for (int v = 0; v < nvictims; v++)
+            missed += rp_run(&rpModes[m], rpVictims[v], n, base + (m * nvictims + v) * 100);
+    return missed > 0;
+}
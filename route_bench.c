@@ -0,0 +1,98 @@
+// route_bench.c
+//
+// Mensagens INTEREST por retrieve numa árvore de nós ndn6 no loopback:
+//
+//   gcc -O2 -o route_bench route_bench.c
+//   ./route_bench [nós] [rondas] [porta base]
+//
+// Uma árvore binária de 50 nós (por omissão), sem cache, com um objeto numa
+// folha (o último nó). Em cada ronda cada um dos outros nós faz um retrieve
+// do objeto, um de cada vez. Conta-se, por ronda, o número de INTEREST
+// recebidos em todos os nós a dividir pelo número de retrieves, em quatro
+// configurações, cada uma numa rede nova:
+//
+//   inundação       -r 0 -b 0 -n 0: sem rotas, resumos nem cache negativa
+//   rotas           -b 0 -n 0: rotas aprendidas pelos OBJECT (fib.h)
+//   cache negativa  -r 0 -b 0: um ramo que já respondeu NOOBJECT a uma
+//                   interface não volta a ser inundado a partir dela
+//   tudo            rotas, cache negativa e resumos (por omissão)
+//
+// Com a inundação cada retrieve chega a todos os nós; com as rotas só o
+// primeiro pedido de cada ramo inunda e os seguintes seguem o caminho até
+// ao produtor. Termina com 1 se algum retrieve não encontrou o objeto.
+
+#define main ndn6_main
+#include "ndn6.c"
+#undef main
+
+#include "simnet.h"
+
+#define RB_GAP_MS 50   // entre retrieves: cada um acaba antes do seguinte
+
+typedef struct {
+    const char *name;
+    char *opts[7];
+} RbMode;
+
+static RbMode rbModes[] = {
+    {"inundação", {"-r", "0", "-b", "0", "-n", "0", NULL}},
+    {"rotas", {"-b", "0", "-n", "0", NULL}},
+    {"cache negativa", {"-r", "0", "-b", "0", NULL}},
+    {"tudo", {NULL}},
+};
+
+// Corre uma configuração; devolve o número de retrieves sem objeto
+static int rb_run(const RbMode *mode, int n, int rounds, int base) {
+    sim_registry(base);
+    for (int i = 0; i < n; i++)
+        sim_spawn(i, base + 1 + i, base, "0", mode->opts, NULL);
+    if (sim_started(n) < 0)
+        exit(2);
+    sim_tree(n, base);
+    sim_cmd(n - 1, "c obj");
+    sim_sleep_ms(300);
+
+    off_t before[SIM_MAX_NODES], after[SIM_MAX_NODES];
+    int missed = 0;
+    double steady = 0;
+    for (int r = 0; r < rounds; r++) {
+        sim_mark_all(n, before);
+        for (int i = 0; i < n - 1; i++) {
+            sim_cmd(i, "r obj");
+            sim_sleep_ms(RB_GAP_MS);
+        }
+        sim_sleep_ms(500);
+        sim_mark_all(n, after);
+        int sent = sim_count_all(n, before, after, "Mensagem TCP recebida: INTEREST");
+        int found = sim_count_all(n, before, after, "Objeto obj encontrado");
+        double per = (double)sent / (n - 1);
+        printf("%s%6.2f", r > 0 ? "  " : "", per);
+        if (r > 0)
+            steady += per;
+        missed += (n - 1) - found;
+    }
+    if (rounds > 1)
+        printf("  | %6.2f", steady / (rounds - 1));
+    printf("  | %d sem objeto  %s\n", missed, mode->name);
+    sim_stop(n);
+    return missed;
+}
+
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 50;
+    int rounds = argc > 2 ? atoi(argv[2]) : 3;
+    int base = argc > 3 ? atoi(argv[3]) : 48000;
+    int nmodes = (int)(sizeof(rbModes) / sizeof(rbModes[0]));
+    if (n < 2 || n > SIM_MAX_NODES || rounds < 1 || base <= 0 ||
+        base + nmodes * 100 > 65535) {
+        fprintf(stderr, "Uso: %s [nós (2..%d)] [rondas] [porta base]\n", argv[0], SIM_MAX_NODES);
+        return 2;
+    }
+    printf("%d nós em árvore binária, cache 0, objeto no nó %d, %d retrieves por ronda\n", n,
+           n - 1, n - 1);
+    printf("INTEREST por retrieve em cada ronda  | média depois da primeira | retrieves sem objeto\n");
+    int missed = 0;
+    for (int m = 0; m < nmodes; m++)
+        missed += rb_run(&rbModes[m], n, rounds, base + m * 100);
+    return missed > 0;
+}
@@ -0,0 +1,282 @@
+#ifndef SIMNET_H
+#define SIMNET_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+/*
+ * Rede de nós ndn6 no loopback para os programas de medida e de teste.
+ *
+ * O programa inclui o ndn6.c com o main renomeado e depois este ficheiro:
+ *
+ *   #define main ndn6_main
+ *   #include "ndn6.c"
+ *   #undef main
+ *   #include "simnet.h"
+ *
+ * sim_registry() lança um servidor de registo mínimo (REG, UNREG e NODES)
+ * e sim_spawn() cada nó, num processo filho com o main do ndn6. O stdin do
+ * nó é um pipe (sim_cmd escreve-lhe comandos) e o stdout e o stderr vão,
+ * com buffer de linha, para um ficheiro temporário. O pai só lê esse
+ * ficheiro com pread, sem mexer na posição de escrita do filho: sim_mark()
+ * dá o tamanho atual e sim_lines() percorre as linhas entre duas marcas,
+ * o que permite contar o que cada nó escreveu em cada fase da medida.
+ */
+
+#define SIM_MAX_NODES 64
+
+typedef struct {
+    pid_t pid;
+    int in;       // stdin do nó
+    FILE *log;    // stdout e stderr do nó
+    int alive;
+} SimNode;
+
+static SimNode simNodes[SIM_MAX_NODES];
+static pid_t simRegistry;
+
+static inline void sim_sleep_ms(long ms) {
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+        ;
+}
+
+typedef struct {
+    char net[8], ip[INET_ADDRSTRLEN], port[8];
+} SimRegEntry;
+
+static inline void sim_registry_loop(int port) {
+    static SimRegEntry reg[SIM_MAX_NODES];
+    int nreg = 0;
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)port);
+    if (sock < 0 || bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("servidor de registo");
+        _exit(EXIT_FAILURE);
+    }
+    for (;;) {
+        char buf[512], out[4096], cmd[16];
+        SimRegEntry e;
+        struct sockaddr_in from;
+        socklen_t fromlen = sizeof(from);
+        ssize_t n = recvfrom(sock, buf, sizeof(buf) - 1, 0, (struct sockaddr *)&from, &fromlen);
+        if (n <= 0)
+            continue;
+        buf[n] = '\0';
+        int k = sscanf(buf, "%15s %7s %15s %7s", cmd, e.net, e.ip, e.port);
+        int len = 0;
+        if (k == 4 && strcmp(cmd, "REG") == 0) {
+            if (nreg < SIM_MAX_NODES)
+                reg[nreg++] = e;
+            len = snprintf(out, sizeof(out), "OKREG");
+        } else if (k == 4 && strcmp(cmd, "UNREG") == 0) {
+            for (int i = 0; i < nreg; i++)
+                if (strcmp(reg[i].ip, e.ip) == 0 && strcmp(reg[i].port, e.port) == 0)
+                    reg[i--] = reg[--nreg];
+            len = snprintf(out, sizeof(out), "OKUNREG");
+        } else if (k == 2 && strcmp(cmd, "NODES") == 0) {
+            len = snprintf(out, sizeof(out), "NODESLIST %s\n", e.net);
+            for (int i = 0; i < nreg && len < (int)sizeof(out) - 32; i++)
+                if (strcmp(reg[i].net, e.net) == 0)
+                    len += snprintf(out + len, sizeof(out) - (size_t)len, "%s %s\n", reg[i].ip,
+                                    reg[i].port);
+        } else {
+            continue;
+        }
+        sendto(sock, out, (size_t)len, 0, (struct sockaddr *)&from, fromlen);
+    }
+}
+
+// Servidor de registo num processo filho, no porto UDP port do loopback
+static inline void sim_registry(int port) {
+    signal(SIGPIPE, SIG_IGN);
+    fflush(stdout);
+    simRegistry = fork();
+    if (simRegistry < 0) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (simRegistry == 0)
+        sim_registry_loop(port);
+    sim_sleep_ms(200);
+}
+
+// Nó i no porto TCP port, registado em regport, com a cache dada e as
+// opções extra (lista terminada em NULL, pode ser NULL). setup (se não for
+// NULL) corre no filho antes do main do ndn6.
+static inline void sim_spawn(int i, int port, int regport, const char *cache,
+                             char *const extra[], void (*setup)(int i)) {
+    int fds[2];
+    FILE *log = tmpfile();
+    if (log == NULL || pipe(fds) < 0) {
+        perror("nó");
+        exit(EXIT_FAILURE);
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        char tcp[12], udp[12];
+        char *argv[32] = {"ndn6", (char *)cache, "127.0.0.1", tcp, "127.0.0.1", udp};
+        int argc = 6;
+        snprintf(tcp, sizeof(tcp), "%d", port);
+        snprintf(udp, sizeof(udp), "%d", regport);
+        for (int k = 0; extra != NULL && extra[k] != NULL && argc < 31; k++)
+            argv[argc++] = extra[k];
+        argv[argc] = NULL;
+        dup2(fds[0], STDIN_FILENO);
+        dup2(fileno(log), STDOUT_FILENO);
+        dup2(fileno(log), STDERR_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        setvbuf(stdout, NULL, _IOLBF, 0);
+        if (setup != NULL)
+            setup(i);
+        exit(ndn6_main(argc, argv));
+    }
+    close(fds[0]);
+    simNodes[i].pid = pid;
+    simNodes[i].in = fds[1];
+    simNodes[i].log = log;
+    simNodes[i].alive = 1;
+}
+
+// 0 se todos os processos arrancaram; senão termina-os e devolve -1
+static inline int sim_started(int n) {
+    sim_sleep_ms(300);
+    if (waitpid(-1, NULL, WNOHANG) <= 0)
+        return 0;
+    fprintf(stderr, "Um dos processos terminou ao arrancar; experimente outra porta base\n");
+    for (int i = 0; i < n; i++)
+        kill(simNodes[i].pid, SIGKILL);
+    kill(simRegistry, SIGKILL);
+    return -1;
+}
+
+static inline void sim_cmd(int i, const char *fmt, ...) {
+    char buf[128];
+    va_list ap;
+    if (!simNodes[i].alive)
+        return;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf) - 1, fmt, ap);
+    va_end(ap);
+    buf[n++] = '\n';
+    if (write(simNodes[i].in, buf, (size_t)n) != n)
+        perror("comando para o nó");
+}
+
+// Árvore binária na rede 010: o nó i liga-se ao (i - 1) / 2, com o nó 0
+// (porto base + 1) na raiz
+static inline void sim_tree(int n, int base) {
+    sim_cmd(0, "dj 010 0.0.0.0 0");
+    for (int i = 1; i < n; i++) {
+        sim_sleep_ms(30);
+        sim_cmd(i, "dj 010 127.0.0.1 %d", base + 1 + (i - 1) / 2);
+    }
+    sim_sleep_ms(1000);
+}
+
+// Sinal para o nó; SIGKILL conta como o fim do nó
+static inline void sim_kill(int i, int sig) {
+    kill(simNodes[i].pid, sig);
+    if (sig == SIGKILL) {
+        waitpid(simNodes[i].pid, NULL, 0);
+        simNodes[i].alive = 0;
+    }
+}
+
+// Bytes escritos até agora pelo nó
+static inline off_t sim_mark(int i) {
+    struct stat st;
+    if (fstat(fileno(simNodes[i].log), &st) < 0)
+        return 0;
+    return st.st_size;
+}
+
+// Chama fn (se não for NULL) para cada linha do nó entre as marcas from e
+// to (to < 0: até ao fim) que contenha pat; devolve quantas foram
+static inline int sim_lines(int i, off_t from, off_t to, const char *pat,
+                            void (*fn)(const char *line, void *arg), void *arg) {
+    if (to < 0)
+        to = sim_mark(i);
+    if (to <= from)
+        return 0;
+    size_t len = (size_t)(to - from);
+    char *buf = malloc(len + 1);
+    if (buf == NULL)
+        return 0;
+    ssize_t got = pread(fileno(simNodes[i].log), buf, len, from);
+    buf[got > 0 ? got : 0] = '\0';
+    int count = 0;
+    for (char *line = buf, *nl; *line != '\0'; line = nl + 1) {
+        nl = strchr(line, '\n');
+        if (nl == NULL)
+            break;   // linha ainda a meio
+        *nl = '\0';
+        if (strstr(line, pat) != NULL) {
+            count++;
+            if (fn != NULL)
+                fn(line, arg);
+        }
+    }
+    free(buf);
+    return count;
+}
+
+// Soma de sim_lines() em todos os nós, com as marcas de cada um
+static inline int sim_count_all(int n, const off_t *from, const off_t *to, const char *pat) {
+    int count = 0;
+    for (int i = 0; i < n; i++)
+        count += sim_lines(i, from ? from[i] : 0, to ? to[i] : -1, pat, NULL, NULL);
+    return count;
+}
+
+static inline void sim_mark_all(int n, off_t *marks) {
+    for (int i = 0; i < n; i++)
+        marks[i] = sim_mark(i);
+}
+
+// Manda sair os nós (x), espera por eles e termina o servidor de registo
+static inline void sim_stop(int n) {
+    for (int i = 0; i < n; i++) {
+        if (!simNodes[i].alive)
+            continue;
+        kill(simNodes[i].pid, SIGCONT);
+        sim_cmd(i, "x");
+    }
+    for (int i = 0; i < n; i++) {
+        if (!simNodes[i].alive)
+            continue;
+        int waited = 0;
+        while (waitpid(simNodes[i].pid, NULL, WNOHANG) == 0 && waited < 5000) {
+            sim_sleep_ms(10);
+            waited += 10;
+        }
+        if (waited >= 5000)
+            sim_kill(i, SIGKILL);
+        simNodes[i].alive = 0;
+    }
+    kill(simRegistry, SIGTERM);
+    waitpid(simRegistry, NULL, 0);
+}
+
+#endif
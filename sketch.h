@@ -0,0 +1,96 @@
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/*
+ * Count-min sketch com contadores de 4 bits (dois por byte), usado pela
+ * admissão TinyLFU da cache para estimar a frequência recente de um nome.
+ *
+ * SKETCH_ROWS linhas de width contadores; a estimativa é o mínimo das
+ * linhas e o incremento só sobe os contadores iguais a esse mínimo
+ * (atualização conservadora). Ao fim de sample incrementos todos os
+ * contadores são divididos por 2 (envelhecimento), por isso a frequência
+ * estimada diz respeito às últimas ~sample procuras.
+ */
+
+#define SKETCH_ROWS 4
+#define SKETCH_MAX  15
+
+typedef struct {
+    uint8_t *table;       // SKETCH_ROWS * width / 2 bytes
+    uint32_t width;       // potência de 2
+    uint32_t sample;      // incrementos entre envelhecimentos
+    uint32_t additions;
+    unsigned long resets;
+} CountMin;
+
+static inline int sketch_init(CountMin *cm, uint32_t width, uint32_t sample) {
+    memset(cm, 0, sizeof(*cm));
+    uint32_t w = 16;
+    while (w < width)
+        w <<= 1;
+    cm->table = calloc(SKETCH_ROWS * w / 2, 1);
+    if (cm->table == NULL)
+        return -1;
+    cm->width = w;
+    cm->sample = sample > 0 ? sample : 10 * w;
+    return 0;
+}
+
+static inline void sketch_free(CountMin *cm) {
+    free(cm->table);
+    memset(cm, 0, sizeof(*cm));
+}
+
+static inline size_t sketch_bytes(const CountMin *cm) {
+    return SKETCH_ROWS * (size_t)cm->width / 2;
+}
+
+// Posição do contador da linha row para o hash h
+static inline uint32_t sketch_index(const CountMin *cm, uint32_t h, int row) {
+    static const uint32_t seeds[SKETCH_ROWS] = {0x9e3779b1u, 0x85ebca6bu, 0xc2b2ae35u, 0x27d4eb2fu};
+    uint32_t x = h * seeds[row];
+    x ^= x >> 15;
+    return (uint32_t)row * cm->width + (x & (cm->width - 1));
+}
+
+static inline int sketch_get(const CountMin *cm, uint32_t i) {
+    return (cm->table[i / 2] >> ((i & 1) * 4)) & 0xf;
+}
+
+static inline int sketch_estimate(const CountMin *cm, uint32_t h) {
+    int min = SKETCH_MAX;
+    for (int r = 0; r < SKETCH_ROWS; r++) {
+        int c = sketch_get(cm, sketch_index(cm, h, r));
+        if (c < min)
+            min = c;
+    }
+    return min;
+}
+
+// Divide todos os contadores por 2
+static inline void sketch_age(CountMin *cm) {
+    for (size_t i = 0; i < sketch_bytes(cm); i++)
+        cm->table[i] = (cm->table[i] >> 1) & 0x77;
+    cm->additions /= 2;
+    cm->resets++;
+}
+
+static inline void sketch_add(CountMin *cm, uint32_t h) {
+    int min = sketch_estimate(cm, h);
+    if (min == SKETCH_MAX)
+        return;
+    for (int r = 0; r < SKETCH_ROWS; r++) {
+        uint32_t i = sketch_index(cm, h, r);
+        if (sketch_get(cm, i) == min)
+            cm->table[i / 2] += (uint8_t)(1u << ((i & 1) * 4));
+    }
+    if (++cm->additions >= cm->sample)
+        sketch_age(cm);
+}
+
+#endif
@@ -0,0 +1,248 @@
+#ifndef STORE_H
+#define STORE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "name.h"
+
+/*
+ * Objetos guardados no nó (comandos create, delete e show names).
+ *
+ * Os nomes são internados numa arena só de acréscimo: cada registo tem o
+ * hash já calculado, o comprimento, a marca de apagado e o nome terminado
+ * em '\0', alinhado a 4 bytes. Uma tabela de dispersão com endereçamento
+ * aberto guarda o deslocamento de cada registo na arena (0 = vazio), pelo
+ * que o teste de pertença de um interesse é O(1) e não há um malloc por
+ * nome.
+ *
+ * Apagar só marca o registo (tombstone); um create do mesmo nome reativa-o.
+ * Quando os registos apagados passam a ser metade da arena, store_compact()
+ * copia os vivos para uma arena nova e reconstrói a tabela.
+ */
+
+#define STORE_MIN_SLOTS   64
+#define STORE_MIN_ARENA   4096
+#define STORE_COMPACT_MIN 1024   // registos apagados antes de pensar em compactar
+
+typedef struct {
+    uint32_t hash;
+    uint8_t len;
+    uint8_t dead;
+    uint16_t pad;
+    char name[];    // len carateres + '\0'
+} StoreRecord;
+
+typedef struct {
+    char *arena;
+    size_t used;          // bytes ocupados na arena (o deslocamento 0 nunca é usado)
+    size_t size;
+    uint32_t *slots;      // deslocamento do registo, 0 = vazio
+    uint32_t mask;        // número de slots - 1
+    unsigned long live;
+    unsigned long dead;
+    unsigned long records;     // registos na arena (vivos + apagados)
+    unsigned long compactions;
+} ObjectStore;
+
+static inline StoreRecord *store_record(const ObjectStore *st, uint32_t off) {
+    return (StoreRecord *)(st->arena + off);
+}
+
+static inline size_t store_record_size(size_t len) {
+    return (sizeof(StoreRecord) + len + 1 + 3) & ~(size_t)3;
+}
+
+static inline int store_init(ObjectStore *st) {
+    memset(st, 0, sizeof(*st));
+    st->arena = malloc(STORE_MIN_ARENA);
+    st->slots = calloc(STORE_MIN_SLOTS, sizeof(uint32_t));
+    if (st->arena == NULL || st->slots == NULL) {
+        perror("Erro ao reservar o armazém de objetos");
+        free(st->arena);
+        free(st->slots);
+        return -1;
+    }
+    st->size = STORE_MIN_ARENA;
+    st->used = 4;
+    st->mask = STORE_MIN_SLOTS - 1;
+    return 0;
+}
+
+static inline void store_destroy(ObjectStore *st) {
+    free(st->arena);
+    free(st->slots);
+    memset(st, 0, sizeof(*st));
+}
+
+// Slot com o registo do nome, ou o slot vazio onde ficaria
+static inline uint32_t *store_slot(const ObjectStore *st, const NameView *nv) {
+    for (uint32_t i = nv->hash & st->mask;; i = (i + 1) & st->mask) {
+        uint32_t *slot = &st->slots[i];
+        if (*slot == 0)
+            return slot;
+        StoreRecord *r = store_record(st, *slot);
+        if (r->hash == nv->hash && r->len == nv->len && memcmp(r->name, nv->name, nv->len) == 0)
+            return slot;
+    }
+}
+
+// Liga na tabela (vazia, mask + 1 slots) os registos de arena[4 .. used)
+static inline void store_fill(uint32_t *slots, uint32_t mask, const char *arena, size_t used) {
+    for (size_t off = 4; off < used;) {
+        const StoreRecord *r = (const StoreRecord *)(arena + off);
+        uint32_t i = r->hash & mask;
+        while (slots[i] != 0)
+            i = (i + 1) & mask;
+        slots[i] = (uint32_t)off;
+        off += store_record_size(r->len);
+    }
+}
+
+// Reconstrói a tabela com nslots slots (potência de 2) a partir da arena
+static inline int store_rehash(ObjectStore *st, uint32_t nslots) {
+    uint32_t *slots = calloc(nslots, sizeof(uint32_t));
+    if (slots == NULL)
+        return -1;
+    store_fill(slots, nslots - 1, st->arena, st->used);
+    free(st->slots);
+    st->slots = slots;
+    st->mask = nslots - 1;
+    return 0;
+}
+
+// Copia os registos vivos para uma arena nova e reconstrói a tabela. A
+// arena e a tabela novas são reservadas antes de mexer nas antigas: sem
+// memória, o armazém fica como estava.
+static inline int store_compact(ObjectStore *st) {
+    size_t live = 4;
+    for (size_t off = 4; off < st->used;) {
+        StoreRecord *r = store_record(st, (uint32_t)off);
+        if (!r->dead)
+            live += store_record_size(r->len);
+        off += store_record_size(r->len);
+    }
+    size_t size = STORE_MIN_ARENA;
+    while (size < live)
+        size *= 2;
+    uint32_t nslots = STORE_MIN_SLOTS;
+    while (nslots < st->live * 2)
+        nslots *= 2;
+    char *arena = malloc(size);
+    uint32_t *slots = calloc(nslots, sizeof(uint32_t));
+    if (arena == NULL || slots == NULL) {
+        free(arena);
+        free(slots);
+        return -1;
+    }
+    size_t used = 4;
+    for (size_t off = 4; off < st->used;) {
+        StoreRecord *r = store_record(st, (uint32_t)off);
+        size_t rs = store_record_size(r->len);
+        if (!r->dead) {
+            memcpy(arena + used, r, rs);
+            used += rs;
+        }
+        off += rs;
+    }
+    store_fill(slots, nslots - 1, arena, used);
+    free(st->arena);
+    free(st->slots);
+    st->arena = arena;
+    st->size = size;
+    st->used = used;
+    st->slots = slots;
+    st->mask = nslots - 1;
+    st->records = st->live;
+    st->dead = 0;
+    st->compactions++;
+    return 0;
+}
+
+static inline int store_contains(const ObjectStore *st, const NameView *nv) {
+    uint32_t *slot = store_slot(st, nv);
+    return *slot != 0 && !store_record(st, *slot)->dead;
+}
+
+// Cria o objeto; devolve 1 se foi criado, 0 se já existia, -1 sem memória
+static inline int store_add(ObjectStore *st, const NameView *nv) {
+    uint32_t *slot = store_slot(st, nv);
+    if (*slot != 0) {
+        StoreRecord *r = store_record(st, *slot);
+        if (!r->dead)
+            return 0;
+        r->dead = 0;
+        st->dead--;
+        st->live++;
+        return 1;
+    }
+    // Tabela com ocupação até 1/2
+    if ((st->records + 1) * 2 > (unsigned long)st->mask + 1) {
+        if (store_rehash(st, (st->mask + 1) * 2) < 0)
+            return -1;
+        slot = store_slot(st, nv);
+    }
+    size_t len = nv->len;
+    size_t rs = store_record_size(len);
+    if (st->used + rs > st->size) {
+        size_t size = st->size * 2;
+        if (size > UINT32_MAX)
+            return -1;
+        char *arena = realloc(st->arena, size);
+        if (arena == NULL)
+            return -1;
+        st->arena = arena;
+        st->size = size;
+    }
+    StoreRecord *r = store_record(st, (uint32_t)st->used);
+    r->hash = nv->hash;
+    r->len = (uint8_t)len;
+    r->dead = 0;
+    r->pad = 0;
+    memcpy(r->name, nv->name, len);
+    r->name[len] = '\0';
+    *slot = (uint32_t)st->used;
+    st->used += rs;
+    st->records++;
+    st->live++;
+    return 1;
+}
+
+// Apaga o objeto; devolve 1 se existia
+static inline int store_remove(ObjectStore *st, const NameView *nv) {
+    uint32_t *slot = store_slot(st, nv);
+    if (*slot == 0)
+        return 0;
+    StoreRecord *r = store_record(st, *slot);
+    if (r->dead)
+        return 0;
+    r->dead = 1;
+    st->live--;
+    st->dead++;
+    if (st->dead >= STORE_COMPACT_MIN && st->dead * 2 >= st->records)
+        store_compact(st);
+    return 1;
+}
+
+// Lista os nomes dos objetos guardados
+static inline void store_print(const ObjectStore *st) {
+    printf("Objetos guardados (%lu):\n", st->live);
+    for (size_t off = 4; off < st->used;) {
+        StoreRecord *r = store_record(st, (uint32_t)off);
+        if (!r->dead)
+            printf("  %s\n", r->name);
+        off += store_record_size(r->len);
+    }
+}
+
+// Bytes ocupados (arena + tabela) por nome guardado
+static inline void store_print_stats(const ObjectStore *st) {
+    size_t bytes = st->size + ((size_t)st->mask + 1) * sizeof(uint32_t);
+    printf("Objetos: %lu nomes, %lu apagados por compactar, %zu bytes (%.1f por nome), "
+           "%lu compactações\n", st->live, st->dead, bytes,
+           st->live ? (double)bytes / st->live : 0.0, st->compactions);
+}
+
+#endif
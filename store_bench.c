@@ -0,0 +1,137 @@
+// store_bench.c
+//
+// Memória e custo do armazém de objetos (store.h) com muitos nomes:
+//
+//   gcc -O2 -o store_bench store_bench.c
+//   ./store_bench [nomes]
+//
+// Cria 10^6 nomes (por omissão) de cerca de 20 carateres, procura-os todos
+// e outros tantos que não existem, apaga metade (um sim, um não) e
+// compacta, e volta a criar um quarto dos apagados, que reativam registos
+// se a compactação ainda não os levou. store_remove() já compacta sozinho
+// quando os apagados chegam a metade; a fase de compactação chama
+// store_compact() de qualquer forma, para medir uma passagem completa
+// pelos vivos. Em cada fase mostra os
+// nanossegundos por operação e os bytes por nome guardado: os reservados
+// (arena e tabela, como no "sn" do ndn6) e os ocupados na arena. Verifica
+// no fim de cada fase que os nomes presentes são exatamente os esperados e
+// termina com 1 se não forem.
+
+#include <time.h>
+
+#include "store.h"
+
+static double sb_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static char *sbPool;    // nomes, SB_NAME bytes cada
+static NameView *sbNames;
+static long sbCount;
+
+#define SB_NAME 32
+
+// Nomes 0 .. 2n - 1; os de i >= n nunca são criados e servem para as falhas
+static void sb_build(long n) {
+    sbPool = malloc((size_t)n * 2 * SB_NAME);
+    sbNames = malloc((size_t)n * 2 * sizeof(*sbNames));
+    if (sbPool == NULL || sbNames == NULL) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (long i = 0; i < 2 * n; i++) {
+        char *p = sbPool + (size_t)i * SB_NAME;
+        snprintf(p, SB_NAME, "producer%ldobject%ld", i % 977, i);
+        name_view(&sbNames[i], p);
+    }
+    sbCount = n;
+}
+
+static void sb_report(const char *phase, const ObjectStore *st, double secs, long ops) {
+    size_t reserved = st->size + ((size_t)st->mask + 1) * sizeof(uint32_t);
+    printf("%-22s %6.1f ns/op  %8lu nomes  %5.1f bytes/nome reservados, %5.1f na arena, "
+           "%lu apagados, %lu compactações\n",
+           phase, secs * 1e9 / (double)ops, st->live,
+           st->live ? (double)reserved / (double)st->live : 0.0,
+           st->live ? (double)st->used / (double)st->live : 0.0, st->dead, st->compactions);
+}
+
+// Confere a presença de cada nome com want(i); devolve o número de erros
+static long sb_verify(const ObjectStore *st, int (*want)(long)) {
+    long bad = 0;
+    for (long i = 0; i < 2 * sbCount; i++)
+        bad += store_contains(st, &sbNames[i]) != (i < sbCount && want(i));
+    return bad;
+}
+
+static int sb_all(long i) {
+    (void)i;
+    return 1;
+}
+
+static int sb_odd(long i) {
+    return i % 2 == 1;
+}
+
+static int sb_odd_or_quarter(long i) {
+    return i % 2 == 1 || i % 4 == 0;
+}
+
+int main(int argc, char *argv[]) {
+    long n = argc > 1 ? atol(argv[1]) : 1000000;
+    if (n <= 0 || n > 50000000) {
+        fprintf(stderr, "Uso: %s [nomes]\n", argv[0]);
+        return 2;
+    }
+    sb_build(n);
+    ObjectStore st;
+    if (store_init(&st) < 0)
+        return EXIT_FAILURE;
+    long bad = 0;
+
+    double t0 = sb_now();
+    for (long i = 0; i < n; i++)
+        if (store_add(&st, &sbNames[i]) != 1)
+            bad++;
+    sb_report("criar", &st, sb_now() - t0, n);
+
+    long hits = 0;
+    t0 = sb_now();
+    for (long i = 0; i < 2 * n; i++)
+        hits += store_contains(&st, &sbNames[i]);
+    sb_report("procurar (metade falha)", &st, sb_now() - t0, 2 * n);
+    if (hits != n)
+        bad++;
+    bad += sb_verify(&st, sb_all);
+
+    t0 = sb_now();
+    for (long i = 0; i < n; i += 2)
+        if (store_remove(&st, &sbNames[i]) != 1)
+            bad++;
+    sb_report("apagar metade", &st, sb_now() - t0, (n + 1) / 2);
+
+    t0 = sb_now();
+    if (store_compact(&st) < 0)
+        bad++;
+    sb_report("compactar", &st, sb_now() - t0, st.live > 0 ? (long)st.live : 1);
+    bad += sb_verify(&st, sb_odd);
+
+    t0 = sb_now();
+    for (long i = 0; i < n; i += 4)
+        if (store_add(&st, &sbNames[i]) != 1)
+            bad++;
+    sb_report("recriar um quarto", &st, sb_now() - t0, (n + 3) / 4);
+    bad += sb_verify(&st, sb_odd_or_quarter);
+
+    store_print_stats(&st);
+    store_destroy(&st);
+    free(sbPool);
+    free(sbNames);
+    if (bad > 0) {
+        printf("%ld diferenças nos nomes guardados\n", bad);
+        return 1;
+    }
+    return 0;
+}
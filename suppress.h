@@ -0,0 +1,82 @@
+#ifndef SUPPRESS_H
+#define SUPPRESS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+/*
+ * Tabela de supressão de interesses recentes.
+ *
+ * Guarda a chave (hash do nome combinado com o nonce) dos interesses que
+ * este nó reencaminhou há pouco tempo. O tempo é dividido em SUPPRESS_GENS gerações de period_ms cada;
+ * cada geração é um conjunto de SUPPRESS_SLOTS posições indexado pelo
+ * hash (uma colisão substitui a entrada anterior). Ao mudar de período a
+ * geração mais antiga é limpa, por isso um nome fica registado entre
+ * (SUPPRESS_GENS - 1) e SUPPRESS_GENS períodos. Memória fixa e testes O(1).
+ *
+ * Serve para não voltar a inundar a árvore com cópias de um interesse que
+ * circulem durante uma reparação da topologia. O nonce distingue essas
+ * cópias de um novo pedido do mesmo nome feito por outro nó.
+ */
+
+#define SUPPRESS_GENS     4
+#define SUPPRESS_SLOTS    1024   // potência de 2
+#define SUPPRESS_PERIOD   250    // ms por geração
+
+typedef struct {
+    unsigned long recorded;
+    unsigned long dup_drops;     // cópias de um interesse já reencaminhado
+    unsigned long loop_drops;    // interesses recebidos por uma interface de saída
+} SuppressStats;
+
+typedef struct {
+    uint32_t slots[SUPPRESS_GENS][SUPPRESS_SLOTS];   // hash | 1, 0 = vazio
+    long long epoch;             // período atual (now / period_ms)
+    int period_ms;
+    SuppressStats stats;
+} SuppressTable;
+
+static inline void suppress_init(SuppressTable *t, int period_ms) {
+    memset(t, 0, sizeof(*t));
+    t->period_ms = period_ms > 0 ? period_ms : SUPPRESS_PERIOD;
+}
+
+// Avança para o período de now, limpando as gerações que expiraram
+static inline void suppress_advance(SuppressTable *t, long long now) {
+    long long epoch = now / t->period_ms;
+    long long steps = epoch - t->epoch;
+    if (steps <= 0)
+        return;
+    if (steps > SUPPRESS_GENS)
+        steps = SUPPRESS_GENS;
+    for (long long e = epoch - steps + 1; e <= epoch; e++)
+        memset(t->slots[e % SUPPRESS_GENS], 0, sizeof(t->slots[0]));
+    t->epoch = epoch;
+}
+
+static inline void suppress_record(SuppressTable *t, uint32_t hash, long long now) {
+    suppress_advance(t, now);
+    t->slots[t->epoch % SUPPRESS_GENS][hash & (SUPPRESS_SLOTS - 1)] = hash | 1;
+    t->stats.recorded++;
+}
+
+static inline uint32_t suppress_key(uint32_t name_hash, uint32_t nonce) {
+    return name_hash ^ (nonce * 2654435761u);
+}
+
+// 1 se a chave foi registada nas últimas gerações
+static inline int suppress_seen(SuppressTable *t, uint32_t hash, long long now) {
+    suppress_advance(t, now);
+    for (int g = 0; g < SUPPRESS_GENS; g++)
+        if (t->slots[g][hash & (SUPPRESS_SLOTS - 1)] == (hash | 1))
+            return 1;
+    return 0;
+}
+
+static inline void suppress_print_stats(const SuppressTable *t) {
+    printf("Supressão: %lu interesses registados, %lu cópias descartadas, %lu ciclos cortados\n",
+           t->stats.recorded, t->stats.dup_drops, t->stats.loop_drops);
+}
+
+#endif
@@ -0,0 +1,283 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Roda de temporizadores hierárquica.
+ *
+ * Quatro níveis de TIMER_SLOTS posições com ticks de 1 ms: o nível 0 cobre
+ * os próximos 64 ms, o nível 1 os próximos 64^2 ms, e assim por diante até
+ * 64^4 ms (cerca de 4,6 horas; prazos mais longos são encurtados). Um
+ * temporizador fica na posição do nível que cobre o seu prazo e desce de
+ * nível (cascata) quando o nível de baixo dá a volta. Armar e cancelar são
+ * O(1): o Timer vive dentro do seu dono (entrada da PIT, pedido ao servidor
+ * de registo, join) e é ligado numa lista da posição, sem reservar memória.
+ *
+ * timer_run() avança a roda até ao instante atual e junta num só lote os
+ * temporizadores de todos os ticks que passaram, chamando depois os
+ * callbacks por ordem de prazo. Um callback pode armar e cancelar outros
+ * temporizadores, incluindo os que ainda estão no lote. timer_timeout() dá
+ * o tempo de espera até ao próximo prazo (exato no nível 0; nos outros, até
+ * à próxima cascata), para o reactor acordar a tempo.
+ */
+
+#define TIMER_LEVELS 4
+#define TIMER_BITS   6
+#define TIMER_SLOTS  (1 << TIMER_BITS)
+#define TIMER_MASK   (TIMER_SLOTS - 1)
+#define TIMER_MAX_TICKS ((1ull << (TIMER_LEVELS * TIMER_BITS)) - 1)
+#define TIMER_READY  (-1)   // no lote de timer_run(), à espera do callback
+
+typedef struct TimerWheel TimerWheel;
+
+typedef void (*timer_cb)(void *arg);
+
+typedef struct Timer {
+    struct Timer *next;
+    struct Timer **pprev;    // NULL: desarmado
+    TimerWheel *wheel;
+    uint64_t expires;        // tick do prazo
+    int slot;                // nível * TIMER_SLOTS + posição, ou TIMER_READY
+    timer_cb cb;
+    void *arg;
+} Timer;
+
+typedef struct {
+    unsigned long armed;
+    unsigned long cancelled;
+    unsigned long fired;
+    unsigned long cascaded;  // temporizadores que desceram de nível
+    unsigned long batches;   // chamadas a timer_run() que dispararam algum
+    unsigned long peak;      // máximo de temporizadores armados
+} TimerStats;
+
+struct TimerWheel {
+    Timer *slots[TIMER_LEVELS][TIMER_SLOTS];
+    uint64_t occupied[TIMER_LEVELS];  // bit por posição não vazia
+    uint64_t now;            // próximo tick a processar
+    long long base_ms;       // instante do tick 0
+    Timer *ready, **ready_tail;
+    unsigned long count;     // armados (no lote incluídos)
+    TimerStats stats;
+};
+
+static inline long long timer_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Relógio da roda; os testes definem TIMER_CLOCK para usar um relógio virtual
+#ifndef TIMER_CLOCK
+#define TIMER_CLOCK timer_now_ms
+#endif
+
+static inline void timer_wheel_init(TimerWheel *w) {
+    memset(w, 0, sizeof(*w));
+    w->base_ms = TIMER_CLOCK();
+    w->ready_tail = &w->ready;
+}
+
+static inline void timer_init(Timer *t, timer_cb cb, void *arg) {
+    memset(t, 0, sizeof(*t));
+    t->cb = cb;
+    t->arg = arg;
+}
+
+static inline int timer_pending(const Timer *t) {
+    return t->pprev != NULL;
+}
+
+// Liga o temporizador à posição que cobre o seu prazo
+static inline void timer_place(TimerWheel *w, Timer *t) {
+    uint64_t delta = t->expires - w->now;
+    int level = 0;
+    while (level < TIMER_LEVELS - 1 && delta >= (1ull << ((level + 1) * TIMER_BITS)))
+        level++;
+    int pos = (int)((t->expires >> (level * TIMER_BITS)) & TIMER_MASK);
+    Timer **head = &w->slots[level][pos];
+    t->slot = level * TIMER_SLOTS + pos;
+    t->next = *head;
+    if (*head != NULL)
+        (*head)->pprev = &t->next;
+    *head = t;
+    t->pprev = head;
+    w->occupied[level] |= 1ull << pos;
+}
+
+static inline void timer_unlink(Timer *t) {
+    TimerWheel *w = t->wheel;
+    if (t->slot == TIMER_READY && w->ready_tail == &t->next)
+        w->ready_tail = t->pprev;
+    *t->pprev = t->next;
+    if (t->next != NULL)
+        t->next->pprev = t->pprev;
+    if (t->slot != TIMER_READY) {
+        int level = t->slot / TIMER_SLOTS, pos = t->slot % TIMER_SLOTS;
+        if (w->slots[level][pos] == NULL)
+            w->occupied[level] &= ~(1ull << pos);
+    }
+    t->next = NULL;
+    t->pprev = NULL;
+}
+
+static inline void timer_cancel(Timer *t) {
+    if (t->pprev == NULL)
+        return;
+    t->wheel->count--;
+    t->wheel->stats.cancelled++;
+    timer_unlink(t);
+}
+
+// Arma (ou rearma) o temporizador para o instante when_ms de TIMER_CLOCK()
+static inline void timer_arm(TimerWheel *w, Timer *t, long long when_ms) {
+    if (t->pprev != NULL)
+        timer_unlink(t);
+    else
+        w->count++;
+    long long tick = when_ms - w->base_ms;
+    if (tick < 0 || (uint64_t)tick < w->now)
+        tick = (long long)w->now;
+    if ((uint64_t)tick - w->now > TIMER_MAX_TICKS)
+        tick = (long long)(w->now + TIMER_MAX_TICKS);
+    t->wheel = w;
+    t->expires = (uint64_t)tick;
+    timer_place(w, t);
+    w->stats.armed++;
+    if (w->count > w->stats.peak)
+        w->stats.peak = w->count;
+}
+
+static inline void timer_arm_in(TimerWheel *w, Timer *t, long long delay_ms) {
+    timer_arm(w, t, TIMER_CLOCK() + delay_ms);
+}
+
+// Desce para os níveis de baixo os temporizadores da posição pos do nível
+static inline void timer_cascade(TimerWheel *w, int level, int pos) {
+    Timer *t = w->slots[level][pos];
+    w->slots[level][pos] = NULL;
+    w->occupied[level] &= ~(1ull << pos);
+    while (t != NULL) {
+        Timer *next = t->next;
+        timer_place(w, t);
+        w->stats.cascaded++;
+        t = next;
+    }
+}
+
+// Primeiro tick >= now com posição ocupada no nível 0, ou o fim da volta
+static inline uint64_t timer_next_l0(const TimerWheel *w) {
+    int pos = (int)(w->now & TIMER_MASK);
+    uint64_t bits = w->occupied[0] >> pos;
+    if (bits == 0)
+        return (w->now | TIMER_MASK) + 1;
+    return w->now + (uint64_t)__builtin_ctzll(bits);
+}
+
+// Processa os ticks até target (inclusive), juntando os que expiram no lote
+static inline void timer_advance(TimerWheel *w, uint64_t target) {
+    while (w->now <= target) {
+        // Início de uma volta do nível 0: as cascatas vêm primeiro
+        if ((w->now & TIMER_MASK) == 0) {
+            for (int level = 1; level < TIMER_LEVELS; level++) {
+                int pos = (int)((w->now >> (level * TIMER_BITS)) & TIMER_MASK);
+                if (w->occupied[level] & (1ull << pos))
+                    timer_cascade(w, level, pos);
+                if (pos != 0)
+                    break;
+            }
+        }
+        // Salta os ticks vazios até à próxima posição ocupada ou volta
+        uint64_t next = timer_next_l0(w);
+        if (next != w->now) {
+            w->now = next <= target ? next : target + 1;
+            continue;
+        }
+        int pos = (int)(w->now & TIMER_MASK);
+        Timer *t = w->slots[0][pos];
+        w->slots[0][pos] = NULL;
+        w->occupied[0] &= ~(1ull << pos);
+        while (t != NULL) {
+            Timer *next_t = t->next;
+            t->slot = TIMER_READY;
+            t->next = NULL;
+            t->pprev = w->ready_tail;
+            *w->ready_tail = t;
+            w->ready_tail = &t->next;
+            t = next_t;
+        }
+        w->now++;
+    }
+}
+
+// Avança a roda até agora e chama os callbacks dos temporizadores que
+// expiraram; devolve quantos disparou
+static inline int timer_run(TimerWheel *w) {
+    long long tick = TIMER_CLOCK() - w->base_ms;
+    if (tick >= 0 && (uint64_t)tick >= w->now)
+        timer_advance(w, (uint64_t)tick);
+    int n = 0;
+    while (w->ready != NULL) {
+        Timer *t = w->ready;
+        timer_unlink(t);
+        w->count--;
+        w->stats.fired++;
+        n++;
+        t->cb(t->arg);
+    }
+    if (n > 0)
+        w->stats.batches++;
+    return n;
+}
+
+static inline uint64_t timer_ror(uint64_t v, int n) {
+    return n == 0 ? v : (v >> n) | (v << (TIMER_SLOTS - n));
+}
+
+// Milissegundos até a roda precisar de timer_run() (-1 se estiver vazia)
+static inline int timer_timeout(const TimerWheel *w) {
+    if (w->ready != NULL)
+        return 0;
+    if (w->count == 0)
+        return -1;
+    uint64_t next = UINT64_MAX;
+    // Nível 0: os prazos estão todos em [now, now + 63], o primeiro é exato
+    if (w->occupied[0] != 0)
+        next = w->now + (uint64_t)__builtin_ctzll(timer_ror(w->occupied[0], (int)(w->now & TIMER_MASK)));
+    // Níveis de cima: basta acordar na cascata da primeira posição ocupada.
+    // A posição atual já desceu, a não ser que now seja o início do bloco.
+    for (int level = 1; level < TIMER_LEVELS; level++) {
+        if (w->occupied[level] == 0)
+            continue;
+        int shift = level * TIMER_BITS;
+        uint64_t cur = w->now >> shift;
+        uint64_t rot = timer_ror(w->occupied[level], (int)(cur & TIMER_MASK));
+        uint64_t k;
+        if ((rot & 1) && (cur << shift) == w->now)
+            k = 0;
+        else if ((rot & ~1ull) != 0)
+            k = (uint64_t)__builtin_ctzll(rot & ~1ull);
+        else
+            k = TIMER_SLOTS;
+        uint64_t cascade = (cur + k) << shift;
+        if (cascade < next)
+            next = cascade;
+    }
+    long long left = w->base_ms + (long long)next - TIMER_CLOCK();
+    if (left <= 0)
+        return 0;
+    return left > 0x7fffffff ? 0x7fffffff : (int)left;
+}
+
+static inline void timer_print_stats(const TimerWheel *w) {
+    printf("Temporizadores: %lu armados agora (máximo %lu), %lu armações, %lu cancelados, "
+           "%lu disparados em %lu lotes, %lu cascatas\n",
+           w->count, w->stats.peak, w->stats.armed, w->stats.cancelled, w->stats.fired,
+           w->stats.batches, w->stats.cascaded);
+}
+
+#endif
@@ -0,0 +1,257 @@
+// timer_bench.c
+//
+// Custo por temporizador da roda (timer.h) com muitos temporizadores
+// armados ao mesmo tempo, comparado com um heap binário indexado (a
+// estrutura habitual para prazos, O(log n) por operação):
+//
+//   gcc -O2 -o timer_bench timer_bench.c
+//   ./timer_bench [temporizadores] [repetições]
+//
+// Com N temporizadores (10^5 por omissão) e prazos uniformes até 60 s:
+//
+//   armar    arma os N com a estrutura vazia
+//   rearmar  muda o prazo dos N já armados, como a PIT ao renovar um pedido
+//   cancelar cancela os N
+//   disparar avança um relógio virtual 1 ms de cada vez até 60 s, chamando
+//            timer_run() em cada ms como o reactor, até disparar os N
+//
+// Os prazos são sorteados antes de medir. Mostra o melhor de cada fase, em
+// nanossegundos por temporizador.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static long long tbNow;   // relógio virtual da roda, em ms
+
+static long long tb_clock(void) {
+    return tbNow;
+}
+
+#define TIMER_CLOCK tb_clock
+#include "timer.h"
+
+#define TB_SPAN 60000   // prazos em [1, TB_SPAN] ms
+
+static unsigned long tbFired;
+
+static double tb_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void tb_callback(void *arg) {
+    (void)arg;
+    tbFired++;
+}
+
+// Heap binário de mínimos com o índice guardado em cada elemento, para
+// cancelar e rearmar sem procurar
+typedef struct {
+    long long expires;
+    int idx;   // posição no heap, -1 se desarmado
+    timer_cb cb;
+    void *arg;
+} TbHeapTimer;
+
+typedef struct {
+    TbHeapTimer **h;
+    int n;
+} TbHeap;
+
+static void tb_heap_set(TbHeap *hp, int i, TbHeapTimer *t) {
+    hp->h[i] = t;
+    t->idx = i;
+}
+
+static void tb_heap_up(TbHeap *hp, int i) {
+    TbHeapTimer *t = hp->h[i];
+    while (i > 0 && hp->h[(i - 1) / 2]->expires > t->expires) {
+        tb_heap_set(hp, i, hp->h[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    tb_heap_set(hp, i, t);
+}
+
+static void tb_heap_down(TbHeap *hp, int i) {
+    TbHeapTimer *t = hp->h[i];
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= hp->n)
+            break;
+        if (c + 1 < hp->n && hp->h[c + 1]->expires < hp->h[c]->expires)
+            c++;
+        if (hp->h[c]->expires >= t->expires)
+            break;
+        tb_heap_set(hp, i, hp->h[c]);
+        i = c;
+    }
+    tb_heap_set(hp, i, t);
+}
+
+static void tb_heap_cancel(TbHeap *hp, TbHeapTimer *t) {
+    if (t->idx < 0)
+        return;
+    int i = t->idx;
+    TbHeapTimer *last = hp->h[--hp->n];
+    t->idx = -1;
+    if (last == t)
+        return;
+    tb_heap_set(hp, i, last);
+    tb_heap_up(hp, i);
+    tb_heap_down(hp, last->idx);
+}
+
+static void tb_heap_arm(TbHeap *hp, TbHeapTimer *t, long long when) {
+    if (t->idx < 0) {
+        t->expires = when;
+        tb_heap_set(hp, hp->n++, t);
+        tb_heap_up(hp, t->idx);
+        return;
+    }
+    long long old = t->expires;
+    t->expires = when;
+    if (when < old)
+        tb_heap_up(hp, t->idx);
+    else
+        tb_heap_down(hp, t->idx);
+}
+
+static void tb_heap_run(TbHeap *hp, long long now) {
+    while (hp->n > 0 && hp->h[0]->expires <= now) {
+        TbHeapTimer *t = hp->h[0];
+        tb_heap_cancel(hp, t);
+        t->cb(t->arg);
+    }
+}
+
+typedef struct {
+    double arm, rearm, cancel, fire;   // ns por temporizador
+} TbResult;
+
+static void tb_best(TbResult *best, const TbResult *r) {
+    if (best->arm == 0 || r->arm < best->arm)
+        best->arm = r->arm;
+    if (best->rearm == 0 || r->rearm < best->rearm)
+        best->rearm = r->rearm;
+    if (best->cancel == 0 || r->cancel < best->cancel)
+        best->cancel = r->cancel;
+    if (best->fire == 0 || r->fire < best->fire)
+        best->fire = r->fire;
+}
+
+static void tb_wheel(Timer *t, int n, const long long *d1, const long long *d2, TbResult *r) {
+    TimerWheel w;
+    tbNow = 0;
+    timer_wheel_init(&w);
+    for (int i = 0; i < n; i++)
+        timer_init(&t[i], tb_callback, NULL);
+
+    double t0 = tb_now();
+    for (int i = 0; i < n; i++)
+        timer_arm(&w, &t[i], d1[i]);
+    double t1 = tb_now();
+    for (int i = 0; i < n; i++)
+        timer_arm(&w, &t[i], d2[i]);
+    double t2 = tb_now();
+    for (int i = 0; i < n; i++)
+        timer_cancel(&t[i]);
+    double t3 = tb_now();
+    for (int i = 0; i < n; i++)
+        timer_arm(&w, &t[i], d1[i]);
+    tbFired = 0;
+    double t4 = tb_now();
+    for (tbNow = 1; tbNow <= TB_SPAN; tbNow++)
+        timer_run(&w);
+    double t5 = tb_now();
+    if (tbFired != (unsigned long)n) {
+        printf("Roda: dispararam %lu de %d\n", tbFired, n);
+        exit(EXIT_FAILURE);
+    }
+    r->arm = (t1 - t0) * 1e9 / n;
+    r->rearm = (t2 - t1) * 1e9 / n;
+    r->cancel = (t3 - t2) * 1e9 / n;
+    r->fire = (t5 - t4) * 1e9 / n;
+}
+
+static void tb_heap(TbHeapTimer *t, TbHeap *hp, int n, const long long *d1, const long long *d2,
+                    TbResult *r) {
+    hp->n = 0;
+    for (int i = 0; i < n; i++) {
+        t[i].idx = -1;
+        t[i].cb = tb_callback;
+        t[i].arg = NULL;
+    }
+
+    double t0 = tb_now();
+    for (int i = 0; i < n; i++)
+        tb_heap_arm(hp, &t[i], d1[i]);
+    double t1 = tb_now();
+    for (int i = 0; i < n; i++)
+        tb_heap_arm(hp, &t[i], d2[i]);
+    double t2 = tb_now();
+    for (int i = 0; i < n; i++)
+        tb_heap_cancel(hp, &t[i]);
+    double t3 = tb_now();
+    for (int i = 0; i < n; i++)
+        tb_heap_arm(hp, &t[i], d1[i]);
+    tbFired = 0;
+    double t4 = tb_now();
+    for (long long now = 1; now <= TB_SPAN; now++)
+        tb_heap_run(hp, now);
+    double t5 = tb_now();
+    if (tbFired != (unsigned long)n) {
+        printf("Heap: dispararam %lu de %d\n", tbFired, n);
+        exit(EXIT_FAILURE);
+    }
+    r->arm = (t1 - t0) * 1e9 / n;
+    r->rearm = (t2 - t1) * 1e9 / n;
+    r->cancel = (t3 - t2) * 1e9 / n;
+    r->fire = (t5 - t4) * 1e9 / n;
+}
+
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 100000;
+    int reps = argc > 2 ? atoi(argv[2]) : 5;
+    if (n <= 0 || reps <= 0) {
+        fprintf(stderr, "Uso: %s [temporizadores] [repetições]\n", argv[0]);
+        return 2;
+    }
+    long long *d1 = malloc((size_t)n * sizeof(*d1));
+    long long *d2 = malloc((size_t)n * sizeof(*d2));
+    Timer *wt = malloc((size_t)n * sizeof(*wt));
+    TbHeapTimer *ht = malloc((size_t)n * sizeof(*ht));
+    TbHeap hp = {malloc((size_t)n * sizeof(*hp.h)), 0};
+    if (d1 == NULL || d2 == NULL || wt == NULL || ht == NULL || hp.h == NULL) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+    uint64_t x = 88172645463325252ull;
+    for (int i = 0; i < n; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        d1[i] = 1 + (long long)(x % TB_SPAN);
+        d2[i] = 1 + (long long)((x >> 32) % TB_SPAN);
+    }
+
+    TbResult wheel = {0}, heap = {0}, r;
+    for (int k = 0; k < reps; k++) {
+        tb_wheel(wt, n, d1, d2, &r);
+        tb_best(&wheel, &r);
+        tb_heap(ht, &hp, n, d1, d2, &r);
+        tb_best(&heap, &r);
+    }
+    printf("%d temporizadores, prazos até %d ms, melhor de %d (ns por temporizador)\n", n, TB_SPAN,
+           reps);
+    printf("        armar  rearmar  cancelar  disparar\n");
+    printf("roda  %7.1f  %7.1f  %8.1f  %8.1f\n", wheel.arm, wheel.rearm, wheel.cancel,
+           wheel.fire);
+    printf("heap  %7.1f  %7.1f  %8.1f  %8.1f\n", heap.arm, heap.rearm, heap.cancel, heap.fire);
+    free(d1);
+    free(d2);
+    free(wt);
+    free(ht);
+    free(hp.h);
+    return 0;
+}
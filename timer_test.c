@@ -0,0 +1,252 @@
+// timer_test.c
+//
+// Verificação aleatória da roda de temporizadores (timer.h) contra um
+// modelo simples: um prazo por temporizador, em milissegundos de um
+// relógio virtual.
+//
+//   gcc -O2 -o timer_test timer_test.c
+//   ./timer_test [passos] [semente]
+//
+// Em cada passo arma, rearma ou cancela um temporizador ao acaso (prazos de
+// poucos ms a mais de 4,6 horas, alguns no passado), ou avança o relógio e
+// chama timer_run(). O avanço é às vezes o de timer_timeout(), como no
+// reactor, e às vezes um salto de até várias voltas de todos os níveis. Os
+// callbacks armam, rearmam e cancelam outros temporizadores, incluindo os
+// que ainda estão no lote. Verifica-se que:
+//
+//   - disparam exatamente os temporizadores cujo prazo já passou, nenhum
+//     antes do tempo, por ordem de prazo, e os cancelados não disparam
+//   - timer_pending() e o número de armados coincidem com o modelo
+//   - timer_timeout() nunca passa do prazo mais próximo e, depois de
+//     timer_run(), nunca é 0 (o reactor não fica a rodar em vazio)
+//
+// Termina com 1 na primeira diferença, indicando o passo e a semente.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static long long ttNow;   // relógio virtual, em ms
+
+static long long tt_clock(void) {
+    return ttNow;
+}
+
+#define TIMER_CLOCK tt_clock
+#include "timer.h"
+
+#define TT_TIMERS 256
+
+typedef struct {
+    Timer t;
+    int armed;
+    long long deadline;   // ms do relógio virtual
+} TtTimer;
+
+static TimerWheel ttWheel;
+static TtTimer ttTimers[TT_TIMERS];
+static long long ttBase;        // instante do tick 0
+static long long ttWheelNow;    // tick mínimo de um prazo novo (o now da roda)
+static long long ttLastFired;   // prazo do último disparo do lote atual
+static int ttFired;
+static long ttStep;
+static uint64_t ttState = 88172645463325252ull, ttSeed;
+
+#define TT_CHECK(cond)                                                                     \
+    do {                                                                                   \
+        if (!(cond)) {                                                                     \
+            printf("Passo %ld (semente %llu): falhou %s (linha %d)\n", ttStep,              \
+                   (unsigned long long)ttSeed, #cond, __LINE__);                           \
+            exit(EXIT_FAILURE);                                                            \
+        }                                                                                  \
+    } while (0)
+
+static uint64_t tt_random(void) {
+    ttState ^= ttState << 13;
+    ttState ^= ttState >> 7;
+    ttState ^= ttState << 17;
+    return ttState;
+}
+
+// Atraso ao acaso: sobretudo no nível 0 e 1, às vezes nos de cima, no
+// passado ou para lá do alcance da roda
+static long long tt_delay(void) {
+    switch (tt_random() % 10) {
+    case 0:
+    case 1:
+    case 2:
+        return (long long)(tt_random() % 64);
+    case 3:
+    case 4:
+    case 5:
+        return (long long)(tt_random() % 4100);
+    case 6:
+        return (long long)(tt_random() % 300000);
+    case 7:
+        return (long long)(tt_random() % 20000000);
+    case 8:
+        return -(long long)(tt_random() % 100);
+    default:
+        return (long long)TIMER_MAX_TICKS - 50 + (long long)(tt_random() % 100);
+    }
+}
+
+// Prazo que a roda dá a um pedido para when: nunca antes do tick atual da
+// roda e nunca mais longe do que TIMER_MAX_TICKS
+static long long tt_expected(long long when) {
+    long long lo = ttBase + ttWheelNow;
+    if (when < lo)
+        when = lo;
+    if (when - lo > (long long)TIMER_MAX_TICKS)
+        when = lo + (long long)TIMER_MAX_TICKS;
+    return when;
+}
+
+static void tt_arm(TtTimer *e) {
+    long long when = ttNow + tt_delay();
+    timer_arm(&ttWheel, &e->t, when);
+    e->armed = 1;
+    e->deadline = tt_expected(when);
+}
+
+static void tt_cancel(TtTimer *e) {
+    timer_cancel(&e->t);
+    e->armed = 0;
+}
+
+static void tt_callback(void *arg) {
+    TtTimer *e = arg;
+    TT_CHECK(e->armed);
+    TT_CHECK(e->deadline <= ttNow);
+    TT_CHECK(e->deadline >= ttLastFired);
+    TT_CHECK(!timer_pending(&e->t));
+    ttLastFired = e->deadline;
+    e->armed = 0;
+    ttFired++;
+    // Mexe noutros temporizadores, que podem estar no lote
+    int ops = (int)(tt_random() % 4);
+    for (int k = 0; k < ops; k++) {
+        TtTimer *o = &ttTimers[tt_random() % TT_TIMERS];
+        if (tt_random() % 2)
+            tt_cancel(o);
+        else
+            tt_arm(o);
+    }
+    // Periódico
+    if (tt_random() % 4 == 0)
+        tt_arm(e);
+}
+
+static void tt_check_state(void) {
+    unsigned long armed = 0;
+    for (int i = 0; i < TT_TIMERS; i++) {
+        TT_CHECK(timer_pending(&ttTimers[i].t) == ttTimers[i].armed);
+        armed += (unsigned long)ttTimers[i].armed;
+    }
+    TT_CHECK(ttWheel.count == armed);
+}
+
+static void tt_check_timeout(int after_run) {
+    int timeout = timer_timeout(&ttWheel);
+    long long first = -1;
+    for (int i = 0; i < TT_TIMERS; i++)
+        if (ttTimers[i].armed && (first < 0 || ttTimers[i].deadline < first))
+            first = ttTimers[i].deadline;
+    if (first < 0) {
+        TT_CHECK(timeout == -1);
+        return;
+    }
+    TT_CHECK(timeout >= 0);
+    TT_CHECK(ttNow + timeout <= (first > ttNow ? first : ttNow));
+    if (after_run)
+        TT_CHECK(timeout > 0);
+}
+
+static void tt_run(void) {
+    // Os temporizadores vencidos antes de avançar são os que têm de disparar
+    int due = 0;
+    for (int i = 0; i < TT_TIMERS; i++)
+        due += ttTimers[i].armed && ttTimers[i].deadline <= ttNow;
+    if (ttNow - ttBase >= ttWheelNow)
+        ttWheelNow = ttNow - ttBase + 1;
+    ttLastFired = 0;
+    ttFired = 0;
+    int n = timer_run(&ttWheel);
+    TT_CHECK(n == ttFired);
+    // Um callback pode cancelar vencidos que ainda estavam no lote
+    TT_CHECK(n <= due);
+    for (int i = 0; i < TT_TIMERS; i++)
+        TT_CHECK(!ttTimers[i].armed || ttTimers[i].deadline > ttNow);
+    tt_check_state();
+    tt_check_timeout(1);
+}
+
+static void tt_advance(void) {
+    int timeout = timer_timeout(&ttWheel);
+    switch (tt_random() % 8) {
+    case 0:
+    case 1:
+    case 2:
+        if (timeout > 0) {
+            ttNow += timeout;
+            break;
+        }
+        // fall through
+    case 3:
+    case 4:
+        ttNow += (long long)(tt_random() % 70);
+        break;
+    case 5:
+        ttNow += (long long)(tt_random() % 5000);
+        break;
+    case 6:
+        ttNow += (long long)(tt_random() % 400000);
+        break;
+    default:
+        if (tt_random() % 16 == 0)
+            ttNow += (long long)(tt_random() % (3 * TIMER_MAX_TICKS));
+        break;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    long steps = argc > 1 ? atol(argv[1]) : 1000000;
+    ttSeed = argc > 2 ? strtoull(argv[2], NULL, 0) : 1;
+    if (steps <= 0) {
+        fprintf(stderr, "Uso: %s [passos] [semente]\n", argv[0]);
+        return 2;
+    }
+    ttState ^= ttSeed * 0x9e3779b97f4a7c15ull;
+    if (ttState == 0)
+        ttState = 1;
+    ttNow = 1000;
+    ttBase = ttNow;
+    timer_wheel_init(&ttWheel);
+    for (int i = 0; i < TT_TIMERS; i++)
+        timer_init(&ttTimers[i].t, tt_callback, &ttTimers[i]);
+
+    for (ttStep = 0; ttStep < steps; ttStep++) {
+        TtTimer *e = &ttTimers[tt_random() % TT_TIMERS];
+        switch (tt_random() % 6) {
+        case 0:
+        case 1:
+            tt_arm(e);
+            break;
+        case 2:
+            tt_cancel(e);
+            break;
+        case 3:
+            tt_check_timeout(0);
+            break;
+        default:
+            tt_advance();
+            tt_run();
+            break;
+        }
+        if (ttStep % 64 == 0)
+            tt_check_state();
+    }
+    printf("%ld passos sem diferenças (semente %llu), %.1f horas virtuais\n", steps,
+           (unsigned long long)ttSeed, (double)(ttNow - ttBase) / 3600000.0);
+    timer_print_stats(&ttWheel);
+    return 0;
+}